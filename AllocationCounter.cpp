@@ -0,0 +1,79 @@
+﻿#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib> // Для std::malloc, std::free
+#include <new>
+
+// Подменяется весь набор (массивы, nothrow, выровненные и с размером), иначе часть выделений не считалась бы,
+// а память от подмененного new освобождалась бы стандартным delete
+namespace {
+    std::atomic<long long> g_allocations{ 0 };
+    std::atomic<long long> g_allocatedBytes{ 0 };
+
+    void countAllocation(std::size_t size) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_allocatedBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    }
+
+    void* allocate(std::size_t size) noexcept {
+        countAllocation(size);
+        return std::malloc(size != 0 ? size : 1);
+    }
+
+    // Выровненный блок: перед выровненным адресом хранится указатель, полученный от malloc
+    // (std::aligned_alloc нет в MSVC)
+    void* allocateAligned(std::size_t size, std::align_val_t alignment) noexcept {
+        countAllocation(size);
+        const std::size_t align = static_cast<std::size_t>(alignment);
+        void* raw = std::malloc(size + align + sizeof(void*));
+        if (!raw) return nullptr;
+        const std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + align - 1)
+            & ~static_cast<std::uintptr_t>(align - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    void freeAligned(void* p) noexcept {
+        if (p) std::free(reinterpret_cast<void**>(p)[-1]);
+    }
+
+    void* orThrow(void* p) {
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+}
+
+void* operator new(std::size_t size) { return orThrow(allocate(size)); }
+void* operator new[](std::size_t size) { return orThrow(allocate(size)); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return orThrow(allocateAligned(size, alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return orThrow(allocateAligned(size, alignment)); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+
+long long allocationCount() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+long long allocatedBytes() {
+    return g_allocatedBytes.load(std::memory_order_relaxed);
+}
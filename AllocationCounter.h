@@ -0,0 +1,10 @@
+﻿#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+// Подсчет выделений памяти для замеров. AllocationCounter.cpp подменяет глобальные operator new/delete,
+// поэтому подключается только к исполняемому файлу замеров. Подмена вынесена в отдельный файл:
+// иначе компилятор встраивал бы delete в вызывающий код и предупреждал о free для памяти от operator new
+long long allocationCount(); // Выделений с начала программы
+long long allocatedBytes();  // Запрошенных байт с начала программы
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,304 @@
+﻿#include "BarnesHutTree.h"
+
+#include <algorithm> // Для std::min, std::max, std::sort, std::merge
+#include <cmath>
+#include <utility>
+
+namespace {
+    // По 32 бита кода Мортона на координату: глубже ячейки не делятся
+    constexpr int MAX_DEPTH = 32;
+
+    // Растянуть 32 бита так, чтобы между ними были нулевые биты
+    uint64_t spreadBits(uint64_t v) {
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+        v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+        v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & 0x5555555555555555ull;
+        return v;
+    }
+
+    // Квадрант уровня depth (0 - корень): старший бит - x, младший - y
+    uint32_t quadrantOf(uint64_t code, int depth) {
+        return static_cast<uint32_t>(code >> (62 - 2 * depth)) & 3u;
+    }
+
+    // Число частей для параллельных проходов по телам
+    size_t chunkCount(size_t count, ThreadPool& pool) {
+        return std::max<size_t>(1, std::min(count / 4096 + 1, static_cast<size_t>(pool.getThreadCount()) * 4));
+    }
+}
+
+uint64_t BarnesHutTree::mortonCode(double x, double y, const Cell& cell) {
+    constexpr double SCALE = 4294967296.0; // 2^32
+    constexpr double MAX_COORDINATE = 4294967295.0;
+    const double u = std::min(std::max((x - cell.minX) / cell.size * SCALE, 0.0), MAX_COORDINATE);
+    const double v = std::min(std::max((y - cell.minY) / cell.size * SCALE, 0.0), MAX_COORDINATE);
+    return (spreadBits(static_cast<uint64_t>(u)) << 1) | spreadBits(static_cast<uint64_t>(v));
+}
+
+BarnesHutTree::Cell BarnesHutTree::boundingCell(const double* x, const double* y, size_t count, ThreadPool& pool) {
+    struct Bounds {
+        double minX, maxX, minY, maxY;
+    };
+    const size_t chunks = chunkCount(count, pool);
+    std::vector<Bounds> partial(chunks, { x[0], x[0], y[0], y[0] });
+    pool.parallelFor(chunks, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            Bounds& b = partial[c];
+            for (size_t i = count * c / chunks; i < count * (c + 1) / chunks; ++i) {
+                b.minX = std::min(b.minX, x[i]);
+                b.maxX = std::max(b.maxX, x[i]);
+                b.minY = std::min(b.minY, y[i]);
+                b.maxY = std::max(b.maxY, y[i]);
+            }
+        }
+    }, 1);
+
+    Bounds total = partial[0];
+    for (const Bounds& b : partial) {
+        total.minX = std::min(total.minX, b.minX);
+        total.maxX = std::max(total.maxX, b.maxX);
+        total.minY = std::min(total.minY, b.minY);
+        total.maxY = std::max(total.maxY, b.maxY);
+    }
+    // Квадрат с небольшим запасом, чтобы крайние тела не попадали на границу
+    double size = std::max(total.maxX - total.minX, total.maxY - total.minY) * (1.0 + 1e-9);
+    if (!(size > 0.0)) size = 1.0;
+    return { total.minX, total.minY, size };
+}
+
+void BarnesHutTree::sortOrder(const double* x, const double* y, size_t count, std::vector<uint32_t>& order,
+    ThreadPool& pool) {
+    order.resize(count);
+    if (count == 0) return;
+    const Cell cell = boundingCell(x, y, count, pool);
+
+    std::vector<std::pair<uint64_t, uint32_t>> keys(count), merged(count);
+    const size_t chunks = chunkCount(count, pool);
+    pool.parallelFor(chunks, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            const size_t begin = count * c / chunks, end = count * (c + 1) / chunks;
+            for (size_t i = begin; i < end; ++i) {
+                keys[i] = { mortonCode(x[i], y[i], cell), static_cast<uint32_t>(i) };
+            }
+            std::sort(keys.begin() + begin, keys.begin() + end);
+        }
+    }, 1);
+
+    // Отсортированные части сливаются попарно, слияния одного уровня независимы
+    for (size_t width = 1; width < chunks; width *= 2) {
+        const size_t pairs = (chunks + 2 * width - 1) / (2 * width);
+        pool.parallelFor(pairs, [&](size_t first, size_t last) {
+            for (size_t p = first; p < last; ++p) {
+                const size_t begin = count * std::min(chunks, 2 * width * p) / chunks;
+                const size_t middle = count * std::min(chunks, 2 * width * p + width) / chunks;
+                const size_t end = count * std::min(chunks, 2 * width * (p + 1)) / chunks;
+                std::merge(keys.begin() + begin, keys.begin() + middle, keys.begin() + middle, keys.begin() + end,
+                    merged.begin() + begin);
+            }
+        }, 1);
+        keys.swap(merged);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = keys[i].second;
+    }
+}
+
+void BarnesHutTree::build(const double* x, const double* y, const double* mass, size_t count, ThreadPool& pool) {
+    m_x = x;
+    m_y = y;
+    m_mass = mass;
+    m_nodes.clear();
+    m_codes.resize(count);
+    if (count == 0) return;
+
+    m_root = boundingCell(x, y, count, pool);
+    pool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            m_codes[i] = mortonCode(x[i], y[i], m_root);
+        }
+    });
+
+    const SubtreeTask root = { 0, static_cast<uint32_t>(count), 0, m_root };
+    std::vector<SubtreeTask> tasks;
+    collectSubtrees(root, tasks);
+
+    std::vector<std::vector<Node>> subtrees(tasks.size());
+    pool.parallelFor(tasks.size(), [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; ++t) {
+            buildSubtree(tasks[t], subtrees[t]);
+        }
+    }, 1);
+
+    size_t totalNodes = 0;
+    for (const auto& subtree : subtrees) totalNodes += subtree.size();
+    m_nodes.reserve(totalNodes + tasks.size());
+    size_t nextSubtree = 0;
+    buildTop(root, subtrees, nextSubtree);
+}
+
+BarnesHutTree::Cell BarnesHutTree::childCell(const Cell& cell, uint32_t quadrant) {
+    const double half = cell.size * 0.5;
+    return { cell.minX + ((quadrant & 2u) ? half : 0.0), cell.minY + ((quadrant & 1u) ? half : 0.0), half };
+}
+
+bool BarnesHutTree::isLeaf(uint32_t begin, uint32_t end, int depth) {
+    return end - begin <= LEAF_SIZE || depth >= MAX_DEPTH;
+}
+
+bool BarnesHutTree::isSubtreeRoot(uint32_t begin, uint32_t end, int depth) {
+    return depth >= PARALLEL_BUILD_DEPTH || isLeaf(begin, end, depth);
+}
+
+void BarnesHutTree::splitQuadrants(uint32_t begin, uint32_t end, int depth, uint32_t splits[5]) const {
+    // Внутри ячейки старшие разряды кодов совпадают, поэтому тела отсортированы по квадранту уровня depth
+    splits[0] = begin;
+    for (uint32_t q = 1; q < 4; ++q) {
+        splits[q] = static_cast<uint32_t>(std::partition_point(m_codes.begin() + splits[q - 1], m_codes.begin() + end,
+            [depth, q](uint64_t code) { return quadrantOf(code, depth) < q; }) - m_codes.begin());
+    }
+    splits[4] = end;
+}
+
+void BarnesHutTree::collectSubtrees(const SubtreeTask& task, std::vector<SubtreeTask>& tasks) const {
+    if (isSubtreeRoot(task.begin, task.end, task.depth)) {
+        tasks.push_back(task);
+        return;
+    }
+    uint32_t splits[5];
+    splitQuadrants(task.begin, task.end, task.depth, splits);
+    for (uint32_t q = 0; q < 4; ++q) {
+        if (splits[q] == splits[q + 1]) continue;
+        collectSubtrees({ splits[q], splits[q + 1], task.depth + 1, childCell(task.cell, q) }, tasks);
+    }
+}
+
+void BarnesHutTree::buildSubtree(const SubtreeTask& task, std::vector<Node>& nodes) const {
+    const size_t index = nodes.size();
+    nodes.push_back({ 0.0, 0.0, 0.0, task.cell.size, 0, task.begin, task.end, false });
+
+    if (isLeaf(task.begin, task.end, task.depth)) {
+        double mass = 0.0, mx = 0.0, my = 0.0;
+        for (uint32_t i = task.begin; i < task.end; ++i) {
+            mass += m_mass[i];
+            mx += m_mass[i] * m_x[i];
+            my += m_mass[i] * m_y[i];
+        }
+        Node& leaf = nodes[index];
+        leaf.mass = mass;
+        leaf.comX = (mass > 0.0) ? mx / mass : m_x[task.begin];
+        leaf.comY = (mass > 0.0) ? my / mass : m_y[task.begin];
+        leaf.leaf = true;
+        leaf.next = static_cast<uint32_t>(nodes.size());
+        return;
+    }
+
+    uint32_t splits[5];
+    splitQuadrants(task.begin, task.end, task.depth, splits);
+    for (uint32_t q = 0; q < 4; ++q) {
+        if (splits[q] == splits[q + 1]) continue;
+        buildSubtree({ splits[q], splits[q + 1], task.depth + 1, childCell(task.cell, q) }, nodes);
+    }
+    finishNode(nodes, index);
+}
+
+void BarnesHutTree::buildTop(const SubtreeTask& task, std::vector<std::vector<Node>>& subtrees, size_t& nextSubtree) {
+    if (isSubtreeRoot(task.begin, task.end, task.depth)) {
+        // Готовое поддерево переносится целиком со сдвигом ссылок next
+        std::vector<Node>& subtree = subtrees[nextSubtree++];
+        const uint32_t offset = static_cast<uint32_t>(m_nodes.size());
+        for (Node& node : subtree) {
+            node.next += offset;
+            m_nodes.push_back(node);
+        }
+        std::vector<Node>().swap(subtree);
+        return;
+    }
+
+    const size_t index = m_nodes.size();
+    m_nodes.push_back({ 0.0, 0.0, 0.0, task.cell.size, 0, task.begin, task.end, false });
+    uint32_t splits[5];
+    splitQuadrants(task.begin, task.end, task.depth, splits);
+    for (uint32_t q = 0; q < 4; ++q) {
+        if (splits[q] == splits[q + 1]) continue;
+        buildTop({ splits[q], splits[q + 1], task.depth + 1, childCell(task.cell, q) }, subtrees, nextSubtree);
+    }
+    finishNode(m_nodes, index);
+}
+
+void BarnesHutTree::finishNode(std::vector<Node>& nodes, size_t index) {
+    const uint32_t end = static_cast<uint32_t>(nodes.size());
+    double mass = 0.0, mx = 0.0, my = 0.0;
+    for (uint32_t child = static_cast<uint32_t>(index) + 1; child < end; child = nodes[child].next) {
+        mass += nodes[child].mass;
+        mx += nodes[child].mass * nodes[child].comX;
+        my += nodes[child].mass * nodes[child].comY;
+    }
+    Node& node = nodes[index];
+    node.mass = mass;
+    node.comX = (mass > 0.0) ? mx / mass : nodes[index + 1].comX;
+    node.comY = (mass > 0.0) ? my / mass : nodes[index + 1].comY;
+    node.next = end;
+}
+
+long long BarnesHutTree::computeAccelerations(double G, double theta, double softening, double* ax, double* ay,
+    ThreadPool& pool) const {
+    const size_t count = m_codes.size();
+    if (count == 0) return 0;
+    const double thetaSquared = theta * theta;
+    const double softeningSquared = softening * softening;
+    const uint32_t nodeCount = static_cast<uint32_t>(m_nodes.size());
+
+    const size_t chunks = chunkCount(count, pool) * 4;
+    std::vector<long long> interactions(chunks, 0);
+    pool.parallelFor(chunks, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            long long chunkInteractions = 0;
+            // Соседние тела в порядке Мортона обходят почти одни и те же узлы, что хорошо для кэша
+            for (size_t i = count * c / chunks; i < count * (c + 1) / chunks; ++i) {
+                const double px = m_x[i], py = m_y[i];
+                double sumX = 0.0, sumY = 0.0;
+                uint32_t n = 0;
+                while (n < nodeCount) {
+                    const Node& node = m_nodes[n];
+                    const double dx = node.comX - px, dy = node.comY - py;
+                    const double distanceSquared = dx * dx + dy * dy;
+                    const bool containsBody = i >= node.bodyBegin && i < node.bodyEnd;
+                    if (!containsBody && node.size * node.size < thetaSquared * distanceSquared) {
+                        // Узел далеко: притяжение всей ячейки как точечной массы
+                        const double r2 = distanceSquared + softeningSquared;
+                        const double factor = node.mass / (r2 * std::sqrt(r2));
+                        sumX += factor * dx;
+                        sumY += factor * dy;
+                        ++chunkInteractions;
+                        n = node.next;
+                    }
+                    else if (node.leaf) {
+                        for (uint32_t j = node.bodyBegin; j < node.bodyEnd; ++j) {
+                            if (j == i) continue;
+                            const double bx = m_x[j] - px, by = m_y[j] - py;
+                            const double r2 = bx * bx + by * by + softeningSquared;
+                            const double factor = m_mass[j] / (r2 * std::sqrt(r2));
+                            sumX += factor * bx;
+                            sumY += factor * by;
+                        }
+                        chunkInteractions += node.bodyEnd - node.bodyBegin;
+                        n = node.next;
+                    }
+                    else {
+                        ++n; // Раскрыть узел: первый потомок идет сразу за ним
+                    }
+                }
+                ax[i] = G * sumX;
+                ay[i] = G * sumY;
+            }
+            interactions[c] = chunkInteractions;
+        }
+    }, 1);
+
+    long long total = 0;
+    for (long long value : interactions) total += value;
+    return total;
+}
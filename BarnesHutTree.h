@@ -0,0 +1,85 @@
+﻿#ifndef BARNESHUTTREE_H
+#define BARNESHUTTREE_H
+
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Квадродерево Барнса-Хата для вычисления гравитационных ускорений N тел за O(N log N).
+// Тела должны быть упорядочены по коду Мортона (см. sortOrder): тогда тела любой ячейки
+// занимают непрерывный диапазон, а дерево хранится в порядке обхода в глубину, где первый
+// потомок узла идет сразу за ним, а next указывает на узел после всего поддерева.
+// Обход при этом не требует стека: узел либо принимается целиком (i = next), либо раскрывается (i + 1)
+class BarnesHutTree {
+public:
+    // Тела в листе: при меньшем числе прямое суммирование быстрее спуска по дереву
+    static constexpr uint32_t LEAF_SIZE = 8;
+    // Глубина, до которой поддеревья строятся параллельно (4^3 = 64 независимые ячейки)
+    static constexpr int PARALLEL_BUILD_DEPTH = 3;
+
+    struct Node {
+        double comX, comY;   // Центр масс
+        double mass;
+        double size;         // Сторона ячейки
+        uint32_t next;       // Индекс узла, следующего за поддеревом
+        uint32_t bodyBegin;  // Диапазон тел ячейки [bodyBegin, bodyEnd)
+        uint32_t bodyEnd;
+        bool leaf;
+    };
+
+    // Порядок тел по коду Мортона: order[k] - индекс тела, стоящего k-м в порядке дерева
+    static void sortOrder(const double* x, const double* y, size_t count, std::vector<uint32_t>& order, ThreadPool& pool);
+
+    // Построить дерево по телам, уже упорядоченным sortOrder
+    void build(const double* x, const double* y, const double* mass, size_t count, ThreadPool& pool);
+
+    // Ускорения всех тел (в порядке дерева). theta - критерий раскрытия узла (size / расстояние),
+    // softening - сглаживающая длина. Возвращает число вычисленных парных взаимодействий
+    long long computeAccelerations(double G, double theta, double softening, double* ax, double* ay, ThreadPool& pool) const;
+
+    size_t nodeCount() const { return m_nodes.size(); }
+    const Node& node(size_t index) const { return m_nodes[index]; }
+
+private:
+    struct Cell {
+        double minX, minY, size;
+    };
+
+    // Код Мортона точки внутри квадрата cell (по 32 бита на координату)
+    static uint64_t mortonCode(double x, double y, const Cell& cell);
+    static Cell boundingCell(const double* x, const double* y, size_t count, ThreadPool& pool);
+
+    // Ячейка, поддерево которой строится независимо от остальных
+    struct SubtreeTask {
+        uint32_t begin, end;
+        int depth;
+        Cell cell;
+    };
+
+    static Cell childCell(const Cell& cell, uint32_t quadrant);
+    // Поддерево строится целиком одной задачей: достигнута глубина параллельного построения или это лист
+    static bool isSubtreeRoot(uint32_t begin, uint32_t end, int depth);
+    static bool isLeaf(uint32_t begin, uint32_t end, int depth);
+
+    // Поддеревья для параллельного построения в порядке обхода buildTop
+    void collectSubtrees(const SubtreeTask& task, std::vector<SubtreeTask>& tasks) const;
+    // Построить поддерево ячейки и дописать его в nodes
+    void buildSubtree(const SubtreeTask& task, std::vector<Node>& nodes) const;
+    // Верхние уровни дерева поверх готовых поддеревьев
+    void buildTop(const SubtreeTask& task, std::vector<std::vector<Node>>& subtrees, size_t& nextSubtree);
+    // Разбить [begin, end) по квадрантам уровня depth: тела квадранта q - [splits[q], splits[q + 1])
+    void splitQuadrants(uint32_t begin, uint32_t end, int depth, uint32_t splits[5]) const;
+    // Масса и центр масс внутреннего узла nodes[index] по его потомкам; next - конец поддерева
+    static void finishNode(std::vector<Node>& nodes, size_t index);
+
+    const double* m_x = nullptr;
+    const double* m_y = nullptr;
+    const double* m_mass = nullptr;
+    Cell m_root = { 0.0, 0.0, 0.0 };
+    std::vector<uint64_t> m_codes; // Коды Мортона тел в порядке дерева
+    std::vector<Node> m_nodes;
+};
+
+#endif // BARNESHUTTREE_H
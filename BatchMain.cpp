@@ -0,0 +1,99 @@
+﻿// Пакетный режим без графического интерфейса: TrajectoryBatch [файл_заданий | -] [--threads N] [--cache КАТАЛОГ | --no-cache]
+//     [--checkpoint-dir КАТАЛОГ] [--checkpoint-interval СЕКУНДЫ]
+// Формат файла заданий описан в BatchRunner.h. Без файла (или с "-") задания читаются из stdin.
+// Сводки повторяющихся заданий берутся из кэша в памяти; с --cache кэш сохраняется в каталог
+// и используется следующими запусками. С --checkpoint-dir состояние заданий периодически (по умолчанию
+// раз в минуту) сохраняется, и прерванный пакет при повторном запуске продолжается с места остановки.
+
+#include "BatchRunner.h"
+
+#include <chrono>
+#include <clocale>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    setlocale(LC_ALL, "Rus");
+
+    std::string jobsFile = "-";
+    unsigned int threadCount = 0;
+    std::string cacheDirectory;
+    bool useCache = true;
+    std::string checkpointDirectory;
+    double checkpointInterval = 60.0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threadCount = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--cache" && i + 1 < argc) {
+            cacheDirectory = argv[++i];
+        }
+        else if (arg == "--no-cache") {
+            useCache = false;
+        }
+        else if (arg == "--checkpoint-dir" && i + 1 < argc) {
+            checkpointDirectory = argv[++i];
+        }
+        else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+            checkpointInterval = std::strtod(argv[++i], nullptr);
+        }
+        else if (arg == "--help" || arg == "-h") {
+            std::cout << "Использование: " << argv[0]
+                << " [файл_заданий | -] [--threads N] [--cache КАТАЛОГ | --no-cache]"
+                << " [--checkpoint-dir КАТАЛОГ] [--checkpoint-interval СЕКУНДЫ]\n";
+            return EXIT_SUCCESS;
+        }
+        else {
+            jobsFile = arg;
+        }
+    }
+
+    std::vector<BatchJob> jobs;
+    if (jobsFile == "-") {
+        jobs = BatchRunner::parseJobs(std::cin);
+    }
+    else {
+        std::ifstream input(jobsFile);
+        if (!input.is_open()) {
+            std::cerr << "Ошибка: не удалось открыть файл заданий '" << jobsFile << "'.\n";
+            return EXIT_FAILURE;
+        }
+        jobs = BatchRunner::parseJobs(input);
+    }
+    if (jobs.empty()) {
+        std::cerr << "Нет заданий для выполнения.\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        BatchRunner runner(threadCount);
+        SimulationCache cache(SimulationCache::DEFAULT_MEMORY_LIMIT_BYTES, cacheDirectory);
+        if (useCache) runner.setResultCache(&cache);
+        if (!runner.setCheckpointing(checkpointDirectory, checkpointInterval)) return EXIT_FAILURE;
+        std::cout << "Заданий: " << jobs.size() << ", потоков: " << runner.getThreadCount() << "\n";
+
+        auto started = std::chrono::steady_clock::now();
+        std::vector<BatchJobResult> results = runner.run(jobs);
+        double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        BatchRunner::printReport(std::cout, jobs, results, totalSeconds);
+        if (useCache) {
+            const SimulationCacheStats stats = cache.stats();
+            std::cout << "Кэш результатов: " << stats.hits() << " попаданий (" << stats.diskHits << " из файлов), "
+                << stats.misses << " промахов, " << stats.entries << " записей в памяти";
+            if (!cache.directory().empty()) std::cout << ", каталог " << cache.directory();
+            std::cout << "\n";
+        }
+        for (const auto& result : results) {
+            if (result.outputFailed) return EXIT_FAILURE;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Standard Exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,363 @@
+﻿#include "BatchRunner.h"
+#include "TrajectoryIO.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv> // Для std::from_chars и std::to_chars (не зависят от setlocale)
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <sstream>
+
+namespace {
+    bool parseDouble(const std::string& text, double& value) {
+        const char* first = text.data();
+        const char* last = text.data() + text.size();
+        if (first != last && *first == '+') ++first;
+        auto result = std::from_chars(first, last, value);
+        return result.ec == std::errc() && result.ptr == last;
+    }
+
+    bool parseInteger(const std::string& text, long long& value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    // Приемник заданий без файла траектории: расчет с контрольными точками идет через streamToWriter
+    struct DiscardWriter {
+        bool isOpen() const { return true; }
+        void write(const State&) {}
+        bool flush() { return true; }
+        bool close() { return true; }
+        size_t getPointsWritten() const { return 0; }
+    };
+}
+
+BatchRunner::BatchRunner(unsigned int threadCount)
+    : m_pool(threadCount) {
+}
+
+bool BatchRunner::setCheckpointing(const std::string& directory, double intervalSeconds) {
+    m_checkpointDirectory.clear();
+    m_checkpointInterval = std::max(0.0, intervalSeconds);
+    if (directory.empty()) return true;
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error || !std::filesystem::is_directory(directory, error)) {
+        std::cerr << "Ошибка: не удалось создать каталог контрольных точек '" << directory << "'.\n";
+        return false;
+    }
+    m_checkpointDirectory = directory;
+    return true;
+}
+
+std::vector<BatchJob> BatchRunner::parseJobs(std::istream& input) {
+    std::vector<BatchJob> jobs;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(input, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        size_t firstChar = line.find_first_not_of(" \t");
+        if (firstChar == std::string::npos || line[firstChar] == '#') continue;
+
+        BatchJob job;
+        job.lineNumber = lineNumber;
+        std::string error;
+        if (!parseJobLine(line, job, error)) {
+            std::cerr << "Ошибка в строке " << lineNumber << ": " << error << "\n";
+            continue;
+        }
+        if (job.name.empty()) {
+            job.name = "job" + std::to_string(jobs.size() + 1);
+        }
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+bool BatchRunner::parseJobLine(const std::string& line, BatchJob& job, std::string& error) {
+    std::istringstream tokens(line);
+    std::string token;
+    double totalTime = -1.0;
+    long long explicitSteps = -1;
+
+    while (tokens >> token) {
+        size_t separator = token.find('=');
+        if (separator == std::string::npos || separator == 0) {
+            error = "ожидалась пара ключ=значение: '" + token + "'";
+            return false;
+        }
+        std::string key = token.substr(0, separator);
+        std::string value = token.substr(separator + 1);
+
+        if (key == "name") { job.name = value; continue; }
+        if (key == "out") { job.outputFile = value; continue; }
+        if (key == "format") {
+            if (value == "text") job.format = BatchOutputFormat::Text;
+            else if (value == "binary") job.format = BatchOutputFormat::Binary;
+            else if (value == "binary32") job.format = BatchOutputFormat::BinaryFloat;
+            else { error = "неизвестный формат '" + value + "'"; return false; }
+            continue;
+        }
+        if (key == "integrator") {
+            if (value == "rk4") job.params.INTEGRATOR = IntegratorType::RungeKutta4;
+            else if (value == "dp45") job.params.INTEGRATOR = IntegratorType::DormandPrince45;
+            else if (value == "verlet") job.params.INTEGRATOR = IntegratorType::VelocityVerlet;
+            else if (value == "yoshida4") job.params.INTEGRATOR = IntegratorType::Yoshida4;
+            else if (value == "yoshida6") job.params.INTEGRATOR = IntegratorType::Yoshida6;
+            else { error = "неизвестный интегратор '" + value + "'"; return false; }
+            continue;
+        }
+        if (key == "steps" || key == "stride") {
+            long long number = 0;
+            if (!parseInteger(value, number) || number <= 0) {
+                error = "некорректное целое значение " + key + "='" + value + "'";
+                return false;
+            }
+            if (key == "steps") explicitSteps = number;
+            else job.stride = number;
+            continue;
+        }
+
+        double number = 0.0;
+        if (!parseDouble(value, number)) {
+            error = "некорректное число " + key + "='" + value + "'";
+            return false;
+        }
+        SimulationParameters& p = job.params;
+        if (key == "G") p.G = number;
+        else if (key == "M") p.M = number;
+        else if (key == "radius") p.CENTRAL_BODY_RADIUS = number;
+        else if (key == "k") p.DRAG_COEFFICIENT = number;
+        else if (key == "F") p.THRUST_COEFFICIENT = number;
+        else if (key == "J2") p.J2_COEFFICIENT = number;
+        else if (key == "gx") p.EXTERNAL_FIELD_X = number;
+        else if (key == "gy") p.EXTERNAL_FIELD_Y = number;
+        else if (key == "x") p.initialState.x = number;
+        else if (key == "y") p.initialState.y = number;
+        else if (key == "vx") p.initialState.vx = number;
+        else if (key == "vy" || key == "V0") p.initialState.vy = number;
+        else if (key == "T") totalTime = number;
+        else if (key == "dt") p.DT = number;
+        else if (key == "rtol") p.RELATIVE_TOLERANCE = number;
+        else if (key == "atol") p.ABSOLUTE_TOLERANCE = number;
+        else { error = "неизвестный ключ '" + key + "'"; return false; }
+    }
+
+    if (!(job.params.DT > 0.0)) {
+        error = "шаг dt должен быть положительным";
+        return false;
+    }
+    // Число шагов задается явно или, как в интерфейсе, через полное время T.
+    // STEPS - int, поэтому большее число шагов - ошибка разбора, а не усечение
+    const long long maxSteps = std::numeric_limits<int>::max();
+    if (explicitSteps > 0) {
+        if (explicitSteps > maxSteps) {
+            error = "число шагов steps=" + std::to_string(explicitSteps) + " больше " + std::to_string(maxSteps);
+            return false;
+        }
+        job.params.STEPS = static_cast<int>(explicitSteps);
+    }
+    else if (totalTime >= 0.0) {
+        const double steps = totalTime / job.params.DT;
+        if (!(steps <= static_cast<double>(maxSteps))) { // Также бесконечность и NaN
+            error = "время T слишком велико для шага dt: больше " + std::to_string(maxSteps) + " шагов";
+            return false;
+        }
+        job.params.STEPS = std::max(1, static_cast<int>(steps));
+    }
+    return true;
+}
+
+std::vector<BatchJobResult> BatchRunner::run(const std::vector<BatchJob>& jobs) {
+    std::vector<BatchJobResult> results(jobs.size());
+    m_pool.parallelFor(jobs.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            results[i] = runJob(jobs[i]);
+        }
+    }, 1);
+    return results;
+}
+
+std::string BatchRunner::checkpointPath(const BatchJob& job) const {
+    constexpr size_t MAX_NAME_LENGTH = 64;
+    std::string name;
+    for (char c : job.name.substr(0, MAX_NAME_LENGTH)) {
+        const bool safe = std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_';
+        name += safe ? c : '_';
+    }
+    // Все, что определяет содержимое контрольной точки: параметры, прореживание и файл вывода
+    const std::string variant = "checkpoint stride=" + std::to_string(job.stride)
+        + " format=" + std::to_string(static_cast<int>(job.format)) + " out=" + job.outputFile;
+    const uint64_t hash = SimulationCache::hashKey(SimulationCache::canonicalKey(job.params, variant));
+    char digits[16];
+    auto written = std::to_chars(digits, digits + sizeof(digits), hash, 16);
+    std::string suffix(static_cast<size_t>(digits + sizeof(digits) - written.ptr), '0');
+    suffix.append(digits, written.ptr);
+    return (std::filesystem::path(m_checkpointDirectory) / (name + "-" + suffix + ".checkpoint")).string();
+}
+
+bool BatchRunner::loadResumePoint(const BatchJob& job, const std::string& path, SimulationCheckpoint& checkpoint) {
+    if (!loadCheckpoint(path, checkpoint)) return false;
+    // Число записей должно соответствовать прореживанию задания: начальное состояние и каждое stride-е
+    const uint64_t expectedRecords = job.outputFile.empty()
+        ? 0 : static_cast<uint64_t>(checkpoint.progress.steps / job.stride + 1);
+    if (!Calculations::sameProblem(checkpoint.params, job.params) || checkpoint.params.STEPS != job.params.STEPS
+        || checkpoint.progress.steps <= 0 || checkpoint.progress.cancelled || checkpoint.progress.impactStep >= 0
+        || checkpoint.progress.terminalEvent >= 0 || checkpoint.outputRecords != expectedRecords) {
+        std::cerr << "Контрольная точка '" << path << "' относится к другим параметрам задания "
+            << job.name << ", расчет начинается заново.\n";
+        return false;
+    }
+    return true;
+}
+
+template <typename Writer>
+void BatchRunner::streamToWriter(const BatchJob& job, Writer& writer, const SimulationCheckpoint* resume,
+    CheckpointWriter* checkpoints, BatchJobResult& result) {
+    if (!writer.isOpen()) {
+        result.outputFailed = true;
+        return;
+    }
+    Calculations calculator;
+    StreamOptions options;
+    options.stride = job.stride;
+    options.reportImpact = false; // Столкновения попадают в итоговую таблицу, а не в перемешанный вывод потоков
+    if (checkpoints) {
+        options.checkpointInterval = CHECKPOINT_POLL_STEPS;
+        options.checkpoint = [&](const SimulationSummary& progress) {
+            if (!checkpoints->due()) return;
+            // Записи до контрольной точки должны оказаться в файле раньше нее; если запись не удалась,
+            // контрольная точка не сохраняется
+            if (!writer.flush()) return;
+            SimulationCheckpoint snapshot;
+            snapshot.params = job.params;
+            snapshot.progress = progress;
+            snapshot.outputRecords = writer.getPointsWritten();
+            checkpoints->submit(snapshot);
+        };
+    }
+
+    auto sink = [&writer](long long, double, const State& s) {
+        writer.write(s);
+        return true;
+    };
+    if (resume) {
+        result.summary = calculator.continueSimulation(job.params, resume->progress, sink, options);
+        result.resumedFromStep = resume->progress.steps;
+    }
+    else {
+        result.summary = calculator.streamSimulation(job.params, sink, options);
+    }
+    if (!writer.close()) {
+        std::cerr << "Ошибка записи в файл '" << job.outputFile << "' (задание " << job.name << ").\n";
+        result.outputFailed = true;
+    }
+    result.pointsWritten = writer.getPointsWritten();
+}
+
+BatchJobResult BatchRunner::runJob(const BatchJob& job) const {
+    BatchJobResult result;
+
+    auto started = std::chrono::steady_clock::now();
+    std::shared_ptr<const CachedSimulation> cached;
+    if (job.outputFile.empty() && m_cache) {
+        cached = m_cache->find(job.params, SimulationCache::SUMMARY_VARIANT);
+    }
+
+    std::unique_ptr<CheckpointWriter> checkpoints;
+    SimulationCheckpoint checkpoint;
+    const SimulationCheckpoint* resume = nullptr;
+    if (!cached && !m_checkpointDirectory.empty()) {
+        const std::string path = checkpointPath(job);
+        if (loadResumePoint(job, path, checkpoint)) resume = &checkpoint;
+        checkpoints = std::make_unique<CheckpointWriter>(path, m_checkpointInterval);
+    }
+
+    if (cached) {
+        result.summary = cached->summary;
+        result.fromCache = true;
+    }
+    else if (job.outputFile.empty()) {
+        if (checkpoints) {
+            DiscardWriter writer;
+            streamToWriter(job, writer, resume, checkpoints.get(), result);
+        }
+        else {
+            Calculations calculator;
+            result.summary = calculator.runSummary(job.params);
+        }
+        if (m_cache) {
+            CachedSimulation computed;
+            computed.summary = result.summary;
+            m_cache->store(job.params, SimulationCache::SUMMARY_VARIANT, std::move(computed));
+        }
+    }
+    else if (job.format == BatchOutputFormat::Text) {
+        // Если файл траектории не подходит для продолжения, расчет начинается заново
+        std::optional<TrajectoryTextWriter> writer;
+        if (resume) writer.emplace(job.outputFile, static_cast<size_t>(resume->outputRecords));
+        if (!writer || !writer->isOpen()) {
+            resume = nullptr;
+            writer.emplace(job.outputFile);
+        }
+        streamToWriter(job, *writer, resume, checkpoints.get(), result);
+    }
+    else {
+        std::optional<TrajectoryBinaryWriter> writer;
+        if (resume) writer.emplace(job.outputFile, static_cast<size_t>(resume->outputRecords));
+        if (!writer || !writer->isOpen()) {
+            resume = nullptr;
+            // Для адаптивного шага записи неравномерны по времени, dt в заголовке - 0
+            double recordDt = isFixedStepIntegrator(job.params.INTEGRATOR) ? job.params.DT * job.stride : 0.0;
+            writer.emplace(job.outputFile, job.params, recordDt, 4,
+                job.format == BatchOutputFormat::BinaryFloat ? TrajectoryPrecision::Float : TrajectoryPrecision::Double);
+        }
+        streamToWriter(job, *writer, resume, checkpoints.get(), result);
+    }
+    // Контрольная точка остается только у задания, которое не удалось завершить
+    if (checkpoints) checkpoints->finish(!result.outputFailed);
+    if (result.outputFailed) return result;
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    if (result.wallSeconds > 0.0 && !result.fromCache) {
+        result.stepsPerSecond = (result.summary.steps - result.resumedFromStep) / result.wallSeconds;
+    }
+    return result;
+}
+
+void BatchRunner::printReport(std::ostream& out, const std::vector<BatchJob>& jobs,
+    const std::vector<BatchJobResult>& results, double totalWallSeconds) {
+    long long totalSteps = 0;
+    out << std::left << std::setw(20) << "job" << std::right
+        << std::setw(14) << "steps" << std::setw(12) << "time, s" << std::setw(16) << "steps/s"
+        << std::setw(10) << "impact" << "  output\n";
+    for (size_t i = 0; i < jobs.size() && i < results.size(); ++i) {
+        const BatchJobResult& r = results[i];
+        // Итоговая скорость - только по шагам, выполненным в этом запуске
+        if (!r.fromCache) totalSteps += r.summary.steps - r.resumedFromStep;
+        out << std::left << std::setw(20) << jobs[i].name << std::right
+            << std::setw(14) << r.summary.steps
+            << std::setw(12) << std::fixed << std::setprecision(3) << r.wallSeconds
+            << std::setw(16) << std::setprecision(0) << r.stepsPerSecond
+            << std::setw(10) << r.summary.impactStep << "  ";
+        if (r.outputFailed) out << "ошибка записи в " << jobs[i].outputFile;
+        else if (!jobs[i].outputFile.empty()) out << jobs[i].outputFile << " (" << r.pointsWritten << " точек)";
+        else out << "-";
+        if (r.summary.stepFailure) out << " (адаптивный шаг не сходится, расчет остановлен)";
+        if (r.fromCache) out << " (кэш)";
+        if (r.resumedFromStep > 0) out << " (продолжено с шага " << r.resumedFromStep << ")";
+        out << "\n";
+    }
+    out << "Всего: " << jobs.size() << " заданий, " << totalSteps << " шагов за "
+        << std::setprecision(3) << totalWallSeconds << " с";
+    if (totalWallSeconds > 0.0) {
+        out << " (" << std::setprecision(0) << totalSteps / totalWallSeconds << " шагов/с)";
+    }
+    out << "\n";
+}
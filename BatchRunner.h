@@ -0,0 +1,101 @@
+﻿#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include "Calculations.h"
+#include "SimulationCache.h"
+#include "SimulationCheckpoint.h"
+#include "ThreadPool.h"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Одно задание пакетного режима.
+// Строка файла заданий - набор пар ключ=значение через пробел, например:
+//   name=orbit1 M=1 k=0.05 F=0 V0=0.8 T=100 dt=0.001 integrator=rk4 out=orbit1.txt stride=10
+// Ключи: name, G, M, radius, k (сопротивление), F (тяга), J2 (сжатие тела),
+// gx, gy (постоянное внешнее поле), x, y, vx, vy (или V0), T, dt, steps,
+// integrator (rk4 | dp45 | verlet | yoshida4 | yoshida6), rtol, atol, out (файл траектории), stride (шаг прореживания при записи),
+// format (text | binary | binary32 - формат файла траектории, см. TrajectoryIO.h).
+// Пустые строки и строки, начинающиеся с '#', пропускаются
+enum class BatchOutputFormat {
+    Text,
+    Binary,     // Бинарный формат, double
+    BinaryFloat // Бинарный формат, float
+};
+
+struct BatchJob {
+    std::string name;
+    SimulationParameters params;
+    std::string outputFile; // Пусто - траектория не сохраняется, считается только сводка
+    BatchOutputFormat format = BatchOutputFormat::Text;
+    long long stride = 1;
+    int lineNumber = 0;
+};
+
+// Результат выполнения задания
+struct BatchJobResult {
+    SimulationSummary summary;
+    double wallSeconds = 0.0;
+    double stepsPerSecond = 0.0;
+    size_t pointsWritten = 0;
+    bool outputFailed = false;
+    bool fromCache = false; // Сводка взята из кэша результатов без расчета
+    long long resumedFromStep = 0; // Расчет продолжен с контрольной точки после этого шага; 0 - с начала
+};
+
+// Пакетный запуск симуляций без графического интерфейса: задания выполняются параллельно на всех ядрах
+class BatchRunner {
+public:
+    // threadCount == 0 - по числу аппаратных потоков машины
+    explicit BatchRunner(unsigned int threadCount = 0);
+
+    // Кэш результатов для заданий без файла траектории: повторяющиеся наборы параметров
+    // (в одном пакете или, при кэше с каталогом, между запусками) не пересчитываются.
+    // Кэш не принадлежит BatchRunner и должен существовать, пока выполняется run; nullptr - без кэша
+    void setResultCache(SimulationCache* cache) { m_cache = cache; }
+
+    // Контрольные точки: не реже чем раз в intervalSeconds состояние каждого выполняемого задания
+    // сохраняется в файл <directory>/<name>.checkpoint. Если при следующем запуске файл задания с теми же
+    // параметрами найден, расчет продолжается с него (файл траектории обрезается до сохраненного
+    // в контрольной точке числа записей) и дает те же результаты, что и без остановки. После успешного
+    // завершения задания файл удаляется. Пустой каталог - без контрольных точек
+    bool setCheckpointing(const std::string& directory, double intervalSeconds);
+
+    // Разбор файла заданий. Ошибочные строки выводятся в std::cerr с номером строки и пропускаются
+    static std::vector<BatchJob> parseJobs(std::istream& input);
+
+    // Разбор одной строки; при ошибке возвращает false и описание в error
+    static bool parseJobLine(const std::string& line, BatchJob& job, std::string& error);
+
+    // Выполнить задания; i-й результат соответствует i-му заданию
+    std::vector<BatchJobResult> run(const std::vector<BatchJob>& jobs);
+
+    // Таблица с временем и скоростью (шагов в секунду) для каждого задания
+    static void printReport(std::ostream& out, const std::vector<BatchJob>& jobs,
+        const std::vector<BatchJobResult>& results, double totalWallSeconds);
+
+    unsigned int getThreadCount() const { return m_pool.getThreadCount(); }
+
+private:
+    // Как часто (в шагах) поток интегрирования проверяет, не пора ли сохранить контрольную точку
+    static constexpr long long CHECKPOINT_POLL_STEPS = 4096;
+
+    BatchJobResult runJob(const BatchJob& job) const;
+    // Файл контрольной точки: имя задания из безопасных символов и хэш параметров расчета и вывода,
+    // поэтому задания с одинаковыми именами не делят файл, а имена с '/' или '..' не выходят из каталога
+    std::string checkpointPath(const BatchJob& job) const;
+    // Загрузить контрольную точку задания; false - ее нет или она от других параметров задания
+    static bool loadResumePoint(const BatchJob& job, const std::string& path, SimulationCheckpoint& checkpoint);
+
+    template <typename Writer>
+    static void streamToWriter(const BatchJob& job, Writer& writer, const SimulationCheckpoint* resume,
+        CheckpointWriter* checkpoints, BatchJobResult& result);
+
+    ThreadPool m_pool;
+    SimulationCache* m_cache = nullptr;
+    std::string m_checkpointDirectory;
+    double m_checkpointInterval = 0.0;
+};
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,73 @@
+﻿// Замеры производительности: TrajectoryBench [--filter подстрока] [--repetitions N] [--quick] [--threads N]
+//                                           [--json файл | --json -] [--list]
+// Таблица результатов выводится в stdout, JSON (--json) - в файл или в stdout вместо таблицы.
+
+#include "BenchmarkSuite.h"
+
+#include <clocale>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    setlocale(LC_ALL, "Rus");
+
+    BenchmarkOptions options;
+    std::string jsonFile;
+    bool listOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        }
+        else if (arg == "--repetitions" && i + 1 < argc) {
+            options.repetitions = std::atoi(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            options.threadCount = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--json" && i + 1 < argc) {
+            jsonFile = argv[++i];
+        }
+        else if (arg == "--quick") {
+            options.quick = true;
+        }
+        else if (arg == "--list") {
+            listOnly = true;
+        }
+        else {
+            std::cout << "Использование: " << argv[0]
+                << " [--filter подстрока] [--repetitions N] [--quick] [--threads N] [--json файл | --json -] [--list]\n";
+            return (arg == "--help" || arg == "-h") ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    try {
+        BenchmarkSuite suite(options);
+        if (listOnly) {
+            for (const auto& name : suite.names()) std::cout << name << "\n";
+            return EXIT_SUCCESS;
+        }
+
+        std::vector<BenchmarkResult> results = suite.run();
+        if (jsonFile == "-") {
+            BenchmarkSuite::writeJson(std::cout, results, options);
+            return EXIT_SUCCESS;
+        }
+        BenchmarkSuite::printReport(std::cout, results);
+        if (!jsonFile.empty()) {
+            std::ofstream output(jsonFile);
+            if (!output.is_open()) {
+                std::cerr << "Ошибка: не удалось открыть файл '" << jsonFile << "' для записи.\n";
+                return EXIT_FAILURE;
+            }
+            BenchmarkSuite::writeJson(output, results, options);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Standard Exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
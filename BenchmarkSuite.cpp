@@ -0,0 +1,470 @@
+﻿#include "BenchmarkSuite.h"
+#include "AllocationCounter.h"
+
+#include "Calculations.h"
+#include "CompressedTrajectory.h"
+#include "ContinuousTrajectory.h"
+#include "EnsembleIntegrator.h"
+#include "NBodySimulation.h"
+#include "PararealIntegrator.h"
+#include "TrajectoryIO.h"
+#include "TrajectoryLod.h"
+
+#include <algorithm>
+#include <charconv> // Для std::to_chars (не зависит от setlocale)
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>   // Для std::remove
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Результат работы складывается сюда, чтобы компилятор не выбросил замеряемый код
+    volatile double g_sink = 0.0;
+
+    // Тот же генератор xorshift32, что и в NBodySimulation::makeDisk: одинаковая последовательность на всех платформах
+    uint32_t nextRandom(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Пресеты параметров. Ни один не заканчивается столкновением, поэтому число шагов не зависит от версии
+    SimulationParameters preset(const std::string& name, int steps) {
+        SimulationParameters params;
+        params.DT = 0.001;
+        params.STEPS = steps;
+        params.DRAG_COEFFICIENT = 0.0;
+        params.initialState.vy = std::sqrt(params.G * params.M / params.initialState.x); // Круговая орбита
+        if (name == "drag") {
+            params.DRAG_COEFFICIENT = 0.002;
+            params.THRUST_COEFFICIENT = 0.001;
+        }
+        else if (name == "j2_field") {
+            params.J2_COEFFICIENT = 1e-3;
+            params.EXTERNAL_FIELD_X = 1e-4;
+            params.EXTERNAL_FIELD_Y = -5e-5;
+        }
+        return params;
+    }
+
+    // Запись сжатой траектории в поток и чтение обратно должны восстановить те же записи.
+    // Расхождение - ошибка формата, а не замера, поэтому замеры прерываются исключением
+    void checkRoundTrip(const CompressedTrajectory& trajectory, const char* name) {
+        std::stringstream stream;
+        CompressedTrajectory copy;
+        bool same = trajectory.write(stream) && copy.read(stream) && copy.size() == trajectory.size();
+        if (same) {
+            std::vector<std::pair<double, State>> records;
+            records.reserve(trajectory.size());
+            trajectory.forEach(0, trajectory.size(),
+                [&records](size_t, double t, const State& s) { records.emplace_back(t, s); });
+            copy.forEach(0, copy.size(), [&records, &same](size_t index, double t, const State& s) {
+                const std::pair<double, State>& record = records[index];
+                same = same && record.first == t && record.second.x == s.x && record.second.y == s.y
+                    && record.second.vx == s.vx && record.second.vy == s.vy;
+            });
+        }
+        if (!same) {
+            throw std::runtime_error(std::string("сжатая траектория '") + name + "' не читается обратно после записи");
+        }
+    }
+
+    std::string tempFilePath(const char* name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    void appendNumber(std::string& out, double value) {
+        char buffer[64];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    void appendString(std::string& out, const std::string& value) {
+        out += '"';
+        for (char c : value) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        out += '"';
+    }
+}
+
+BenchmarkSuite::BenchmarkSuite(const BenchmarkOptions& options)
+    : m_options(options) {
+    if (m_options.repetitions < 1) m_options.repetitions = 1;
+    registerCases();
+}
+
+void BenchmarkSuite::add(const std::string& name, const std::string& unit, Body body,
+    std::function<void()> setup, std::function<void()> teardown) {
+    m_cases.push_back({ name, unit, std::move(setup), std::move(body), std::move(teardown) });
+}
+
+void BenchmarkSuite::registerCases() {
+    const bool quick = m_options.quick;
+    const int solverSteps = quick ? 100000 : 1000000;
+    const int ensembleSteps = quick ? 10000 : 100000;
+    const size_t pointCount = quick ? 100000 : 1000000;
+    const size_t bodyCount = quick ? 10000 : 100000;
+    const unsigned int threadCount = m_options.threadCount;
+
+    // --- Интеграторы: шаги без хранения траектории ---
+    const std::pair<const char*, IntegratorType> integrators[] = {
+        { "rk4", IntegratorType::RungeKutta4 }, { "dp45", IntegratorType::DormandPrince45 },
+        { "verlet", IntegratorType::VelocityVerlet }, { "yoshida4", IntegratorType::Yoshida4 },
+        { "yoshida6", IntegratorType::Yoshida6 } };
+    for (const auto& integrator : integrators) {
+        SimulationParameters params = preset("circular", solverSteps);
+        params.INTEGRATOR = integrator.second;
+        add(std::string("solver/circular/") + integrator.first, "step", [params]() {
+            Calculations calculator;
+            SimulationSummary summary = calculator.runSummary(params);
+            g_sink = g_sink + summary.finalState.x;
+            return summary.steps;
+        });
+    }
+    for (const char* name : { "drag", "j2_field" }) {
+        SimulationParameters params = preset(name, solverSteps);
+        add(std::string("solver/") + name + "/rk4", "step", [params]() {
+            Calculations calculator;
+            SimulationSummary summary = calculator.runSummary(params);
+            g_sink = g_sink + summary.finalState.x;
+            return summary.steps;
+        });
+    }
+
+    // --- Хранение траектории ---
+    {
+        SimulationParameters params = preset("circular", solverSteps);
+        add("store/run_simulation/rk4", "step", [params]() {
+            Calculations calculator;
+            std::vector<State> states = calculator.runSimulation(params);
+            g_sink = g_sink + states.back().x;
+            return static_cast<long long>(states.size() - 1);
+        });
+        add("store/continuous_trajectory/rk4", "step", [params]() {
+            ContinuousTrajectory trajectory = ContinuousTrajectory::simulate(params);
+            g_sink = g_sink + trajectory.endTime();
+            return static_cast<long long>(trajectory.nodeCount() - 1);
+        });
+    }
+
+    // --- Ансамбль из 64 траекторий с разными начальными скоростями ---
+    {
+        std::vector<SimulationParameters> sets(64, preset("circular", ensembleSteps));
+        for (size_t i = 0; i < sets.size(); ++i) {
+            sets[i].initialState.vy *= 0.9 + 0.2 * static_cast<double>(i) / static_cast<double>(sets.size());
+        }
+        add("solver/ensemble_x64/rk4", "step", [sets]() {
+            EnsembleIntegrator integrator;
+            long long steps = 0;
+            for (const auto& summary : integrator.run(sets)) {
+                steps += summary.steps;
+                g_sink = g_sink + summary.finalState.x;
+            }
+            return steps;
+        });
+    }
+
+    // --- Одна длинная траектория, параллельно по времени (сравнивать с solver/drag/rk4) ---
+    {
+        SimulationParameters params = preset("drag", solverSteps);
+        auto integrator = std::make_shared<std::unique_ptr<PararealIntegrator>>();
+        add("solver/parareal/drag/rk4", "step", [params, integrator]() {
+            SimulationSummary summary = (*integrator)->runSummary(params);
+            g_sink = g_sink + summary.finalState.x;
+            return summary.steps;
+        }, [integrator, threadCount]() {
+            *integrator = std::make_unique<PararealIntegrator>(threadCount);
+        }, [integrator]() { integrator->reset(); });
+    }
+
+    // --- Общие данные для файловых замеров и подготовки отрисовки ---
+    struct PointData {
+        SimulationParameters params;
+        std::vector<State> states;
+        WorldTrajectoryData points;
+    };
+    auto data = std::make_shared<PointData>();
+    data->params = preset("drag", static_cast<int>(pointCount - 1));
+    auto prepareData = [data]() {
+        if (!data->states.empty()) return;
+        Calculations calculator;
+        data->states = calculator.runSimulation(data->params);
+        data->points.reserve(data->states.size());
+        for (const auto& s : data->states) data->points.emplace_back(s.x, s.y);
+    };
+
+    // --- Файлы траектории ---
+    const std::string textPath = tempFilePath("trajectory_bench.txt");
+    const std::string binaryPath = tempFilePath("trajectory_bench.bin");
+    add("io/text_write", "point", [data, textPath]() {
+        TrajectoryTextWriter writer(textPath);
+        for (const auto& point : data->points) writer.write(point.first, point.second);
+        writer.close();
+        return static_cast<long long>(writer.getPointsWritten());
+    }, prepareData);
+    add("io/text_parse", "point", [textPath, threadCount]() {
+        TextTrajectoryParseResult parsed;
+        parseTrajectoryTextFile(textPath, parsed, threadCount);
+        if (!parsed.points.empty()) g_sink = g_sink + parsed.points.back().first;
+        return static_cast<long long>(parsed.points.size());
+    }, [data, textPath, prepareData]() {
+        prepareData();
+        TrajectoryTextWriter writer(textPath);
+        for (const auto& point : data->points) writer.write(point.first, point.second);
+    }, [textPath]() { std::remove(textPath.c_str()); });
+    add("io/binary_write", "point", [data, binaryPath]() {
+        TrajectoryBinaryWriter writer(binaryPath, data->params, data->params.DT);
+        for (const auto& state : data->states) writer.write(state);
+        writer.close();
+        return static_cast<long long>(writer.getPointsWritten());
+    }, prepareData);
+    add("io/binary_read_mapped", "point", [binaryPath]() {
+        MappedTrajectoryFile file;
+        std::string error;
+        if (!file.open(binaryPath, error)) return 0LL;
+        double sum = 0.0;
+        for (size_t i = 0; i < file.size(); ++i) sum += file.x(i) + file.y(i);
+        g_sink = g_sink + sum;
+        return static_cast<long long>(file.size());
+    }, [data, binaryPath, prepareData]() {
+        prepareData();
+        TrajectoryBinaryWriter writer(binaryPath, data->params, data->params.DT);
+        for (const auto& state : data->states) writer.write(state);
+    }, [binaryPath]() { std::remove(binaryPath.c_str()); });
+
+    // --- Подготовка отрисовки: то, что делают prepareTrajectoryForDisplay и selectDisplayLevel ---
+    auto lod = std::make_shared<TrajectoryLod>();
+    add("render/lod_build", "point", [data, lod]() {
+        lod->build(data->points.size(), [&data](size_t i) { return data->points[i]; });
+        g_sink = g_sink + static_cast<double>(lod->levelCount());
+        return static_cast<long long>(data->points.size());
+    }, prepareData);
+    add("render/lod_vertices", "vertex", [lod]() {
+        // Вершины float для 16 масштабов от общего вида до сильного увеличения
+        struct Vertex { float x, y; };
+        std::vector<Vertex> vertices;
+        long long produced = 0;
+        const double span = std::max(lod->bounds().maxX - lod->bounds().minX, lod->bounds().maxY - lod->bounds().minY);
+        for (int zoom = 0; zoom < 16; ++zoom) {
+            const double pixelsPerUnit = 800.0 / span * std::pow(2.0, zoom);
+            const int level = lod->selectLevel(pixelsPerUnit);
+            if (level < 0) continue; // Исходные точки копируются так же, как в render/lod_build
+            const auto& points = lod->level(static_cast<size_t>(level)).points;
+            vertices.clear();
+            vertices.reserve(points.size());
+            for (const auto& point : points) {
+                vertices.push_back({ static_cast<float>(point.first), static_cast<float>(-point.second) });
+            }
+            produced += static_cast<long long>(vertices.size());
+        }
+        return produced;
+    }, [data, lod, prepareData]() {
+        prepareData();
+        lod->build(data->points.size(), [&data](size_t i) { return data->points[i]; });
+    });
+
+    // --- Таблица: строки видимого окна из непрерывной траектории и их форматирование ---
+    auto trajectory = std::make_shared<ContinuousTrajectory>();
+    add("table/visible_rows", "row", [data, trajectory]() {
+        constexpr size_t WINDOW_ROWS = 40;
+        constexpr int SCROLLS = 2000;
+        const size_t rowCount = data->states.size();
+        uint32_t random = 12345;
+        char buffer[64];
+        size_t characters = 0;
+        for (int scroll = 0; scroll < SCROLLS; ++scroll) {
+            const size_t firstRow = nextRandom(random) % (rowCount - WINDOW_ROWS);
+            for (size_t row = firstRow; row < firstRow + WINDOW_ROWS; ++row) {
+                const double time = static_cast<double>(row) * data->params.DT;
+                const State state = trajectory->stateAt(time);
+                for (double value : { time, state.x, state.y, state.vx, state.vy }) {
+                    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 2);
+                    characters += static_cast<size_t>(result.ptr - buffer);
+                }
+            }
+        }
+        g_sink = g_sink + static_cast<double>(characters);
+        return static_cast<long long>(SCROLLS) * static_cast<long long>(WINDOW_ROWS);
+    }, [data, trajectory, prepareData]() {
+        prepareData();
+        StreamOptions options;
+        options.maxSamples = 1 << 18; // Как в интерфейсе: узлы прорежены, строки интерполируются
+        *trajectory = ContinuousTrajectory::simulate(data->params, options);
+    });
+
+    // --- Сжатие траектории ---
+    auto compressed = std::make_shared<CompressedTrajectory>();
+    add("compress/encode", "point", [data, compressed]() {
+        compressed->clear();
+        for (size_t i = 0; i < data->states.size(); ++i) {
+            compressed->append(static_cast<double>(i) * data->params.DT, data->states[i]);
+        }
+        return static_cast<long long>(compressed->size());
+    }, prepareData);
+    add("compress/decode", "point", [compressed]() {
+        double sum = 0.0;
+        compressed->forEach(0, compressed->size(), [&sum](size_t, double, const State& s) { sum += s.x; });
+        g_sink = g_sink + sum;
+        return static_cast<long long>(compressed->size());
+    }, [data, compressed, prepareData]() {
+        prepareData();
+        compressed->clear();
+        for (size_t i = 0; i < data->states.size(); ++i) {
+            compressed->append(static_cast<double>(i) * data->params.DT, data->states[i]);
+        }
+    });
+
+    add("compress/serialize", "point", [compressed]() {
+        std::stringstream stream;
+        compressed->write(stream);
+        CompressedTrajectory copy;
+        copy.read(stream);
+        return static_cast<long long>(copy.size());
+    }, [data, compressed, prepareData]() {
+        prepareData();
+        compressed->clear();
+        for (size_t i = 0; i < data->states.size(); ++i) {
+            compressed->append(static_cast<double>(i) * data->params.DT, data->states[i]);
+        }
+        checkRoundTrip(*compressed, "drag");
+        // Неподвижная точка: остатки по одному байту, а первая запись блока байтов не занимает,
+        // поэтому граница блока - худший случай для проверки размера при чтении
+        const size_t CHUNK = CompressedTrajectory::CHUNK_SIZE;
+        const auto& initial = data->params.initialState;
+        const State point = { initial.x, initial.y, initial.vx, initial.vy };
+        for (size_t count : { CHUNK, CHUNK + 1, 2 * CHUNK + 1, 3 * CHUNK - 1 }) {
+            CompressedTrajectory stationary;
+            for (size_t i = 0; i < count; ++i) {
+                stationary.append(static_cast<double>(i) * data->params.DT, point);
+            }
+            checkRoundTrip(stationary, "stationary");
+        }
+    });
+
+    // --- N тел: шаг с деревом Барнса-Хата ---
+    auto nbody = std::make_shared<std::unique_ptr<NBodySimulation>>();
+    const int nbodySteps = 2;
+    add("nbody/barnes_hut_step", "body-step", [nbody, nbodySteps]() {
+        NBodySimulation& simulation = **nbody;
+        for (int i = 0; i < nbodySteps; ++i) simulation.step();
+        g_sink = g_sink + simulation.body(1).state.x;
+        return static_cast<long long>(simulation.bodyCount()) * nbodySteps;
+    }, [nbody, bodyCount, threadCount]() {
+        *nbody = std::make_unique<NBodySimulation>(threadCount);
+        NBodyParameters params;
+        params.DT = 1e-4;
+        (*nbody)->setParameters(params);
+        (*nbody)->setBodies(NBodySimulation::makeDisk(bodyCount, 1.0, 0.2, 1.0, params.G, 1));
+    }, [nbody]() { nbody->reset(); });
+}
+
+std::vector<std::string> BenchmarkSuite::names() const {
+    std::vector<std::string> result;
+    for (const auto& benchmark : m_cases) result.push_back(benchmark.name);
+    return result;
+}
+
+BenchmarkResult BenchmarkSuite::measure(const Case& benchmark) const {
+    BenchmarkResult result;
+    result.name = benchmark.name;
+    result.unit = benchmark.unit;
+    result.repetitions = m_options.repetitions;
+
+    if (benchmark.setup) benchmark.setup();
+    benchmark.body(); // Разогрев: кэши, страницы памяти, первые выделения
+
+    std::vector<double> seconds;
+    seconds.reserve(static_cast<size_t>(m_options.repetitions));
+    const long long allocationsBefore = allocationCount();
+    const long long bytesBefore = allocatedBytes();
+    for (int i = 0; i < m_options.repetitions; ++i) {
+        auto started = Clock::now();
+        result.items = benchmark.body();
+        seconds.push_back(std::chrono::duration<double>(Clock::now() - started).count());
+    }
+    // Учитываются и выделения самого вектора seconds - он зарезервирован заранее, поэтому их нет
+    result.allocations = (allocationCount() - allocationsBefore) / m_options.repetitions;
+    result.allocatedBytes = (allocatedBytes() - bytesBefore) / m_options.repetitions;
+    if (benchmark.teardown) benchmark.teardown();
+
+    std::sort(seconds.begin(), seconds.end());
+    result.minSeconds = seconds.front();
+    result.medianSeconds = seconds[seconds.size() / 2];
+    if (result.items > 0) result.nsPerItem = result.medianSeconds * 1e9 / static_cast<double>(result.items);
+    if (result.medianSeconds > 0.0) result.itemsPerSecond = static_cast<double>(result.items) / result.medianSeconds;
+    return result;
+}
+
+std::vector<BenchmarkResult> BenchmarkSuite::run() {
+    std::vector<BenchmarkResult> results;
+    for (const auto& benchmark : m_cases) {
+        if (!m_options.filter.empty() && benchmark.name.find(m_options.filter) == std::string::npos) continue;
+        std::cerr << "Замер " << benchmark.name << "...\n";
+        results.push_back(measure(benchmark));
+    }
+    return results;
+}
+
+void BenchmarkSuite::printReport(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    out << std::left << std::setw(34) << "benchmark" << std::right
+        << std::setw(12) << "items" << std::setw(12) << "median, s" << std::setw(12) << "ns/item"
+        << std::setw(16) << "items/s" << std::setw(12) << "allocs" << std::setw(14) << "alloc bytes" << "\n";
+    for (const auto& r : results) {
+        out << std::left << std::setw(34) << r.name << std::right
+            << std::setw(12) << r.items
+            << std::setw(12) << std::fixed << std::setprecision(4) << r.medianSeconds
+            << std::setw(12) << std::setprecision(1) << r.nsPerItem
+            << std::setw(16) << std::setprecision(0) << r.itemsPerSecond
+            << std::setw(12) << r.allocations
+            << std::setw(14) << r.allocatedBytes << "\n";
+    }
+}
+
+void BenchmarkSuite::writeJson(std::ostream& out, const std::vector<BenchmarkResult>& results, const BenchmarkOptions& options) {
+    std::string json = "{\n  \"schema_version\": 1,\n  \"compiler\": ";
+#if defined(_MSC_VER)
+    appendString(json, "MSVC " + std::to_string(_MSC_VER));
+#elif defined(__VERSION__)
+    appendString(json, __VERSION__);
+#else
+    appendString(json, "unknown");
+#endif
+#ifdef NDEBUG
+    json += ",\n  \"optimized\": true";
+#else
+    json += ",\n  \"optimized\": false";
+#endif
+    json += ",\n  \"quick\": ";
+    json += options.quick ? "true" : "false";
+    json += ",\n  \"repetitions\": " + std::to_string(options.repetitions);
+    json += ",\n  \"threads\": " + std::to_string(options.threadCount);
+    json += ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        json += (i == 0) ? "\n    {" : ",\n    {";
+        json += "\"name\": "; appendString(json, r.name);
+        json += ", \"unit\": "; appendString(json, r.unit);
+        json += ", \"items\": " + std::to_string(r.items);
+        json += ", \"repetitions\": " + std::to_string(r.repetitions);
+        json += ", \"min_seconds\": "; appendNumber(json, r.minSeconds);
+        json += ", \"median_seconds\": "; appendNumber(json, r.medianSeconds);
+        json += ", \"ns_per_item\": "; appendNumber(json, r.nsPerItem);
+        json += ", \"items_per_second\": "; appendNumber(json, r.itemsPerSecond);
+        json += ", \"allocations\": " + std::to_string(r.allocations);
+        json += ", \"allocated_bytes\": " + std::to_string(r.allocatedBytes);
+        json += "}";
+    }
+    json += "\n  ]\n}\n";
+    out << json;
+}
@@ -0,0 +1,69 @@
+﻿#ifndef BENCHMARKSUITE_H
+#define BENCHMARKSUITE_H
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Настройки запуска замеров
+struct BenchmarkOptions {
+    std::string filter;       // Выполнять только замеры, в имени которых есть эта подстрока
+    int repetitions = 5;      // Повторов каждого замера после разогревочного
+    bool quick = false;       // Уменьшенные размеры задач (для проверки, что все работает)
+    unsigned int threadCount = 0; // Для многопоточных замеров; 0 - по числу аппаратных потоков
+};
+
+// Результат одного замера. Время - по медиане повторов, выделения памяти - на один повтор
+struct BenchmarkResult {
+    std::string name;
+    std::string unit;           // Чем измеряется работа: step, point, row, body-step...
+    long long items = 0;        // Единиц работы за один повтор
+    int repetitions = 0;
+    double minSeconds = 0.0;
+    double medianSeconds = 0.0;
+    double nsPerItem = 0.0;
+    double itemsPerSecond = 0.0;
+    long long allocations = 0;
+    long long allocatedBytes = 0;
+};
+
+// Набор воспроизводимых замеров расчетного ядра, разбора файлов и подготовки отрисовки.
+// Входные данные задаются пресетами параметров и фиксированными зернами генераторов, поэтому
+// результаты разных версий сравнимы между собой. Выделения памяти считаются подменой operator new
+// в исполняемом файле замеров
+class BenchmarkSuite {
+public:
+    explicit BenchmarkSuite(const BenchmarkOptions& options);
+
+    std::vector<BenchmarkResult> run();
+
+    // Имена всех замеров (без выполнения)
+    std::vector<std::string> names() const;
+
+    static void printReport(std::ostream& out, const std::vector<BenchmarkResult>& results);
+    // Машиночитаемый отчет для отслеживания регрессий между версиями
+    static void writeJson(std::ostream& out, const std::vector<BenchmarkResult>& results, const BenchmarkOptions& options);
+
+private:
+    // Тело замера выполняет работу один раз и возвращает число выполненных единиц работы
+    using Body = std::function<long long()>;
+
+    struct Case {
+        std::string name;
+        std::string unit;
+        std::function<void()> setup;    // Подготовка данных, не входит в замер
+        Body body;
+        std::function<void()> teardown;
+    };
+
+    void registerCases();
+    void add(const std::string& name, const std::string& unit, Body body,
+        std::function<void()> setup = nullptr, std::function<void()> teardown = nullptr);
+    BenchmarkResult measure(const Case& benchmark) const;
+
+    BenchmarkOptions m_options;
+    std::vector<Case> m_cases;
+};
+
+#endif // BENCHMARKSUITE_H
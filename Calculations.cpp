@@ -1,64 +1,720 @@
 #include "Calculations.h"
+#include "ForceModel.h"
+
+#include <algorithm> // Для std::min, std::max
+#include <limits>
+
+namespace {
+    // Таблица Бутчера метода Дормана-Принса 5(4)
+    constexpr double DP_A[7][6] = {
+        { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+        { 1.0 / 5.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+        { 3.0 / 40.0, 9.0 / 40.0, 0.0, 0.0, 0.0, 0.0 },
+        { 44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0, 0.0, 0.0, 0.0 },
+        { 19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0, 0.0, 0.0 },
+        { 9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0, 0.0 },
+        { 35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0 } // Веса решения 5-го порядка
+    };
+
+    // Разность весов решений 5-го и 4-го порядков (оценка локальной ошибки)
+    constexpr double DP_E[7] = {
+        71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0, -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0
+    };
+
+    // Параметры регулятора шага
+    constexpr double STEP_SAFETY_FACTOR = 0.9;
+    constexpr double STEP_MIN_FACTOR = 0.2;
+    constexpr double STEP_MAX_FACTOR = 5.0;
+
+    // Веса композиций Иошиды (симметричные последовательности шагов Верле)
+    constexpr double YOSHIDA4_WEIGHTS[3] = {
+        1.3512071919596578, -1.7024143839193153, 1.3512071919596578 // 1/(2-2^(1/3)), -2^(1/3)/(2-2^(1/3))
+    };
+    // Решение A из работы Иошиды (1990)
+    constexpr double YOSHIDA6_WEIGHTS[7] = {
+        0.78451361047755726, 0.23557321335935813, -1.1776799841788710, 1.3151863206839112,
+        -1.1776799841788710, 0.23557321335935813, 0.78451361047755726
+    };
+
+    State initialStateFrom(const SimulationParameters& params) {
+        return { params.initialState.x, params.initialState.y, params.initialState.vx, params.initialState.vy };
+    }
+
+    void warnIntegratorFallback(const SimulationParameters& params) {
+        if (isSymplecticIntegrator(params.INTEGRATOR) && Calculations::effectiveIntegrator(params) != params.INTEGRATOR) {
+            std::cerr << "Предупреждение: симплектический интегратор неприменим при ненулевом сопротивлении или тяге, "
+                "используется метод Рунге-Кутты 4-го порядка.\n";
+        }
+    }
+}
+
+class Calculations::NoEvents {
+public:
+    static constexpr bool ACTIVE = false;
+
+    template <class Model>
+    void start(const Model&, double, const State&) {}
+    template <class Model>
+    bool check(const Model&, double, const State&, double, const State&) { return false; }
+
+    double eventTime() const { return 0.0; }
+    State eventState() const { return { 0, 0, 0, 0 }; }
+    int terminalEvent() const { return -1; }
+    long long evaluations() const { return 0; }
+};
+
+class Calculations::EventTracker {
+public:
+    static constexpr bool ACTIVE = true;
+
+    EventTracker(const std::vector<EventFunction>& events, std::vector<EventRecord>& occurred)
+        : m_events(events), m_occurred(occurred), m_values(events.size(), 0.0) {}
+
+    template <class Model>
+    void start(const Model& model, double t, const State& s) {
+        for (size_t i = 0; i < m_events.size(); ++i) {
+            m_values[i] = m_events[i].g(t, s);
+        }
+        m_derivative = model.derivatives(s);
+        ++m_evaluations;
+    }
+
+    // Проверить шаг [t0, t1]. Возвращает true, если сработало завершающее событие
+    template <class Model>
+    bool check(const Model& model, double t0, const State& s0, double t1, const State& s1) {
+        if (m_events.empty()) return false;
+        const State f0 = m_derivative;
+        const State f1 = model.derivatives(s1);
+        ++m_evaluations;
+
+        m_found.clear();
+        for (size_t i = 0; i < m_events.size(); ++i) {
+            const double value = m_events[i].g(t1, s1);
+            if (crosses(m_events[i].direction, m_values[i], value)) {
+                double t = locate(m_events[i], t0, s0, f0, t1, s1, f1, m_values[i], value);
+                m_found.push_back({ i, t, hermiteInterpolate(s0, f0, s1, f1, t1 - t0, (t - t0) / (t1 - t0)) });
+            }
+            m_values[i] = value;
+        }
+        m_derivative = f1;
+        if (m_found.empty()) return false;
+
+        std::sort(m_found.begin(), m_found.end(),
+            [](const EventRecord& a, const EventRecord& b) { return a.t < b.t; });
+        for (const EventRecord& record : m_found) {
+            m_occurred.push_back(record);
+            if (m_events[record.eventIndex].terminal) {
+                m_terminal = static_cast<int>(record.eventIndex);
+                m_eventTime = record.t;
+                m_eventState = record.state;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    double eventTime() const { return m_eventTime; }
+    const State& eventState() const { return m_eventState; }
+    int terminalEvent() const { return m_terminal; }
+    long long evaluations() const { return m_evaluations; }
+
+private:
+    static bool crosses(EventDirection direction, double before, double after) {
+        const bool rising = before < 0.0 && after >= 0.0;
+        const bool falling = before > 0.0 && after <= 0.0;
+        return (direction != EventDirection::Falling && rising) || (direction != EventDirection::Rising && falling);
+    }
+
+    // Метод Иллинойс (регула фальси с делением застрявшего конца) на интерполянте шага.
+    // Возвращается правый конец итогового интервала - первая точка, где знак уже сменился
+    static double locate(const EventFunction& event, double t0, const State& s0, const State& f0,
+        double t1, const State& s1, const State& f1, double before, double after) {
+        const double h = t1 - t0;
+        double a = 0.0, b = h, ga = before, gb = after;
+        int side = 0;
+        for (int iteration = 0; iteration < EVENT_MAX_ITERATIONS && gb != 0.0; ++iteration) {
+            if (b - a <= 4.0 * std::numeric_limits<double>::epsilon() * (std::abs(t0) + std::abs(b))) break;
+            double c = (a * gb - b * ga) / (gb - ga);
+            if (!(c > a && c < b)) c = 0.5 * (a + b);
+            const double gc = event.g(t0 + c, hermiteInterpolate(s0, f0, s1, f1, h, c / h));
+            if ((gc < 0.0) == (ga < 0.0) && gc != 0.0) {
+                a = c; ga = gc;
+                if (side == -1) gb *= 0.5;
+                side = -1;
+            }
+            else {
+                b = c; gb = gc;
+                if (side == 1) ga *= 0.5;
+                side = 1;
+            }
+        }
+        return t0 + b;
+    }
+
+    static constexpr int EVENT_MAX_ITERATIONS = 200;
+
+    const std::vector<EventFunction>& m_events;
+    std::vector<EventRecord>& m_occurred;
+    std::vector<double> m_values;     // Значения функций событий в начале текущего шага
+    std::vector<EventRecord> m_found;
+    State m_derivative = { 0, 0, 0, 0 }; // Производная в начале текущего шага
+    double m_eventTime = 0.0;
+    State m_eventState = { 0, 0, 0, 0 };
+    int m_terminal = -1;
+    long long m_evaluations = 0;
+};
 
 Calculations::Calculations() {
-    //    ,    
+    // Конструктор может быть пустым, если нет специфической инициализации
 }
 
-//     
+// Основной метод для запуска симуляции
 std::vector<State> Calculations::runSimulation(const SimulationParameters& params) {
-    State currentState;
-    currentState.x = params.initialState.x;
-    currentState.y = params.initialState.y;
-    currentState.vx = params.initialState.vx;
-    currentState.vy = params.initialState.vy;
+    std::vector<State> trajectoryStates; // Теперь храним полные состояния
+    if (isFixedStepIntegrator(params.INTEGRATOR)) {
+        trajectoryStates.reserve(static_cast<size_t>(params.STEPS) + 1);
+    }
+    auto collect = [&trajectoryStates](long long, double, const State& s) {
+        trajectoryStates.push_back(s);
+        return true;
+    };
+    warnIntegratorFallback(params);
+    m_lastSummary = integrate(params, collect);
+    reportImpact(m_lastSummary, params);
+    return trajectoryStates;
+}
+
+std::vector<State> Calculations::runSimulation(const SimulationParameters& params, std::vector<double>& sampleTimes) {
+    std::vector<State> trajectoryStates;
+    sampleTimes.clear();
+    if (isFixedStepIntegrator(params.INTEGRATOR)) {
+        trajectoryStates.reserve(static_cast<size_t>(params.STEPS) + 1);
+        sampleTimes.reserve(static_cast<size_t>(params.STEPS) + 1);
+    }
+    auto collect = [&](long long, double t, const State& s) {
+        trajectoryStates.push_back(s);
+        sampleTimes.push_back(t);
+        return true;
+    };
+    warnIntegratorFallback(params);
+    m_lastSummary = integrate(params, collect);
+    reportImpact(m_lastSummary, params);
+    return trajectoryStates;
+}
+
+SimulationSummary Calculations::runSummary(const SimulationParameters& params) {
+    auto ignore = [](long long, double, const State&) { return true; };
+    m_lastSummary = integrate(params, ignore);
+    return m_lastSummary;
+}
+
+std::vector<State> Calculations::runSimulation(const SimulationParameters& params, std::vector<double>& sampleTimes,
+    const std::vector<EventFunction>& events, std::vector<EventRecord>& occurred) {
+    std::vector<State> trajectoryStates;
+    sampleTimes.clear();
+    occurred.clear();
+    if (isFixedStepIntegrator(params.INTEGRATOR)) {
+        trajectoryStates.reserve(static_cast<size_t>(params.STEPS) + 1);
+        sampleTimes.reserve(static_cast<size_t>(params.STEPS) + 1);
+    }
+    auto collect = [&](long long, double t, const State& s) {
+        trajectoryStates.push_back(s);
+        sampleTimes.push_back(t);
+        return true;
+    };
+    EventTracker tracker(events, occurred);
+    warnIntegratorFallback(params);
+    m_lastSummary = integrate(params, collect, tracker);
+    reportImpact(m_lastSummary, params);
+    return trajectoryStates;
+}
+
+SimulationSummary Calculations::runSummary(const SimulationParameters& params, const std::vector<EventFunction>& events,
+    std::vector<EventRecord>& occurred) {
+    occurred.clear();
+    auto ignore = [](long long, double, const State&) { return true; };
+    EventTracker tracker(events, occurred);
+    m_lastSummary = integrate(params, ignore, tracker);
+    return m_lastSummary;
+}
+
+SimulationSummary Calculations::streamSimulation(const SimulationParameters& params, const StateSink& sink,
+    const StreamOptions& options) {
+    return stream(params, sink, options, nullptr);
+}
+
+SimulationSummary Calculations::continueSimulation(const SimulationParameters& params, const SimulationSummary& previous,
+    const StateSink& sink, const StreamOptions& options) {
+    return stream(params, sink, options, &previous);
+}
+
+bool Calculations::sameProblem(const SimulationParameters& a, const SimulationParameters& b) {
+    return a.G == b.G && a.M == b.M && a.CENTRAL_BODY_RADIUS == b.CENTRAL_BODY_RADIUS
+        && a.DRAG_COEFFICIENT == b.DRAG_COEFFICIENT && a.THRUST_COEFFICIENT == b.THRUST_COEFFICIENT
+        && a.J2_COEFFICIENT == b.J2_COEFFICIENT
+        && a.EXTERNAL_FIELD_X == b.EXTERNAL_FIELD_X && a.EXTERNAL_FIELD_Y == b.EXTERNAL_FIELD_Y
+        && a.DT == b.DT && a.INTEGRATOR == b.INTEGRATOR
+        && a.RELATIVE_TOLERANCE == b.RELATIVE_TOLERANCE && a.ABSOLUTE_TOLERANCE == b.ABSOLUTE_TOLERANCE
+        && a.MIN_DT == b.MIN_DT && a.MAX_DT == b.MAX_DT
+        && a.initialState.x == b.initialState.x && a.initialState.y == b.initialState.y
+        && a.initialState.vx == b.initialState.vx && a.initialState.vy == b.initialState.vy;
+}
+
+bool Calculations::canContinue(const SimulationParameters& previousParams, const SimulationSummary& previous,
+    const SimulationParameters& params) {
+    if (!sameProblem(previousParams, params) || params.STEPS <= previousParams.STEPS) return false;
+    if (previous.cancelled || previous.impactStep >= 0 || previous.terminalEvent >= 0 || previous.stepFailure) {
+        return false;
+    }
+    // Расчет дошел до прежнего горизонта: все шаги выполнены (адаптивный метод - до момента DT * STEPS)
+    if (isFixedStepIntegrator(effectiveIntegrator(previousParams))) {
+        return previous.steps == previousParams.STEPS;
+    }
+    return previous.finalTime == previousParams.DT * previousParams.STEPS && previous.nextStepSize > 0.0;
+}
+
+SimulationSummary Calculations::stream(const SimulationParameters& params, const StateSink& sink,
+    const StreamOptions& options, const SimulationSummary* resume) {
+    long long stride = std::max<long long>(1, options.stride);
+    double sampleInterval = 0.0;
+    if (options.maxSamples > 1) {
+        if (isFixedStepIntegrator(params.INTEGRATOR)) {
+            // STEPS + 1 состояний -> не больше maxSamples выданных
+            long long needed = (static_cast<long long>(params.STEPS) + options.maxSamples - 2) / (options.maxSamples - 1);
+            stride = std::max(stride, needed);
+        }
+        else {
+            // Для адаптивного шага число шагов заранее неизвестно, прореживаем по времени
+            sampleInterval = params.DT * params.STEPS / (options.maxSamples - 1);
+        }
+    }
+
+    // Последнее состояние продолжаемого расчета уже выдано им самим
+    long long lastEmittedStep = resume ? resume->steps : -1;
+    double nextSampleTime = resume ? resume->finalTime + sampleInterval : 0.0;
+    auto decimate = [&](long long step, double t, const State& s) {
+        if (step % stride != 0 || t < nextSampleTime) {
+            return true;
+        }
+        lastEmittedStep = step;
+        nextSampleTime = t + sampleInterval;
+        return sink(step, t, s);
+    };
+    IntegrationControl control;
+    control.resume = resume;
+    if (options.checkpoint) {
+        control.checkpointInterval = options.checkpointInterval;
+        control.checkpoint = &options.checkpoint;
+    }
+    NoEvents events;
+    m_lastSummary = integrate(params, decimate, events, control);
+
+    if (options.includeFinal && !m_lastSummary.cancelled && lastEmittedStep != m_lastSummary.steps) {
+        sink(m_lastSummary.steps, m_lastSummary.finalTime, m_lastSummary.finalState);
+    }
+    if (options.reportImpact) {
+        reportImpact(m_lastSummary, params);
+    }
+    return m_lastSummary;
+}
 
-    std::vector<State> trajectoryStates; //    
-    trajectoryStates.reserve(static_cast<size_t>(params.STEPS) + 1);
-    trajectoryStates.push_back(currentState); //   
+void Calculations::reportImpact(const SimulationSummary& summary, const SimulationParameters& params) {
+    if (summary.impactStep == 0) {
+        std::cout << "Столкновение: начальная позиция (" << summary.finalState.x << ", " << summary.finalState.y
+            << ") внутри радиуса центрального тела (" << params.CENTRAL_BODY_RADIUS << ").\n";
+    }
+    else if (summary.impactStep > 0) {
+        std::cout << "Столкновение обнаружено на шаге " << summary.impactStep
+            << " после вычисления. Координаты: (" << summary.finalState.x << ", " << summary.finalState.y
+            << "), r = " << summary.minRadius << "\n";
+    }
+}
+
+IntegratorType Calculations::effectiveIntegrator(const SimulationParameters& params) {
+    // То же условие, по которому dispatchForceModel включает силу, зависящую от скорости
+    if (isSymplecticIntegrator(params.INTEGRATOR)
+        && params.THRUST_COEFFICIENT - params.DRAG_COEFFICIENT != 0.0) {
+        return IntegratorType::RungeKutta4;
+    }
+    return params.INTEGRATOR;
+}
+
+template <class Model>
+class Calculations::RungeKutta4Stepper {
+public:
+    RungeKutta4Stepper(const SimulationParameters& params, const Model& model) : m_dt(params.DT), m_model(model) {}
+
+    State step(const State& s) {
+        m_evaluations += 4;
+        return rungeKuttaStep(s, m_dt, m_model);
+    }
+
+    long long evaluations() const { return m_evaluations; }
+    const Model& model() const { return m_model; }
+
+private:
+    const double m_dt;
+    const Model& m_model;
+    long long m_evaluations = 0;
+};
+
+// Каждый подшаг с весом w - шаг Верле "толчок-сдвиг-толчок" длиной w * DT. Ускорение в конце подшага
+// вычислено в той же точке, что и в начале следующего, поэтому хранится между подшагами и шагами
+template <class Model, size_t Stages>
+class Calculations::SymplecticStepper {
+public:
+    SymplecticStepper(const SimulationParameters& params, const Model& model, const State& initialState,
+        const double (&weights)[Stages])
+        : m_dt(params.DT), m_model(model), m_weights(weights) {
+        m_model.acceleration(initialState.x, initialState.y, m_ax, m_ay);
+        m_evaluations = 1;
+    }
+
+    State step(const State& s) {
+        State next = s;
+        for (size_t i = 0; i < Stages; ++i) {
+            const double h = m_weights[i] * m_dt;
+            next.vx += 0.5 * h * m_ax;
+            next.vy += 0.5 * h * m_ay;
+            next.x += h * next.vx;
+            next.y += h * next.vy;
+            m_model.acceleration(next.x, next.y, m_ax, m_ay);
+            next.vx += 0.5 * h * m_ax;
+            next.vy += 0.5 * h * m_ay;
+        }
+        m_evaluations += Stages;
+        return next;
+    }
+
+    long long evaluations() const { return m_evaluations; }
+    const Model& model() const { return m_model; }
+
+private:
+    const double m_dt;
+    const Model& m_model;
+    const double (&m_weights)[Stages];
+    double m_ax = 0.0, m_ay = 0.0; // Ускорение в текущей точке
+    long long m_evaluations = 0;
+};
+
+template <class Observer>
+SimulationSummary Calculations::integrate(const SimulationParameters& params, Observer& observer) {
+    NoEvents events;
+    return integrate(params, observer, events);
+}
+
+template <class Observer, class Events>
+SimulationSummary Calculations::integrate(const SimulationParameters& params, Observer& observer, Events& events,
+    const IntegrationControl& control) {
+    return dispatchForceModel(params, [&](const auto& model) {
+        return integrateWithModel(params, model, observer, events, control);
+    });
+}
+
+template <class Model, class Observer, class Events>
+SimulationSummary Calculations::integrateWithModel(const SimulationParameters& params, const Model& model,
+    Observer& observer, Events& events, const IntegrationControl& control) {
+    static constexpr double VERLET_WEIGHTS[1] = { 1.0 };
+    const SimulationSummary* resume = control.resume;
+    // Ускорение симплектического метода зависит только от положения, поэтому вычисленное заново
+    // в точке продолжения совпадает с сохраненным бы между шагами
+    const State initialState = resume ? resume->finalState : initialStateFrom(params);
+    switch (effectiveIntegrator(params)) {
+    case IntegratorType::DormandPrince45:
+        return integrateAdaptive(params, model, observer, events, control);
+    case IntegratorType::VelocityVerlet:
+    case IntegratorType::Yoshida4:
+    case IntegratorType::Yoshida6:
+        // Для моделей, зависящих от скорости, effectiveIntegrator уже вернул RungeKutta4
+        if constexpr (!Model::VELOCITY_DEPENDENT) {
+            if (params.INTEGRATOR == IntegratorType::VelocityVerlet) {
+                SymplecticStepper<Model, 1> stepper(params, model, initialState, VERLET_WEIGHTS);
+                return integrateFixedStep(params, stepper, observer, events, control);
+            }
+            if (params.INTEGRATOR == IntegratorType::Yoshida4) {
+                SymplecticStepper<Model, 3> stepper(params, model, initialState, YOSHIDA4_WEIGHTS);
+                return integrateFixedStep(params, stepper, observer, events, control);
+            }
+            SymplecticStepper<Model, 7> stepper(params, model, initialState, YOSHIDA6_WEIGHTS);
+            return integrateFixedStep(params, stepper, observer, events, control);
+        }
+        [[fallthrough]];
+    default: {
+        RungeKutta4Stepper<Model> stepper(params, model);
+        return integrateFixedStep(params, stepper, observer, events, control);
+    }
+    }
+}
+
+template <class Stepper, class Observer, class Events>
+SimulationSummary Calculations::integrateFixedStep(const SimulationParameters& params, Stepper& stepper, Observer& observer,
+    Events& events, const IntegrationControl& control) {
+    const SimulationSummary* resume = control.resume;
+    SimulationSummary summary;
+    State currentState = initialStateFrom(params);
+    double t = 0.0;
+    long long previousEvaluations = 0;
+    bool keepGoing = true;
 
     double initial_r_squared = currentState.x * currentState.x + currentState.y * currentState.y;
-    if (initial_r_squared < params.CENTRAL_BODY_RADIUS * params.CENTRAL_BODY_RADIUS) {
-        std::cout << ":   (" << currentState.x << ", " << currentState.y
-            << ")     (" << params.CENTRAL_BODY_RADIUS << ").\n";
-        return trajectoryStates;
+    double min_r_squared = initial_r_squared;
+    double max_r_squared = initial_r_squared;
+    const double impact_r_squared = params.CENTRAL_BODY_RADIUS * params.CENTRAL_BODY_RADIUS;
+
+    if (resume) {
+        // Продолжение: счетчики и границы расстояния - с конца предыдущего расчета
+        // (sqrt(r * r) == r точно, поэтому границы переносятся без потери)
+        currentState = resume->finalState;
+        t = resume->finalTime;
+        summary.steps = resume->steps;
+        previousEvaluations = resume->derivativeEvaluations;
+        min_r_squared = resume->minRadius * resume->minRadius;
+        max_r_squared = resume->maxRadius * resume->maxRadius;
+    }
+    else {
+        keepGoing = observer(0, 0.0, currentState); // Добавляем начальное состояние
     }
 
-    for (int i = 0; i < params.STEPS; ++i) {
-        currentState = rungeKuttaStep(currentState, params.DT, params); //  params 
+    if (!resume && initial_r_squared < impact_r_squared) {
+        summary.impactStep = 0;
+    }
+    else if (!keepGoing) {
+        summary.cancelled = true;
+    }
+    else {
+        events.start(stepper.model(), t, currentState);
+        for (long long i = summary.steps; i < params.STEPS; ++i) {
+            const State previousState = currentState;
+            const double previousTime = t;
+            currentState = stepper.step(currentState);
+            summary.steps = i + 1;
+            t = summary.steps * params.DT;
+            if (events.check(stepper.model(), previousTime, previousState, t, currentState)) {
+                // Завершающее событие: траектория обрывается в его момент
+                currentState = events.eventState();
+                t = events.eventTime();
+                summary.terminalEvent = events.terminalEvent();
+            }
+
+            double r_squared = currentState.x * currentState.x + currentState.y * currentState.y;
+            min_r_squared = std::min(min_r_squared, r_squared);
+            max_r_squared = std::max(max_r_squared, r_squared);
 
-        trajectoryStates.push_back(currentState); //   
+            keepGoing = observer(summary.steps, t, currentState); // Добавляем полное состояние
 
-        double r_squared = currentState.x * currentState.x + currentState.y * currentState.y;
-        if (r_squared < params.CENTRAL_BODY_RADIUS * params.CENTRAL_BODY_RADIUS) {
-            std::cout << "    " << i + 1
-                << "  . : (" << currentState.x << ", " << currentState.y
-                << "), r = " << std::sqrt(r_squared) << "\n";
-            break;
+            if (r_squared < impact_r_squared) {
+                summary.impactStep = summary.steps;
+                break;
+            }
+            if (!keepGoing) {
+                summary.cancelled = true;
+                break;
+            }
+            if (summary.terminalEvent >= 0) break;
+
+            // После последнего шага продолжать нечего
+            if (summary.steps < params.STEPS && control.checkpointDue(summary.steps)) {
+                SimulationSummary progress = summary;
+                progress.finalState = currentState;
+                progress.finalTime = t;
+                progress.minRadius = std::sqrt(min_r_squared);
+                progress.maxRadius = std::sqrt(max_r_squared);
+                progress.derivativeEvaluations = previousEvaluations + stepper.evaluations() + events.evaluations();
+                (*control.checkpoint)(progress);
+            }
         }
     }
-    return trajectoryStates;
+
+    summary.finalState = currentState;
+    summary.finalTime = t;
+    summary.minRadius = std::sqrt(min_r_squared);
+    summary.maxRadius = std::sqrt(max_r_squared);
+    summary.derivativeEvaluations = previousEvaluations
+        + (summary.steps > (resume ? resume->steps : 0) ? stepper.evaluations() + events.evaluations() : 0);
+    return summary;
 }
 
-//     
-State Calculations::derivatives(const State& s, const SimulationParameters& params) {
-    double r_squared = s.x * s.x + s.y * s.y;
-    if (r_squared == 0) {
-        return { s.vx, s.vy, 0, 0 };
+template <class Model, class Observer, class Events>
+SimulationSummary Calculations::integrateAdaptive(const SimulationParameters& params, const Model& model,
+    Observer& observer, Events& events, const IntegrationControl& control) {
+    const SimulationSummary* resume = control.resume;
+    SimulationSummary summary;
+    State currentState = initialStateFrom(params);
+    bool keepGoing = true;
+
+    double initial_r_squared = currentState.x * currentState.x + currentState.y * currentState.y;
+    double min_r_squared = initial_r_squared;
+    double max_r_squared = initial_r_squared;
+    const double impact_r_squared = params.CENTRAL_BODY_RADIUS * params.CENTRAL_BODY_RADIUS;
+
+    const double totalTime = params.DT * params.STEPS;
+    const double minDt = std::max(params.MIN_DT, 0.0);
+    const double maxDt = (params.MAX_DT > 0.0) ? params.MAX_DT : totalTime;
+    // Шаг не больше нескольких ulp конца интервала почти не сдвигает время: при MIN_DT <= 0 (или меньше
+    // точности t) такой шаг означает, что допуск недостижим, и расчет останавливается
+    const double stallDt = 4.0 * std::numeric_limits<double>::epsilon() * totalTime;
+    double t = 0.0;
+    double dt = std::min(std::max(params.DT, minDt), maxDt);
+    double clampedStep = 0.0; // Шаг, предложенный до укорачивания последнего шага
+
+    if (resume) {
+        currentState = resume->finalState;
+        t = resume->finalTime;
+        summary.steps = resume->steps;
+        summary.derivativeEvaluations = resume->derivativeEvaluations;
+        min_r_squared = resume->minRadius * resume->minRadius;
+        max_r_squared = resume->maxRadius * resume->maxRadius;
+        if (resume->nextStepSize > 0.0) dt = std::min(std::max(resume->nextStepSize, minDt), maxDt);
+    }
+    else {
+        keepGoing = observer(0, 0.0, currentState);
+    }
+
+    if (!resume && initial_r_squared < impact_r_squared) {
+        summary.impactStep = 0;
+    }
+    else if (!keepGoing) {
+        summary.cancelled = true;
     }
-    double r = std::sqrt(r_squared);
-    double r_cubed = r_squared * r;
+    else {
+        State k1 = model.derivatives(currentState);
+        summary.derivativeEvaluations += 1;
+        events.start(model, t, currentState);
+
+        while (t < totalTime) {
+            // Последний шаг укорачиваем, чтобы попасть точно в конец интервала
+            bool lastStep = false;
+            clampedStep = 0.0;
+            if (t + dt >= totalTime) {
+                clampedStep = dt;
+                dt = totalTime - t;
+                lastStep = true;
+            }
+            if (!lastStep && (t + dt == t || dt <= stallDt)) {
+                std::cerr << "Ошибка: шаг адаптивного метода (" << dt << ") меньше точности времени t = " << t
+                    << ", расчет остановлен.\n";
+                summary.stepFailure = true;
+                break;
+            }
+
+            State k7;
+            double errorNorm = 0.0;
+            State nextState = dormandPrinceStep(currentState, k1, dt, params, model, k7, errorNorm);
+            summary.derivativeEvaluations += 6;
+
+            // Новый шаг по классической формуле h * (1 / err)^(1/5) с ограничением изменения
+            double factor = (errorNorm == 0.0) ? STEP_MAX_FACTOR
+                : STEP_SAFETY_FACTOR * std::pow(errorNorm, -0.2);
+            factor = std::min(STEP_MAX_FACTOR, std::max(STEP_MIN_FACTOR, factor));
+
+            // Не конечная ошибка (переполнение или NaN в стадиях) отвергает шаг при любом dt:
+            // шаг уменьшается до MIN_DT, после чего расчет останавливается
+            const bool finiteError = std::isfinite(errorNorm);
+            if (!finiteError && dt <= minDt) {
+                std::cerr << "Ошибка: оценка ошибки адаптивного метода не конечна при t = " << t
+                    << " и минимальном шаге " << dt << ", расчет остановлен.\n";
+                summary.stepFailure = true;
+                break;
+            }
+            if (!finiteError || (errorNorm > 1.0 && dt > minDt)) {
+                // Шаг отвергнут: уменьшаем и повторяем с той же точки
+                dt = std::max(dt * (finiteError ? factor : STEP_MIN_FACTOR), minDt);
+                continue;
+            }
+
+            const State previousState = currentState;
+            const double previousTime = t;
+            t = lastStep ? totalTime : t + dt;
+            currentState = nextState;
+            k1 = k7; // FSAL: производная в конце шага совпадает с первой стадией следующего
+            ++summary.steps;
+            if (events.check(model, previousTime, previousState, t, currentState)) {
+                currentState = events.eventState();
+                t = events.eventTime();
+                summary.terminalEvent = events.terminalEvent();
+            }
+
+            double r_squared = currentState.x * currentState.x + currentState.y * currentState.y;
+            min_r_squared = std::min(min_r_squared, r_squared);
+            max_r_squared = std::max(max_r_squared, r_squared);
+
+            keepGoing = observer(summary.steps, t, currentState);
+
+            if (r_squared < impact_r_squared) {
+                summary.impactStep = summary.steps;
+                break;
+            }
+            if (!keepGoing) {
+                summary.cancelled = true;
+                break;
+            }
+            if (summary.terminalEvent >= 0) break;
+
+            dt = std::min(std::max(dt * factor, minDt), maxDt);
+
+            // Производная k1 в точке продолжения вычисляется заново и совпадает с k7 (FSAL),
+            // поэтому для продолжения достаточно состояния и следующего шага
+            if (!lastStep && control.checkpointDue(summary.steps)) {
+                SimulationSummary progress = summary;
+                progress.finalState = currentState;
+                progress.finalTime = t;
+                progress.minRadius = std::sqrt(min_r_squared);
+                progress.maxRadius = std::sqrt(max_r_squared);
+                progress.derivativeEvaluations += events.evaluations();
+                progress.nextStepSize = dt;
+                (*control.checkpoint)(progress);
+            }
+        }
+        summary.derivativeEvaluations += events.evaluations();
+    }
+
+    // Продолжение начинается с шага, который метод выбрал бы без укорачивания до горизонта
+    summary.nextStepSize = std::max(dt, clampedStep);
+    summary.finalState = currentState;
+    summary.finalTime = t;
+    summary.minRadius = std::sqrt(min_r_squared);
+    summary.maxRadius = std::sqrt(max_r_squared);
+    return summary;
+}
 
-    double common_factor_gravity = -params.G * params.M / r_cubed;
-    double net_propulsion_factor = params.THRUST_COEFFICIENT - params.DRAG_COEFFICIENT;
+State hermiteInterpolate(const State& s0, const State& f0, const State& s1, const State& f1, double h, double theta) {
+    const double theta2 = theta * theta, theta3 = theta2 * theta;
+    const double h00 = 2.0 * theta3 - 3.0 * theta2 + 1.0;
+    const double h10 = (theta3 - 2.0 * theta2 + theta) * h;
+    const double h01 = -2.0 * theta3 + 3.0 * theta2;
+    const double h11 = (theta3 - theta2) * h;
+    return {
+        h00 * s0.x + h10 * f0.x + h01 * s1.x + h11 * f1.x,
+        h00 * s0.y + h10 * f0.y + h01 * s1.y + h11 * f1.y,
+        h00 * s0.vx + h10 * f0.vx + h01 * s1.vx + h11 * f1.vx,
+        h00 * s0.vy + h10 * f0.vy + h01 * s1.vy + h11 * f1.vy
+    };
+}
+
+EventFunction makeImpactEvent(const SimulationParameters& params, bool terminal) {
+    const double radiusSquared = params.CENTRAL_BODY_RADIUS * params.CENTRAL_BODY_RADIUS;
+    return { "impact", [radiusSquared](double, const State& s) { return s.x * s.x + s.y * s.y - radiusSquared; },
+        EventDirection::Falling, terminal };
+}
 
-    double ax = common_factor_gravity * s.x + net_propulsion_factor * s.vx;
-    double ay = common_factor_gravity * s.y + net_propulsion_factor * s.vy;
-    return { s.vx, s.vy, ax, ay };
+EventFunction makePeriapsisEvent() {
+    return { "periapsis", [](double, const State& s) { return s.x * s.vx + s.y * s.vy; }, EventDirection::Rising, false };
 }
 
-//     - 4- 
-State Calculations::rungeKuttaStep(const State& s, double dt, const SimulationParameters& params) {
-    State k1 = derivatives(s, params);
+EventFunction makeApoapsisEvent() {
+    return { "apoapsis", [](double, const State& s) { return s.x * s.vx + s.y * s.vy; }, EventDirection::Falling, false };
+}
+
+EventFunction makeRadiusCrossingEvent(double radius, EventDirection direction, bool terminal) {
+    const double radiusSquared = radius * radius;
+    return { "radius", [radiusSquared](double, const State& s) { return s.x * s.x + s.y * s.y - radiusSquared; },
+        direction, terminal };
+}
+
+// Один шаг интегрирования методом Рунге-Кутты 4-го порядка
+template <class Model>
+State Calculations::rungeKuttaStep(const State& s, double dt, const Model& model) {
+    State k1 = model.derivatives(s);
 
     State s_temp_k2 = {
         s.x + dt * k1.x / 2.0,
@@ -66,7 +722,7 @@ State Calculations::rungeKuttaStep(const State& s, double dt, const SimulationPa
         s.vx + dt * k1.vx / 2.0,
         s.vy + dt * k1.vy / 2.0
     };
-    State k2 = derivatives(s_temp_k2, params);
+    State k2 = model.derivatives(s_temp_k2);
 
     State s_temp_k3 = {
         s.x + dt * k2.x / 2.0,
@@ -74,7 +730,7 @@ State Calculations::rungeKuttaStep(const State& s, double dt, const SimulationPa
         s.vx + dt * k2.vx / 2.0,
         s.vy + dt * k2.vy / 2.0
     };
-    State k3 = derivatives(s_temp_k3, params);
+    State k3 = model.derivatives(s_temp_k3);
 
     State s_temp_k4 = {
         s.x + dt * k3.x,
@@ -82,7 +738,7 @@ State Calculations::rungeKuttaStep(const State& s, double dt, const SimulationPa
         s.vx + dt * k3.vx,
         s.vy + dt * k3.vy
     };
-    State k4 = derivatives(s_temp_k4, params);
+    State k4 = model.derivatives(s_temp_k4);
 
     return {
         s.x + dt / 6.0 * (k1.x + 2.0 * k2.x + 2.0 * k3.x + k4.x),
@@ -90,4 +746,49 @@ State Calculations::rungeKuttaStep(const State& s, double dt, const SimulationPa
         s.vx + dt / 6.0 * (k1.vx + 2.0 * k2.vx + 2.0 * k3.vx + k4.vx),
         s.vy + dt / 6.0 * (k1.vy + 2.0 * k2.vy + 2.0 * k3.vy + k4.vy)
     };
+}
+
+// Один шаг метода Дормана-Принса 5(4)
+template <class Model>
+State Calculations::dormandPrinceStep(const State& s, const State& k1, double dt, const SimulationParameters& params,
+    const Model& model, State& k7, double& errorNorm) {
+    State k[7];
+    k[0] = k1;
+
+    State s_temp = s;
+    for (int stage = 1; stage < 7; ++stage) {
+        s_temp = s;
+        for (int j = 0; j < stage; ++j) {
+            const double a = DP_A[stage][j];
+            s_temp.x += dt * a * k[j].x;
+            s_temp.y += dt * a * k[j].y;
+            s_temp.vx += dt * a * k[j].vx;
+            s_temp.vy += dt * a * k[j].vy;
+        }
+        k[stage] = model.derivatives(s_temp);
+    }
+    // Последняя стадия вычислена в точке решения 5-го порядка
+    k7 = k[6];
+
+    State error = { 0, 0, 0, 0 };
+    for (int j = 0; j < 7; ++j) {
+        error.x += dt * DP_E[j] * k[j].x;
+        error.y += dt * DP_E[j] * k[j].y;
+        error.vx += dt * DP_E[j] * k[j].vx;
+        error.vy += dt * DP_E[j] * k[j].vy;
+    }
+
+    // Среднеквадратичная норма ошибки, отнесенной к допуску по каждой компоненте
+    auto scaled = [&](double err, double before, double after) {
+        double tolerance = params.ABSOLUTE_TOLERANCE
+            + params.RELATIVE_TOLERANCE * std::max(std::abs(before), std::abs(after));
+        return err / tolerance;
+    };
+    double ex = scaled(error.x, s.x, s_temp.x);
+    double ey = scaled(error.y, s.y, s_temp.y);
+    double evx = scaled(error.vx, s.vx, s_temp.vx);
+    double evy = scaled(error.vy, s.vy, s_temp.vy);
+    errorNorm = std::sqrt((ex * ex + ey * ey + evx * evx + evy * evy) / 4.0);
+
+    return s_temp;
 }
\ No newline at end of file
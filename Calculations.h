@@ -3,24 +3,61 @@
 
 #include <vector>
 #include <string>
-#include <cmath>    //  std::sqrt
-#include <iostream> //  std::cerr
+#include <cmath>    // Для std::sqrt
+#include <iostream> // Для std::cerr
+#include <functional>
 
-//      (x, y)
-//        ,   
+// Тип для хранения точек траектории (x, y)
+// Можно вынести в общий заголовочный файл или дублировать, если классы независимы
 // using WorldTrajectoryPoint = std::pair<double, double>;
 // using WorldTrajectoryData = std::vector<WorldTrajectoryPoint>;
 
-//  
+// Метод численного интегрирования
+enum class IntegratorType {
+    RungeKutta4,     // Классический метод Рунге-Кутты 4-го порядка с постоянным шагом DT
+    DormandPrince45, // Вложенный метод Дормана-Принса 5(4) с адаптивным шагом
+    // Симплектические методы с постоянным шагом DT: энергия не дрейфует, а колеблется около начальной,
+    // поэтому на длинных орбитальных расчетах допустим шаг в 5-10 раз больше, чем у RK4.
+    // Применимы только к консервативной задаче: при ненулевых DRAG_COEFFICIENT или THRUST_COEFFICIENT
+    // ускорение зависит от скорости, и вместо них используется RungeKutta4 (см. effectiveIntegrator).
+    // J2 и внешнее поле от скорости не зависят и допустимы
+    VelocityVerlet,  // Скоростной метод Верле, 2-й порядок, одно вычисление ускорения на шаг
+    Yoshida4,        // Композиция Иошиды из 3 шагов Верле, 4-й порядок
+    Yoshida6         // Композиция Иошиды из 7 шагов Верле, 6-й порядок
+};
+
+// Метод с постоянным шагом: состояния выдаются через каждые DT
+inline bool isFixedStepIntegrator(IntegratorType type) {
+    return type != IntegratorType::DormandPrince45;
+}
+
+// Симплектический метод (требует ускорения, зависящего только от положения)
+inline bool isSymplecticIntegrator(IntegratorType type) {
+    return type == IntegratorType::VelocityVerlet || type == IntegratorType::Yoshida4
+        || type == IntegratorType::Yoshida6;
+}
+
+// Параметры симуляции
 struct SimulationParameters {
     double G = 1.0;
     double M = 1.0;
     double CENTRAL_BODY_RADIUS = 0.01;
     double DRAG_COEFFICIENT = 0.05;
     double THRUST_COEFFICIENT = 0.00;
+    double J2_COEFFICIENT = 0.0;    // Сжатие центрального тела (J2), радиус тела - CENTRAL_BODY_RADIUS
+    double EXTERNAL_FIELD_X = 0.0;  // Постоянное внешнее поле (ускорение)
+    double EXTERNAL_FIELD_Y = 0.0;
     double DT = 0.001;
     int STEPS = 100000;
 
+    // Выбор интегратора. Для адаптивного метода время интегрирования равно DT * STEPS,
+    // а DT используется как начальный шаг
+    IntegratorType INTEGRATOR = IntegratorType::RungeKutta4;
+    double RELATIVE_TOLERANCE = 1e-10; // Относительная допустимая локальная ошибка
+    double ABSOLUTE_TOLERANCE = 1e-12; // Абсолютная допустимая локальная ошибка
+    double MIN_DT = 1e-9;              // Минимальный шаг адаптивного метода
+    double MAX_DT = 0.1;               // Максимальный шаг адаптивного метода
+
     struct InitialStateParams {
         double x = 1.5;
         double y = 0.0;
@@ -29,24 +66,210 @@ struct SimulationParameters {
     } initialState;
 };
 
-//  
+// Состояние системы
 struct State {
     double x, y, vx, vy;
 };
 
+// Итоговые характеристики одного запуска (без хранения всей траектории)
+struct SimulationSummary {
+    State finalState = { 0, 0, 0, 0 }; // Последнее вычисленное состояние
+    double finalTime = 0.0;            // Время последнего состояния
+    long long steps = 0;               // Число выполненных (принятых) шагов
+    long long impactStep = -1;         // Шаг столкновения с центральным телом (0 - старт внутри тела, -1 - не было)
+                                       // (проверка после шага; точный момент касания дает событие makeImpactEvent)
+    double minRadius = 0.0;            // Минимальное расстояние до центра по сохраненным состояниям
+    double maxRadius = 0.0;            // Максимальное расстояние до центра
+    long long derivativeEvaluations = 0; // Количество вычислений правой части
+    bool cancelled = false;            // Интегрирование прервано приемником состояний
+    int terminalEvent = -1;            // Номер завершающего события, остановившего интегрирование (-1 - не было)
+    bool stepFailure = false;          // Адаптивный метод остановлен: ошибка шага не конечна даже при MIN_DT
+                                       // или шаг меньше точности представления времени
+    double nextStepSize = 0.0;         // Шаг, с которого адаптивный метод продолжил бы интегрирование
+                                       // (см. continueSimulation); 0 - метод с постоянным шагом
+};
+
+// Направление смены знака функции события
+enum class EventDirection {
+    Any,
+    Rising,  // Из отрицательных значений в неотрицательные
+    Falling  // Из положительных значений в неположительные
+};
+
+// Событие - момент смены знака функции g(t, s). Смена знака ищется на каждом шаге, а ее момент
+// уточняется до машинной точности по эрмитовой интерполяции (плотному выходу) внутри шага.
+// Если знак меняется на одном шаге дважды, событие пропускается: шаг должен быть меньше
+// характерного времени изменения g
+struct EventFunction {
+    std::string name;
+    std::function<double(double t, const State& s)> g;
+    EventDirection direction = EventDirection::Any;
+    bool terminal = false; // Остановить интегрирование в момент события
+};
+
+// Произошедшее событие
+struct EventRecord {
+    size_t eventIndex; // Номер в списке событий
+    double t;
+    State state;
+};
+
+// Стандартные события
+EventFunction makeImpactEvent(const SimulationParameters& params, bool terminal = true); // Касание поверхности центрального тела
+EventFunction makePeriapsisEvent();  // Минимум расстояния: радиальная скорость меняет знак с - на +
+EventFunction makeApoapsisEvent();   // Максимум расстояния: радиальная скорость меняет знак с + на -
+EventFunction makeRadiusCrossingEvent(double radius, EventDirection direction = EventDirection::Any,
+    bool terminal = false);          // Пересечение окружности радиуса radius (Rising - наружу)
+
+// Кубическая эрмитова интерполяция между состояниями s0 и s1, разделенными шагом h, по производным
+// f0 и f1 в концах; theta = (t - t0) / h из [0, 1]. Погрешность O(h^4), как у RK4
+State hermiteInterpolate(const State& s0, const State& f0, const State& s1, const State& f1, double h, double theta);
+
+// Приемник состояний потокового режима: вызывается для каждого выдаваемого состояния
+// (step - номер шага, t - время). Возврат false прерывает интегрирование
+using StateSink = std::function<bool(long long step, double t, const State& s)>;
+
+// Прореживание потокового режима
+struct StreamOptions {
+    long long stride = 1;       // Выдавать каждое stride-е состояние (начальное выдается всегда)
+    long long maxSamples = 0;   // Если > 1, прореживать так, чтобы выдать не больше maxSamples состояний
+    bool includeFinal = true;   // Выдавать последнее состояние, даже если оно не попало в прореживание
+    bool reportImpact = true;   // Выводить в консоль сообщение о столкновении, как runSimulation
+    // Контрольные точки: после каждых checkpointInterval принятых шагов (и выдачи состояния в sink)
+    // в checkpoint передается сводка расчета на этот момент, с которой continueSimulation продолжит его
+    // так же, как он шел бы без остановки. 0 - выключено. Вызывается в потоке интегрирования,
+    // поэтому долгую работу (запись на диск) нужно передавать в другой поток (см. CheckpointWriter)
+    long long checkpointInterval = 0;
+    std::function<void(const SimulationSummary& progress)> checkpoint;
+};
+
 class Calculations {
 public:
-    Calculations(); //   
+    Calculations(); // Конструктор по умолчанию
 
-    //     
+    // Основной метод для запуска симуляции
     std::vector<State> runSimulation(const SimulationParameters& params);
 
+    // То же, но дополнительно заполняет sampleTimes моментами времени каждого сохраненного состояния
+    // (при адаптивном шаге состояния расположены неравномерно по времени)
+    std::vector<State> runSimulation(const SimulationParameters& params, std::vector<double>& sampleTimes);
+
+    // Запуск без сохранения траектории: вычисляются только итоговые характеристики.
+    // В отличие от runSimulation ничего не выводит в консоль, поэтому подходит для массовых запусков
+    SimulationSummary runSummary(const SimulationParameters& params);
+
+    // Потоковый режим: состояния передаются в sink по мере вычисления и не накапливаются,
+    // поэтому расход памяти не зависит от STEPS
+    SimulationSummary streamSimulation(const SimulationParameters& params, const StateSink& sink,
+        const StreamOptions& options = StreamOptions());
+
+    // Продолжение расчета с конца previous: завершенного расчета с меньшим STEPS или контрольной точки
+    // (StreamOptions::checkpoint) этого же расчета. Интегрирование начинается с previous.finalState,
+    // в sink выдаются только новые состояния (шаги после previous.steps), прореживание по stride - как
+    // в streamSimulation для params. Итоговая сводка охватывает весь расчет.
+    // С контрольной точки состояния побитно совпадают с расчетом без остановки для всех методов.
+    // При увеличении горизонта так же для методов с постоянным шагом, а адаптивный метод продолжает
+    // с previous.nextStepSize после укороченного до прежнего горизонта шага, поэтому совпадает с расчетом
+    // с начала лишь в пределах допусков. Допустимость продолжения проверяет canContinue
+    SimulationSummary continueSimulation(const SimulationParameters& params, const SimulationSummary& previous,
+        const StateSink& sink, const StreamOptions& options = StreamOptions());
+
+    // Можно ли продолжить расчет previousParams со сводкой previous до params: все параметры, кроме
+    // STEPS, совпадают, горизонт больше, а предыдущий расчет дошел до своего конца (не отменен,
+    // не остановлен столкновением или событием)
+    static bool canContinue(const SimulationParameters& previousParams, const SimulationSummary& previous,
+        const SimulationParameters& params);
+    // Совпадают ли все параметры, кроме STEPS
+    static bool sameProblem(const SimulationParameters& a, const SimulationParameters& b);
+
+    // Характеристики последнего запуска
+    const SimulationSummary& getLastSummary() const { return m_lastSummary; }
+
+    // То же с поиском событий: occurred заполняется событиями в порядке времени. Завершающее событие
+    // останавливает интегрирование, и его состояние становится последним в траектории.
+    // Поиск событий добавляет одно вычисление правой части на шаг
+    std::vector<State> runSimulation(const SimulationParameters& params, std::vector<double>& sampleTimes,
+        const std::vector<EventFunction>& events, std::vector<EventRecord>& occurred);
+    SimulationSummary runSummary(const SimulationParameters& params, const std::vector<EventFunction>& events,
+        std::vector<EventRecord>& occurred);
+
+    // Количество вычислений правой части за последний запуск
+    long long getDerivativeEvaluations() const { return m_lastSummary.derivativeEvaluations; }
+
+    // Интегратор, который фактически будет использован: симплектический метод при ненулевом
+    // сопротивлении или тяге заменяется на RungeKutta4
+    static IntegratorType effectiveIntegrator(const SimulationParameters& params);
+
 private:
-    //     
-    static State derivatives(const State& s, const SimulationParameters& params);
+    // Продолжение и контрольные точки цикла интегрирования.
+    // resume - сводка расчета, с конца которого нужно продолжить (nullptr - с начального состояния);
+    // начальное состояние продолжения observer не получает
+    struct IntegrationControl {
+        const SimulationSummary* resume = nullptr;
+        long long checkpointInterval = 0;
+        const std::function<void(const SimulationSummary&)>* checkpoint = nullptr;
+
+        bool checkpointDue(long long steps) const {
+            return checkpointInterval > 0 && steps % checkpointInterval == 0;
+        }
+    };
+
+    // Общий цикл интегрирования: observer(step, t, state) вызывается для начального и каждого нового
+    // состояния и возвращает false, если интегрирование нужно прервать.
+    // Модель сил (ForceModel.h) и метод выбираются один раз, цикл инстанцируется для каждой комбинации
+    // Events - NoEvents или EventTracker: проверка событий после каждого принятого шага
+    template <class Observer>
+    static SimulationSummary integrate(const SimulationParameters& params, Observer& observer);
+    template <class Observer, class Events>
+    static SimulationSummary integrate(const SimulationParameters& params, Observer& observer, Events& events,
+        const IntegrationControl& control = IntegrationControl());
+
+    template <class Model, class Observer, class Events>
+    static SimulationSummary integrateWithModel(const SimulationParameters& params, const Model& model, Observer& observer,
+        Events& events, const IntegrationControl& control);
+
+    // Общая часть streamSimulation и continueSimulation
+    SimulationSummary stream(const SimulationParameters& params, const StateSink& sink, const StreamOptions& options,
+        const SimulationSummary* resume);
+
+    // Интегрирование с постоянным шагом DT. Stepper задает метод: step(state) выполняет один шаг,
+    // evaluations() возвращает число вычислений правой части, model() - модель сил
+    template <class Stepper, class Observer, class Events>
+    static SimulationSummary integrateFixedStep(const SimulationParameters& params, Stepper& stepper, Observer& observer,
+        Events& events, const IntegrationControl& control);
+
+    // Шаг метода Рунге-Кутты 4-го порядка
+    template <class Model>
+    class RungeKutta4Stepper;
+
+    // Композиция Stages шагов скоростного метода Верле с весами Иошиды
+    template <class Model, size_t Stages>
+    class SymplecticStepper;
+
+    // Интегрирование с адаптивным шагом методом Дормана-Принса 5(4)
+    template <class Model, class Observer, class Events>
+    static SimulationSummary integrateAdaptive(const SimulationParameters& params, const Model& model, Observer& observer,
+        Events& events, const IntegrationControl& control);
+
+    // Без событий: проверки исключаются при компиляции
+    class NoEvents;
+    // Поиск смены знака функций событий и уточнение ее момента
+    class EventTracker;
+
+    // Вывод сообщения о столкновении с центральным телом, если оно произошло
+    static void reportImpact(const SimulationSummary& summary, const SimulationParameters& params);
+
+    // Один шаг интегрирования методом Рунге-Кутты 4-го порядка; правая часть - model.derivatives
+    template <class Model>
+    static State rungeKuttaStep(const State& s, double dt, const Model& model);
+
+    // Один шаг метода Дормана-Принса 5(4). k1 - производная в точке s, в k7 возвращается
+    // производная в новой точке (свойство FSAL), в errorNorm - нормированная оценка локальной ошибки
+    template <class Model>
+    static State dormandPrinceStep(const State& s, const State& k1, double dt, const SimulationParameters& params,
+        const Model& model, State& k7, double& errorNorm);
 
-    //     - 4- 
-    static State rungeKuttaStep(const State& s, double dt, const SimulationParameters& params);
+    SimulationSummary m_lastSummary;
 };
 
 #endif // CALCULATIONS_H
\ No newline at end of file
@@ -0,0 +1,344 @@
+﻿#include "CompressedTrajectory.h"
+
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+namespace {
+    // Ограничение квантованных значений: экстраполяция 3a - 3b + c не переполняет int64_t.
+    // Блок с большими значениями хранится без сжатия
+    constexpr double MAX_QUANTIZED = 576460752303423488.0; // 2^59
+
+    int64_t predict(size_t recordInChunk, const int64_t (&history)[3]) {
+        if (recordInChunk == 1) return history[0];
+        if (recordInChunk == 2) return 2 * history[0] - history[1];
+        return 3 * (history[0] - history[1]) + history[2];
+    }
+
+    void pushHistory(int64_t (&history)[3], int64_t value) {
+        history[2] = history[1];
+        history[1] = history[0];
+        history[0] = value;
+    }
+
+    void writeVarint(std::vector<uint8_t>& bytes, int64_t value) {
+        // zigzag: малые по модулю остатки любого знака -> малые беззнаковые
+        uint64_t encoded = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        while (encoded >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(encoded | 0x80));
+            encoded >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(encoded));
+    }
+
+    int64_t readVarint(const uint8_t*& p) {
+        uint64_t encoded = 0;
+        unsigned int shift = 0;
+        uint8_t byte;
+        do {
+            byte = *p++;
+            encoded |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return static_cast<int64_t>(encoded >> 1) ^ -static_cast<int64_t>(encoded & 1);
+    }
+
+    // Значения несжатых блоков: double побитно
+    int64_t toBits(double value) {
+        int64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    double fromBits(int64_t bits) {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void writeRaw(std::vector<uint8_t>& bytes, double value) {
+        const size_t offset = bytes.size();
+        bytes.resize(offset + sizeof(value));
+        std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+
+    double readRaw(const uint8_t*& p) {
+        double value;
+        std::memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return value;
+    }
+
+    // Пропустить count кодов varint, не выходя за end; false - данные обрываются
+    bool skipVarints(const uint8_t*& p, const uint8_t* end, size_t count) {
+        constexpr size_t MAX_VARINT_BYTES = 10;
+        for (size_t i = 0; i < count; ++i) {
+            size_t length = 0;
+            do {
+                if (p == end || ++length > MAX_VARINT_BYTES) return false;
+            } while (*p++ & 0x80);
+        }
+        return true;
+    }
+
+    template<class T>
+    void writeValue(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template<class T>
+    bool readValue(std::istream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+}
+
+CompressedTrajectory::CompressedTrajectory(const TrajectoryCompression& tolerance)
+    : m_tolerance(tolerance) {
+    const double tolerances[CHANNELS] = { tolerance.timeTolerance, tolerance.positionTolerance,
+        tolerance.positionTolerance, tolerance.velocityTolerance, tolerance.velocityTolerance };
+    for (size_t c = 0; c < CHANNELS; ++c) {
+        m_quantum[c] = 2.0 * tolerances[c];
+        if (!(m_quantum[c] > 0.0)) {
+            std::cerr << "Ошибка: допустимая ошибка сжатия траектории должна быть положительной, используется 1e-9.\n";
+            m_quantum[c] = 2e-9;
+        }
+    }
+}
+
+bool CompressedTrajectory::quantize(const double (&raw)[CHANNELS], int64_t (&values)[CHANNELS]) const {
+    for (size_t c = 0; c < CHANNELS; ++c) {
+        const double scaled = std::nearbyint(raw[c] / m_quantum[c]);
+        if (!(std::fabs(scaled) <= MAX_QUANTIZED)) return false;
+        values[c] = static_cast<int64_t>(scaled);
+    }
+    return true;
+}
+
+double CompressedTrajectory::firstValue(const Chunk& chunk, size_t channel) const {
+    return chunk.raw ? fromBits(chunk.first[channel]) : dequantize(channel, chunk.first[channel]);
+}
+
+bool CompressedTrajectory::append(double t, const State& s) {
+    const double raw[CHANNELS] = { t, s.x, s.y, s.vx, s.vy };
+    for (double value : raw) {
+        if (!std::isfinite(value)) return false;
+    }
+    int64_t values[CHANNELS];
+    const bool quantized = quantize(raw, values);
+
+    const size_t recordInChunk = m_size % CHUNK_SIZE;
+    if (recordInChunk == 0) {
+        Chunk chunk;
+        chunk.byteOffset = m_bytes.size();
+        chunk.raw = !quantized;
+        for (size_t c = 0; c < CHANNELS; ++c) {
+            chunk.first[c] = quantized ? values[c] : toBits(raw[c]);
+            m_history[c][0] = m_history[c][1] = m_history[c][2] = chunk.first[c];
+        }
+        m_chunks.push_back(chunk);
+    }
+    else {
+        if (!quantized && !m_chunks.back().raw) storeLastChunkRaw();
+        for (size_t c = 0; c < CHANNELS; ++c) {
+            if (m_chunks.back().raw) {
+                writeRaw(m_bytes, raw[c]);
+            }
+            else {
+                writeVarint(m_bytes, values[c] - predict(recordInChunk, m_history[c]));
+                pushHistory(m_history[c], values[c]);
+            }
+        }
+    }
+    for (size_t c = 0; c < CHANNELS; ++c) {
+        m_last[c] = m_chunks.back().raw ? raw[c] : dequantize(c, values[c]);
+    }
+    ++m_size;
+    if (m_cachedChunk + 1 == m_chunks.size()) {
+        m_cachedChunk = NO_CHUNK; // Последний блок в кэше устарел
+    }
+    return true;
+}
+
+void CompressedTrajectory::storeLastChunkRaw() {
+    // Записи блока переписываются в восстановленном виде, поэтому их ошибка остается в пределах допуска
+    std::vector<double> times;
+    std::vector<State> states;
+    decodeChunk(m_chunks.size() - 1, times, states);
+    Chunk& chunk = m_chunks.back();
+    m_bytes.resize(chunk.byteOffset);
+    chunk.raw = true;
+    for (size_t k = 0; k < times.size(); ++k) {
+        const double raw[CHANNELS] = { times[k], states[k].x, states[k].y, states[k].vx, states[k].vy };
+        for (size_t c = 0; c < CHANNELS; ++c) {
+            if (k == 0) chunk.first[c] = toBits(raw[c]);
+            else writeRaw(m_bytes, raw[c]);
+        }
+    }
+    if (m_cachedChunk + 1 == m_chunks.size()) {
+        m_cachedChunk = NO_CHUNK;
+    }
+}
+
+void CompressedTrajectory::clear() {
+    m_chunks.clear();
+    m_bytes.clear();
+    m_size = 0;
+    m_cachedChunk = NO_CHUNK;
+}
+
+void CompressedTrajectory::shrinkToFit() {
+    m_chunks.shrink_to_fit();
+    m_bytes.shrink_to_fit();
+}
+
+size_t CompressedTrajectory::chunkSize(size_t chunk) const {
+    return std::min(CHUNK_SIZE, m_size - chunkBegin(chunk));
+}
+
+double CompressedTrajectory::chunkStartTime(size_t chunk) const {
+    return firstValue(m_chunks[chunk], 0);
+}
+
+State CompressedTrajectory::chunkStartState(size_t chunk) const {
+    const Chunk& first = m_chunks[chunk];
+    return { firstValue(first, 1), firstValue(first, 2), firstValue(first, 3), firstValue(first, 4) };
+}
+
+void CompressedTrajectory::decodeChunk(size_t chunk, std::vector<double>& times, std::vector<State>& states) const {
+    const size_t count = chunkSize(chunk);
+    times.resize(count);
+    states.resize(count);
+
+    if (m_chunks[chunk].raw) {
+        double values[CHANNELS];
+        for (size_t c = 0; c < CHANNELS; ++c) values[c] = firstValue(m_chunks[chunk], c);
+        const uint8_t* p = m_bytes.data() + m_chunks[chunk].byteOffset;
+        for (size_t k = 0; k < count; ++k) {
+            if (k > 0) {
+                for (double& value : values) value = readRaw(p);
+            }
+            times[k] = values[0];
+            states[k] = { values[1], values[2], values[3], values[4] };
+        }
+        return;
+    }
+
+    int64_t history[CHANNELS][3];
+    int64_t values[CHANNELS];
+    for (size_t c = 0; c < CHANNELS; ++c) {
+        values[c] = m_chunks[chunk].first[c];
+        history[c][0] = history[c][1] = history[c][2] = values[c];
+    }
+    const uint8_t* p = m_bytes.data() + m_chunks[chunk].byteOffset;
+    for (size_t k = 0; k < count; ++k) {
+        if (k > 0) {
+            for (size_t c = 0; c < CHANNELS; ++c) {
+                values[c] = predict(k, history[c]) + readVarint(p);
+                pushHistory(history[c], values[c]);
+            }
+        }
+        times[k] = dequantize(0, values[0]);
+        states[k] = { dequantize(1, values[1]), dequantize(2, values[2]), dequantize(3, values[3]), dequantize(4, values[4]) };
+    }
+}
+
+void CompressedTrajectory::loadChunk(size_t index) const {
+    const size_t chunk = index / CHUNK_SIZE;
+    if (chunk == m_cachedChunk) return;
+    decodeChunk(chunk, m_cacheTimes, m_cacheStates);
+    m_cachedChunk = chunk;
+}
+
+double CompressedTrajectory::time(size_t index) const {
+    loadChunk(index);
+    return m_cacheTimes[index % CHUNK_SIZE];
+}
+
+State CompressedTrajectory::state(size_t index) const {
+    loadChunk(index);
+    return m_cacheStates[index % CHUNK_SIZE];
+}
+
+bool CompressedTrajectory::write(std::ostream& out) const {
+    writeValue(out, m_tolerance);
+    writeValue(out, static_cast<uint64_t>(m_size));
+    writeValue(out, static_cast<uint64_t>(m_bytes.size()));
+    for (const Chunk& chunk : m_chunks) {
+        writeValue(out, static_cast<uint64_t>(chunk.byteOffset));
+        writeValue(out, chunk.first);
+        writeValue(out, static_cast<uint8_t>(chunk.raw ? 1 : 0));
+    }
+    writeValue(out, m_history);
+    writeValue(out, m_last);
+    out.write(reinterpret_cast<const char*>(m_bytes.data()), static_cast<std::streamsize>(m_bytes.size()));
+    return static_cast<bool>(out);
+}
+
+bool CompressedTrajectory::read(std::istream& in) {
+    TrajectoryCompression tolerance;
+    uint64_t size = 0;
+    uint64_t byteCount = 0;
+    if (!readValue(in, tolerance) || !readValue(in, size) || !readValue(in, byteCount)) return false;
+    // Каждая запись, кроме первой в блоке (она хранится в заголовке блока), занимает не меньше одного
+    // байта на величину, а байты должны помещаться в остаток потока, поэтому испорченный заголовок
+    // не приводит к огромным выделениям памяти
+    uint64_t available = std::numeric_limits<uint64_t>::max();
+    const std::streampos position = in.tellg();
+    if (position != std::streampos(-1) && in.seekg(0, std::ios::end)) {
+        available = static_cast<uint64_t>(in.tellg() - position);
+        in.seekg(position);
+    }
+    in.clear();
+    const uint64_t chunkCount = size / CHUNK_SIZE + (size % CHUNK_SIZE != 0 ? 1 : 0);
+    if (byteCount > available || size - chunkCount > byteCount / CHANNELS) {
+        return false;
+    }
+
+    *this = CompressedTrajectory(tolerance);
+    m_size = static_cast<size_t>(size);
+    m_chunks.resize((m_size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    for (Chunk& chunk : m_chunks) {
+        uint64_t offset = 0;
+        uint8_t raw = 0;
+        if (!readValue(in, offset) || !readValue(in, chunk.first) || !readValue(in, raw)) break;
+        chunk.byteOffset = static_cast<size_t>(offset);
+        chunk.raw = raw != 0;
+    }
+    m_bytes.resize(static_cast<size_t>(byteCount));
+    if (!in || !readValue(in, m_history) || !readValue(in, m_last)
+        || !in.read(reinterpret_cast<char*>(m_bytes.data()), static_cast<std::streamsize>(m_bytes.size()))
+        || !validate()) {
+        *this = CompressedTrajectory(m_tolerance);
+        return false;
+    }
+    return true;
+}
+
+bool CompressedTrajectory::validate() const {
+    for (size_t chunk = 0; chunk < m_chunks.size(); ++chunk) {
+        const size_t begin = m_chunks[chunk].byteOffset;
+        const size_t end = (chunk + 1 < m_chunks.size()) ? m_chunks[chunk + 1].byteOffset : m_bytes.size();
+        if (begin > end || end > m_bytes.size()) return false;
+        const size_t values = (chunkSize(chunk) - 1) * CHANNELS;
+        if (m_chunks[chunk].raw) {
+            if (end - begin != values * sizeof(double)) return false;
+            continue;
+        }
+        const uint8_t* p = m_bytes.data() + begin;
+        if (!skipVarints(p, m_bytes.data() + end, values)
+            || p != m_bytes.data() + end) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t CompressedTrajectory::compressedBytes() const {
+    return m_bytes.size() + m_chunks.size() * sizeof(Chunk);
+}
+
+size_t CompressedTrajectory::memoryBytes() const {
+    return m_bytes.capacity() + m_chunks.capacity() * sizeof(Chunk)
+        + m_cacheTimes.capacity() * sizeof(double) + m_cacheStates.capacity() * sizeof(State);
+}
@@ -0,0 +1,117 @@
+﻿#ifndef COMPRESSEDTRAJECTORY_H
+#define COMPRESSEDTRAJECTORY_H
+
+#include "Calculations.h" // State
+
+#include <algorithm> // Для std::min
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <vector>
+
+// Допустимая ошибка восстановления (по абсолютной величине) для каждой величины записи
+struct TrajectoryCompression {
+    double positionTolerance = 1e-9; // x, y
+    double velocityTolerance = 1e-9; // vx, vy
+    double timeTolerance = 1e-9;
+};
+
+// Сжатое хранение траектории (время + состояние) с ограниченной ошибкой.
+// Каждое значение квантуется с шагом 2 * tolerance, целое предсказывается экстраполяцией по трем
+// предыдущим записям (разности третьего порядка гладкой траектории малы), а остаток записывается
+// кодом zigzag + varint, обычно в 1-2 байта вместо 8. Записи делятся на независимые блоки по CHUNK_SIZE:
+// первая запись блока хранится целиком, поэтому доступ к любой записи требует распаковки одного блока.
+// Блок, значения которого не помещаются в диапазон квантования (|value| / (2 * tolerance) > 2^59, например
+// координаты больше 1e9 при допуске 1e-9), хранится без сжатия: записи в нем точные.
+// Чтение по номеру использует кэш последнего распакованного блока и не потокобезопасно;
+// decodeChunk и forEach кэш не трогают
+class CompressedTrajectory {
+public:
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    explicit CompressedTrajectory(const TrajectoryCompression& tolerance = TrajectoryCompression());
+
+    // Добавить запись. Возвращает false (запись не добавляется), если значение не конечно
+    bool append(double t, const State& s);
+    void clear();
+    void shrinkToFit(); // Освободить запас емкости после окончания записи
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const TrajectoryCompression& tolerance() const { return m_tolerance; }
+
+    // Последняя добавленная запись в восстановленном виде, без распаковки
+    double lastTime() const { return m_last[0]; }
+    State lastState() const { return { m_last[1], m_last[2], m_last[3], m_last[4] }; }
+
+    size_t chunkCount() const { return m_chunks.size(); }
+    size_t chunkBegin(size_t chunk) const { return chunk * CHUNK_SIZE; }
+    size_t chunkSize(size_t chunk) const;
+    // Первая запись блока без распаковки
+    double chunkStartTime(size_t chunk) const;
+    State chunkStartState(size_t chunk) const;
+    // Распаковать блок целиком (размеры векторов становятся равны chunkSize(chunk))
+    void decodeChunk(size_t chunk, std::vector<double>& times, std::vector<State>& states) const;
+
+    double time(size_t index) const;
+    State state(size_t index) const;
+
+    // Последовательный обход записей [begin, end): visitor(index, t, state), блоки распаковываются по очереди
+    template<class Visitor>
+    void forEach(size_t begin, size_t end, Visitor&& visitor) const {
+        std::vector<double> times;
+        std::vector<State> states;
+        end = std::min(end, m_size);
+        for (size_t index = begin; index < end;) {
+            const size_t chunk = index / CHUNK_SIZE;
+            decodeChunk(chunk, times, states);
+            const size_t chunkEnd = std::min(end, chunkBegin(chunk) + times.size());
+            for (; index < chunkEnd; ++index) {
+                const size_t local = index - chunkBegin(chunk);
+                visitor(index, times[local], states[local]);
+            }
+        }
+    }
+
+    // Двоичная запись сжатых данных как есть, без распаковки (порядок байтов - машины записи).
+    // После чтения к траектории можно продолжать добавлять записи. read проверяет целостность
+    // блоков и при ошибке возвращает false, оставляя траекторию пустой
+    bool write(std::ostream& out) const;
+    bool read(std::istream& in);
+
+    size_t compressedBytes() const; // Только данные: блоки и их заголовки
+    size_t memoryBytes() const;     // С учетом запаса емкости и кэша
+    size_t uncompressedBytes() const { return m_size * (sizeof(double) + sizeof(State)); }
+
+private:
+    static constexpr size_t CHANNELS = 5; // t, x, y, vx, vy
+    static constexpr size_t NO_CHUNK = std::numeric_limits<size_t>::max();
+
+    struct Chunk {
+        size_t byteOffset;          // Начало остатков блока в m_bytes (в несжатом блоке - значений double)
+        int64_t first[CHANNELS];    // Квантованная первая запись (в несжатом блоке - биты значений double)
+        bool raw;                   // Блок хранится без сжатия
+    };
+
+    bool quantize(const double (&raw)[CHANNELS], int64_t (&values)[CHANNELS]) const;
+    double dequantize(size_t channel, int64_t value) const { return static_cast<double>(value) * m_quantum[channel]; }
+    double firstValue(const Chunk& chunk, size_t channel) const;
+    void storeLastChunkRaw(); // Переписать текущий блок без сжатия (значение вышло за диапазон квантования)
+    void loadChunk(size_t index) const; // Распаковать в кэш блок с записью index
+    bool validate() const; // Остатки каждого блока занимают ровно его байты
+
+    TrajectoryCompression m_tolerance;
+    double m_quantum[CHANNELS];
+    std::vector<Chunk> m_chunks;
+    std::vector<uint8_t> m_bytes;
+    int64_t m_history[CHANNELS][3] = {}; // Три предыдущие квантованные записи текущего блока, [0] - последняя
+    double m_last[CHANNELS] = {};        // Последняя запись в восстановленном виде
+    size_t m_size = 0;
+
+    mutable size_t m_cachedChunk = NO_CHUNK;
+    mutable std::vector<double> m_cacheTimes;
+    mutable std::vector<State> m_cacheStates;
+};
+
+#endif // COMPRESSEDTRAJECTORY_H
@@ -0,0 +1,199 @@
+﻿#include "ContinuousTrajectory.h"
+#include "ForceModel.h"
+
+#include <algorithm> // Для std::upper_bound, std::max
+#include <cmath>     // Для std::floor
+#include <utility>   // Для std::move
+
+ContinuousTrajectory::ContinuousTrajectory(const SimulationParameters& params, const TrajectoryCompression& compression)
+    : m_params(params), m_nodes(compression) {
+}
+
+ContinuousTrajectory::ContinuousTrajectory(const SimulationParameters& params, const std::vector<double>& times,
+    const std::vector<State>& states, const TrajectoryCompression& compression)
+    : ContinuousTrajectory(params, compression) {
+    if (times.size() != states.size()) {
+        std::cerr << "Ошибка: число моментов времени (" << times.size() << ") не совпадает с числом состояний ("
+            << states.size() << ").\n";
+        return;
+    }
+    for (size_t i = 0; i < states.size(); ++i) {
+        if (!append(times[i], states[i])) break;
+    }
+    shrinkToFit();
+}
+
+ContinuousTrajectory::ContinuousTrajectory(const SimulationParameters& params, CompressedTrajectory nodes)
+    : m_params(params), m_nodes(std::move(nodes)) {
+}
+
+ContinuousTrajectory ContinuousTrajectory::simulate(const SimulationParameters& params, const StreamOptions& options,
+    const TrajectoryCompression& compression) {
+    ContinuousTrajectory trajectory(params, compression);
+    Calculations calculator;
+    // Узел, который нельзя сохранить, останавливает расчет: траектория обрывается на последнем узле
+    calculator.streamSimulation(params, [&](long long, double t, const State& s) {
+        return trajectory.append(t, s);
+    }, options);
+    trajectory.shrinkToFit();
+    return trajectory;
+}
+
+bool ContinuousTrajectory::append(double t, const State& s) {
+    if (!m_nodes.empty() && !(t > m_nodes.lastTime())) {
+        std::cerr << "Ошибка: узел траектории t = " << t << " не позже предыдущего (" << m_nodes.lastTime() << ").\n";
+        return false;
+    }
+    if (m_cachedChunk + 1 == m_nodes.chunkCount()) {
+        m_cachedChunk = NO_CHUNK; // Последний блок в кэше устареет
+    }
+    if (!m_nodes.append(t, s)) {
+        std::cerr << "Ошибка: узел траектории t = " << t << " содержит не конечные значения.\n";
+        return false;
+    }
+    return true;
+}
+
+ContinuousTrajectory ContinuousTrajectory::decimated(size_t maxNodes) const {
+    ContinuousTrajectory result(m_params, m_nodes.tolerance());
+    if (m_nodes.empty()) return result;
+    // Последний узел добавляется вне сетки, поэтому промежуток рассчитан на maxNodes - 1 узлов
+    const double interval = (endTime() - startTime()) / static_cast<double>(std::max<size_t>(maxNodes, 3) - 2);
+    const size_t last = m_nodes.size() - 1;
+    const double start = startTime();
+    double nextTime = start;
+    m_nodes.forEach(0, m_nodes.size(), [&](size_t index, double t, const State& s) {
+        if (t >= nextTime || index == last) {
+            result.m_nodes.append(t, s); // Значения уже прошли квантование и повторно не меняются
+            // Следующая точка сетки start + k * interval после t: не больше одного узла на промежуток
+            nextTime = start + interval * (std::floor((t - start) / interval) + 1.0);
+        }
+    });
+    result.shrinkToFit();
+    return result;
+}
+
+void ContinuousTrajectory::clear() {
+    m_nodes.clear();
+    m_cachedChunk = NO_CHUNK;
+}
+
+State ContinuousTrajectory::derivative(const State& s) const {
+    State f{};
+    dispatchForceModel(m_params, [&](const auto& model) { f = model.derivatives(s); });
+    return f;
+}
+
+void ContinuousTrajectory::loadChunk(size_t chunk) const {
+    if (chunk == m_cachedChunk) return;
+    m_nodes.decodeChunk(chunk, m_cacheTimes, m_cacheStates);
+    // Модель сил выбирается один раз на весь блок
+    m_cacheDerivatives.resize(m_cacheStates.size());
+    dispatchForceModel(m_params, [this](const auto& model) {
+        for (size_t i = 0; i < m_cacheStates.size(); ++i) {
+            m_cacheDerivatives[i] = model.derivatives(m_cacheStates[i]);
+        }
+    });
+    m_cachedChunk = chunk;
+}
+
+void ContinuousTrajectory::node(size_t index, double& t, State& s, State& f) const {
+    const size_t chunk = index / CompressedTrajectory::CHUNK_SIZE;
+    const size_t local = index % CompressedTrajectory::CHUNK_SIZE;
+    if (local == 0 && chunk != m_cachedChunk) {
+        t = m_nodes.chunkStartTime(chunk);
+        s = m_nodes.chunkStartState(chunk);
+        f = derivative(s);
+        return;
+    }
+    loadChunk(chunk);
+    t = m_cacheTimes[local];
+    s = m_cacheStates[local];
+    f = m_cacheDerivatives[local];
+}
+
+double ContinuousTrajectory::nodeTime(size_t index) const {
+    const size_t chunk = index / CompressedTrajectory::CHUNK_SIZE;
+    const size_t local = index % CompressedTrajectory::CHUNK_SIZE;
+    if (local == 0) return m_nodes.chunkStartTime(chunk);
+    loadChunk(chunk);
+    return m_cacheTimes[local];
+}
+
+State ContinuousTrajectory::nodeState(size_t index) const {
+    const size_t chunk = index / CompressedTrajectory::CHUNK_SIZE;
+    const size_t local = index % CompressedTrajectory::CHUNK_SIZE;
+    if (local == 0) return m_nodes.chunkStartState(chunk);
+    loadChunk(chunk);
+    return m_cacheStates[local];
+}
+
+size_t ContinuousTrajectory::segmentIndex(double t) const {
+    // Сначала блок по временам первых узлов, затем отрезок внутри блока
+    size_t low = 0, high = m_nodes.chunkCount();
+    while (high - low > 1) {
+        const size_t middle = low + (high - low) / 2;
+        if (m_nodes.chunkStartTime(middle) <= t) low = middle;
+        else high = middle;
+    }
+    loadChunk(low);
+    // Первый узел блока строго позже t; отрезок начинается в предыдущем
+    const size_t upper = static_cast<size_t>(std::upper_bound(m_cacheTimes.begin(), m_cacheTimes.end(), t) - m_cacheTimes.begin());
+    const size_t index = m_nodes.chunkBegin(low) + std::max<size_t>(upper, 1) - 1;
+    return std::min(index, m_nodes.size() - 2);
+}
+
+State ContinuousTrajectory::interpolate(size_t segment, double t) const {
+    double t0, t1;
+    State s0, f0, s1, f1;
+    node(segment + 1, t1, s1, f1); // Сначала правый узел: левый после него остается в кэше
+    node(segment, t0, s0, f0);
+    const double h = t1 - t0;
+    if (!(h > 0.0)) return s0;
+    return hermiteInterpolate(s0, f0, s1, f1, h, (t - t0) / h);
+}
+
+State ContinuousTrajectory::stateAt(double t) const {
+    if (m_nodes.empty()) return { 0, 0, 0, 0 };
+    if (!(t > startTime())) return m_nodes.chunkStartState(0);
+    if (!(t < endTime())) return m_nodes.lastState();
+    return interpolate(segmentIndex(t), t);
+}
+
+std::vector<State> ContinuousTrajectory::sample(double t0, double t1, size_t count) const {
+    std::vector<State> out;
+    sample(t0, t1, count, out);
+    return out;
+}
+
+void ContinuousTrajectory::sample(double t0, double t1, size_t count, std::vector<State>& out) const {
+    out.clear();
+    if (count == 0 || m_nodes.empty()) return;
+    out.reserve(count);
+    const double step = (count > 1) ? (t1 - t0) / static_cast<double>(count - 1) : 0.0;
+    const size_t nodes = m_nodes.size();
+    size_t segment = 0;
+    bool segmentFound = false;
+    for (size_t i = 0; i < count; ++i) {
+        const double t = (i + 1 == count) ? t1 : t0 + step * static_cast<double>(i);
+        if (nodes == 1 || !(t > startTime()) || !(t < endTime())) {
+            out.push_back(stateAt(t));
+            continue;
+        }
+        if (!segmentFound) {
+            segment = segmentIndex(t);
+            segmentFound = true;
+        }
+        else {
+            // Моменты возрастают (или убывают при t1 < t0), поэтому отрезок сдвигается на соседние
+            while (segment + 2 < nodes && nodeTime(segment + 1) <= t) ++segment;
+            while (segment > 0 && nodeTime(segment) > t) --segment;
+        }
+        out.push_back(interpolate(segment, t));
+    }
+}
+
+size_t ContinuousTrajectory::memoryBytes() const {
+    return m_nodes.memoryBytes() + m_cacheTimes.capacity() * sizeof(double)
+        + (m_cacheStates.capacity() + m_cacheDerivatives.capacity()) * sizeof(State);
+}
@@ -0,0 +1,90 @@
+﻿#ifndef CONTINUOUSTRAJECTORY_H
+#define CONTINUOUSTRAJECTORY_H
+
+#include "Calculations.h"
+#include "CompressedTrajectory.h"
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Непрерывная траектория: узлы (t, состояние) и кубическая эрмитова интерполяция между ними
+// (hermiteInterpolate). Состояние в любой момент находится двоичным поиском отрезка за O(log N),
+// поэтому узлы можно хранить реже, чем шаги интегрирования: при шаге узлов H погрешность
+// интерполяции порядка H^4.
+// Узлы хранятся сжатыми (CompressedTrajectory) с ошибкой не больше заданной допустимой, производные
+// в узлах вычисляются по модели сил при распаковке блока. Чтение использует кэш распакованного блока
+// и не потокобезопасно
+class ContinuousTrajectory {
+public:
+    ContinuousTrajectory() = default;
+
+    // Пустая траектория для заполнения через append. Производные в узлах вычисляются по модели сил
+    // params, поэтому params должны совпадать с параметрами расчета
+    explicit ContinuousTrajectory(const SimulationParameters& params,
+        const TrajectoryCompression& compression = TrajectoryCompression());
+
+    // Узлы из готовых состояний и моментов времени (times возрастают)
+    ContinuousTrajectory(const SimulationParameters& params, const std::vector<double>& times,
+        const std::vector<State>& states, const TrajectoryCompression& compression = TrajectoryCompression());
+
+    // Готовые сжатые узлы (например, из кэша результатов SimulationCache)
+    ContinuousTrajectory(const SimulationParameters& params, CompressedTrajectory nodes);
+
+    // Расчет, в котором узлами становятся состояния, выданные streamSimulation с options
+    // (options.stride или options.maxSamples задают разреженность узлов)
+    static ContinuousTrajectory simulate(const SimulationParameters& params, const StreamOptions& options = StreamOptions(),
+        const TrajectoryCompression& compression = TrajectoryCompression());
+
+    // Добавить узел; t должно быть больше времени предыдущего узла. Возвращает false (с сообщением),
+    // если узел не добавлен: время не возрастает или значения не конечны
+    bool append(double t, const State& s);
+    void shrinkToFit() { m_nodes.shrinkToFit(); }
+    void clear();
+
+    // Копия, прореженная по времени не больше чем до maxNodes узлов (maxNodes >= 2): узлы через
+    // равные промежутки времени, первый и последний узлы сохраняются
+    ContinuousTrajectory decimated(size_t maxNodes) const;
+
+    bool empty() const { return m_nodes.empty(); }
+    size_t nodeCount() const { return m_nodes.size(); }
+    double startTime() const { return m_nodes.empty() ? 0.0 : m_nodes.chunkStartTime(0); }
+    double endTime() const { return m_nodes.empty() ? 0.0 : m_nodes.lastTime(); }
+
+    double nodeTime(size_t index) const;
+    State nodeState(size_t index) const;
+    // Сжатые узлы: для последовательного обхода без вычисления производных
+    const CompressedTrajectory& nodes() const { return m_nodes; }
+
+    // Состояние в момент t; вне [startTime, endTime] возвращается ближайший крайний узел
+    State stateAt(double t) const;
+
+    // count состояний в равноотстоящие моменты от t0 до t1 включительно. Отрезок ищется один раз,
+    // дальше узлы перебираются по порядку, поэтому выборка стоит O(log N + count + пройденные узлы)
+    std::vector<State> sample(double t0, double t1, size_t count) const;
+    void sample(double t0, double t1, size_t count, std::vector<State>& out) const;
+
+    size_t memoryBytes() const;
+
+private:
+    static constexpr size_t NO_CHUNK = std::numeric_limits<size_t>::max();
+
+    // Номер отрезка [node(i), node(i + 1)], содержащего t (t внутри диапазона узлов)
+    size_t segmentIndex(double t) const;
+    State interpolate(size_t segment, double t) const;
+    // Узел с производной. Первый узел блока берется из заголовка блока без распаковки,
+    // поэтому отрезки на границе блоков не вытесняют кэш
+    void node(size_t index, double& t, State& s, State& f) const;
+    void loadChunk(size_t chunk) const;
+    State derivative(const State& s) const;
+
+    SimulationParameters m_params;
+    CompressedTrajectory m_nodes;
+
+    mutable size_t m_cachedChunk = NO_CHUNK;
+    mutable std::vector<double> m_cacheTimes;
+    mutable std::vector<State> m_cacheStates;
+    mutable std::vector<State> m_cacheDerivatives;
+};
+
+#endif // CONTINUOUSTRAJECTORY_H
@@ -0,0 +1,204 @@
+﻿#include "EnsembleIntegrator.h"
+
+#include <algorithm> // Для std::min, std::max
+
+namespace {
+    constexpr size_t LANES = EnsembleIntegrator::LANES;
+
+    // Состояния одного блока дорожек. Фиксированная длина массивов позволяет компилятору
+    // развернуть циклы по дорожкам в векторные инструкции
+    struct BlockState {
+        alignas(64) double x[LANES];
+        alignas(64) double y[LANES];
+        alignas(64) double vx[LANES];
+        alignas(64) double vy[LANES];
+    };
+
+    // Правая часть для всех дорожек блока (векторный аналог Calculations::derivatives)
+    inline void blockDerivatives(const BlockState& s, const double* gm, const double* net, BlockState& d) {
+        for (size_t l = 0; l < LANES; ++l) {
+            // Те же операции, что в ForceModel::pointAt и PointMassGravity::add: умножение на 1 / r³,
+            // а не деление на r³, иначе результаты расходятся со скалярным путем в последнем бите
+            double r_squared = s.x[l] * s.x[l] + s.y[l] * s.y[l];
+            double inv_r_cubed = (r_squared == 0.0) ? 0.0 : 1.0 / (r_squared * std::sqrt(r_squared));
+            double common_factor_gravity = gm[l] * inv_r_cubed;
+
+            d.x[l] = s.vx[l];
+            d.y[l] = s.vy[l];
+            d.vx[l] = common_factor_gravity * s.x[l] + net[l] * s.vx[l];
+            d.vy[l] = common_factor_gravity * s.y[l] + net[l] * s.vy[l];
+        }
+    }
+
+    // Ансамбль считает только притяжение, тягу и сопротивление (PointMassGravity и LinearVelocityForce)
+    bool hasOnlyCentralForces(const SimulationParameters& params) {
+        return params.J2_COEFFICIENT == 0.0 && params.EXTERNAL_FIELD_X == 0.0 && params.EXTERNAL_FIELD_Y == 0.0;
+    }
+
+    // s + dt * k / divisor, с тем же порядком операций, что и в rungeKuttaStep
+    inline void blockOffset(const BlockState& s, const BlockState& k, double dt, double divisor, BlockState& out) {
+        for (size_t l = 0; l < LANES; ++l) {
+            out.x[l] = s.x[l] + dt * k.x[l] / divisor;
+            out.y[l] = s.y[l] + dt * k.y[l] / divisor;
+            out.vx[l] = s.vx[l] + dt * k.vx[l] / divisor;
+            out.vy[l] = s.vy[l] + dt * k.vy[l] / divisor;
+        }
+    }
+}
+
+void EnsembleState::resize(size_t count) {
+    x.resize(count);
+    y.resize(count);
+    vx.resize(count);
+    vy.resize(count);
+}
+
+void EnsembleState::set(size_t index, const State& s) {
+    x[index] = s.x;
+    y[index] = s.y;
+    vx[index] = s.vx;
+    vy[index] = s.vy;
+}
+
+State EnsembleState::get(size_t index) const {
+    return { x[index], y[index], vx[index], vy[index] };
+}
+
+bool EnsembleIntegrator::isCompatible(const SimulationParameters& a, const SimulationParameters& b) {
+    return a.INTEGRATOR == IntegratorType::RungeKutta4 && b.INTEGRATOR == IntegratorType::RungeKutta4
+        && a.DT == b.DT && a.STEPS == b.STEPS && a.CENTRAL_BODY_RADIUS == b.CENTRAL_BODY_RADIUS
+        && hasOnlyCentralForces(a) && hasOnlyCentralForces(b);
+}
+
+std::vector<SimulationSummary> EnsembleIntegrator::run(const std::vector<SimulationParameters>& parameterSets) {
+    std::vector<SimulationSummary> summaries(parameterSets.size());
+    if (parameterSets.empty()) return summaries;
+
+    // Совместимые наборы собираются в ансамбль, остальные считаются по одному
+    std::vector<size_t> ensembleIndices;
+    ensembleIndices.reserve(parameterSets.size());
+    Calculations calculator;
+    for (size_t i = 0; i < parameterSets.size(); ++i) {
+        if (isCompatible(parameterSets[0], parameterSets[i])) {
+            ensembleIndices.push_back(i);
+        }
+        else {
+            summaries[i] = calculator.runSummary(parameterSets[i]);
+        }
+    }
+
+    EnsembleState states;
+    states.resize(ensembleIndices.size());
+    std::vector<const SimulationParameters*> laneParams(ensembleIndices.size());
+    for (size_t e = 0; e < ensembleIndices.size(); ++e) {
+        const SimulationParameters& params = parameterSets[ensembleIndices[e]];
+        states.set(e, { params.initialState.x, params.initialState.y, params.initialState.vx, params.initialState.vy });
+        laneParams[e] = &params;
+    }
+
+    std::vector<SimulationSummary> ensembleSummaries(ensembleIndices.size());
+    for (size_t begin = 0; begin < ensembleIndices.size(); begin += LANES) {
+        size_t count = std::min(LANES, ensembleIndices.size() - begin);
+        integrateBlock(states, begin, count, laneParams, &ensembleSummaries[begin]);
+    }
+
+    for (size_t e = 0; e < ensembleIndices.size(); ++e) {
+        summaries[ensembleIndices[e]] = ensembleSummaries[e];
+    }
+    return summaries;
+}
+
+void EnsembleIntegrator::integrateBlock(EnsembleState& states, size_t begin, size_t count,
+    const std::vector<const SimulationParameters*>& laneParams, SimulationSummary* summaries) {
+    const SimulationParameters& shared = *laneParams[begin];
+    const double dt = shared.DT;
+    const double impact_r_squared = shared.CENTRAL_BODY_RADIUS * shared.CENTRAL_BODY_RADIUS;
+
+    BlockState s;
+    alignas(64) double gm[LANES];        // -G * M
+    alignas(64) double net[LANES];       // THRUST_COEFFICIENT - DRAG_COEFFICIENT
+    alignas(64) double alive[LANES];     // 1 - траектория продолжается, 0 - заморожена или дорожка пустая
+    alignas(64) double min_r_squared[LANES];
+    alignas(64) double max_r_squared[LANES];
+    alignas(64) double stepsDone[LANES]; // Счетчики в double, чтобы не смешивать типы внутри векторного цикла
+    alignas(64) double impactStep[LANES];
+
+    for (size_t l = 0; l < LANES; ++l) {
+        if (l < count) {
+            const SimulationParameters& params = *laneParams[begin + l];
+            s.x[l] = states.x[begin + l];
+            s.y[l] = states.y[begin + l];
+            s.vx[l] = states.vx[begin + l];
+            s.vy[l] = states.vy[begin + l];
+            gm[l] = -params.G * params.M;
+            net[l] = params.THRUST_COEFFICIENT - params.DRAG_COEFFICIENT;
+        }
+        else {
+            // Пустые дорожки неполного блока: безопасные значения, сразу заморожены
+            s.x[l] = 1.0; s.y[l] = 0.0; s.vx[l] = 0.0; s.vy[l] = 0.0;
+            gm[l] = 0.0;
+            net[l] = 0.0;
+        }
+        double r_squared = s.x[l] * s.x[l] + s.y[l] * s.y[l];
+        bool insideBody = l < count && r_squared < impact_r_squared;
+        alive[l] = (l < count && !insideBody) ? 1.0 : 0.0;
+        impactStep[l] = insideBody ? 0.0 : -1.0;
+        min_r_squared[l] = r_squared;
+        max_r_squared[l] = r_squared;
+        stepsDone[l] = 0.0;
+    }
+
+    BlockState k1, k2, k3, k4, temp;
+    for (int i = 0; i < shared.STEPS; ++i) {
+        blockDerivatives(s, gm, net, k1);
+        blockOffset(s, k1, dt, 2.0, temp);
+        blockDerivatives(temp, gm, net, k2);
+        blockOffset(s, k2, dt, 2.0, temp);
+        blockDerivatives(temp, gm, net, k3);
+        blockOffset(s, k3, dt, 1.0, temp);
+        blockDerivatives(temp, gm, net, k4);
+
+        double anyAlive = 0.0;
+        const double stepNumber = static_cast<double>(i + 1);
+        for (size_t l = 0; l < LANES; ++l) {
+            double nx = s.x[l] + dt / 6.0 * (k1.x[l] + 2.0 * k2.x[l] + 2.0 * k3.x[l] + k4.x[l]);
+            double ny = s.y[l] + dt / 6.0 * (k1.y[l] + 2.0 * k2.y[l] + 2.0 * k3.y[l] + k4.y[l]);
+            double nvx = s.vx[l] + dt / 6.0 * (k1.vx[l] + 2.0 * k2.vx[l] + 2.0 * k3.vx[l] + k4.vx[l]);
+            double nvy = s.vy[l] + dt / 6.0 * (k1.vy[l] + 2.0 * k2.vy[l] + 2.0 * k3.vy[l] + k4.vy[l]);
+
+            // Маска: замороженные дорожки сохраняют прежнее состояние
+            bool active = alive[l] != 0.0;
+            s.x[l] = active ? nx : s.x[l];
+            s.y[l] = active ? ny : s.y[l];
+            s.vx[l] = active ? nvx : s.vx[l];
+            s.vy[l] = active ? nvy : s.vy[l];
+
+            double r_squared = nx * nx + ny * ny;
+            min_r_squared[l] = active ? std::min(min_r_squared[l], r_squared) : min_r_squared[l];
+            max_r_squared[l] = active ? std::max(max_r_squared[l], r_squared) : max_r_squared[l];
+            stepsDone[l] = active ? stepNumber : stepsDone[l];
+
+            bool hit = active && r_squared < impact_r_squared;
+            impactStep[l] = hit ? stepNumber : impactStep[l];
+            alive[l] = hit ? 0.0 : alive[l];
+            anyAlive += alive[l];
+        }
+        if (anyAlive == 0.0) break; // Все траектории блока закончились столкновением
+    }
+
+    for (size_t l = 0; l < count; ++l) {
+        states.x[begin + l] = s.x[l];
+        states.y[begin + l] = s.y[l];
+        states.vx[begin + l] = s.vx[l];
+        states.vy[begin + l] = s.vy[l];
+
+        SimulationSummary& summary = summaries[l];
+        summary.finalState = { s.x[l], s.y[l], s.vx[l], s.vy[l] };
+        summary.steps = static_cast<long long>(stepsDone[l]);
+        summary.finalTime = summary.steps * dt;
+        summary.impactStep = static_cast<long long>(impactStep[l]);
+        summary.minRadius = std::sqrt(min_r_squared[l]);
+        summary.maxRadius = std::sqrt(max_r_squared[l]);
+        summary.derivativeEvaluations = 4 * summary.steps;
+    }
+}
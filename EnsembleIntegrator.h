@@ -0,0 +1,48 @@
+﻿#ifndef ENSEMBLEINTEGRATOR_H
+#define ENSEMBLEINTEGRATOR_H
+
+#include "Calculations.h"
+
+#include <vector>
+
+// Состояния ансамбля траекторий в виде структуры массивов (x, y, vx, vy хранятся раздельно),
+// чтобы одна и та же операция выполнялась сразу над несколькими траекториями в SIMD-регистре
+struct EnsembleState {
+    std::vector<double> x, y, vx, vy;
+
+    size_t size() const { return x.size(); }
+    void resize(size_t count);
+    void set(size_t index, const State& s);
+    State get(size_t index) const;
+};
+
+// Интегратор ансамбля: траектории продвигаются методом Рунге-Кутты 4-го порядка синхронно,
+// блоками по LANES штук. Каждая траектория блока ("дорожка") имеет свои G*M, тягу и сопротивление,
+// а после столкновения с центральным телом замораживается маской, не останавливая остальные.
+// Формулы и порядок операций повторяют Calculations::rungeKuttaStep и ForceModel, поэтому при сборке
+// без слияния умножения и сложения в FMA (-ffp-contract=off или цель без FMA) результаты побитово
+// совпадают со скалярным путем; с FMA возможны расхождения в последнем бите.
+// Ускорение относительно скалярного пути - около 2.5-5 раз (зависит от ширины векторов и доли
+// траекторий, замороженных после столкновения), а не 8 по числу дорожек: векторные sqrt и деление
+// медленнее сложения, а замороженные дорожки продолжают занимать место в блоке
+class EnsembleIntegrator {
+public:
+    // Ширина блока: 8 double - один регистр AVX-512 или два AVX2
+    static constexpr size_t LANES = 8;
+
+    // Запуски можно объединить в один ансамбль, если у них общие шаг, число шагов и радиус тела,
+    // используется метод Рунге-Кутты 4-го порядка и нет сил, кроме притяжения, тяги и сопротивления
+    static bool isCompatible(const SimulationParameters& a, const SimulationParameters& b);
+
+    // Результаты в том же формате, что и Calculations::runSummary. Наборы, несовместимые с первым,
+    // считаются обычным скалярным путем
+    std::vector<SimulationSummary> run(const std::vector<SimulationParameters>& parameterSets);
+
+private:
+    // Проинтегрировать траектории [begin, begin + count) ансамбля, count <= LANES.
+    // laneParams - параметры всех траекторий ансамбля, summaries - результаты блока
+    static void integrateBlock(EnsembleState& states, size_t begin, size_t count,
+        const std::vector<const SimulationParameters*>& laneParams, SimulationSummary* summaries);
+};
+
+#endif // ENSEMBLEINTEGRATOR_H
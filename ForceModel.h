@@ -0,0 +1,156 @@
+﻿#ifndef FORCEMODEL_H
+#define FORCEMODEL_H
+
+#include "Calculations.h" // SimulationParameters, State
+
+#include <cmath>
+#include <tuple>
+
+// Силы, действующие на пробное тело, в виде слагаемых-политик. Модель сил собирается из нужных
+// слагаемых на этапе компиляции (ForceModel<...>), поэтому в правой части нет обращений к параметрам,
+// проверок на нулевые коэффициенты и вычислений отключенных сил. Константы каждого слагаемого
+// вычисляются один раз при построении модели.
+//
+// Слагаемое - структура с полями-константами и
+//   static constexpr bool NEEDS_RADIUS   - нужны ли r² и 1/r³ (считаются моделью один раз на точку);
+//   static constexpr bool VELOCITY_DEPENDENT - зависит ли ускорение от скорости;
+//   void add(const ForcePoint& p, double& ax, double& ay) const - прибавить свое ускорение.
+
+// Точка, в которой вычисляется ускорение. r_squared и inv_r_cubed заполнены, только если
+// какому-либо слагаемому модели нужен радиус; при r = 0 inv_r_cubed равен нулю
+struct ForcePoint {
+    double x, y, vx, vy;
+    double r_squared;
+    double inv_r_cubed;
+};
+
+// Притяжение точечной массы в начале координат: -G*M * r / r³
+struct PointMassGravity {
+    static constexpr bool NEEDS_RADIUS = true;
+    static constexpr bool VELOCITY_DEPENDENT = false;
+    double minusMu; // -G * M
+
+    explicit PointMassGravity(const SimulationParameters& params) : minusMu(-params.G * params.M) {}
+
+    void add(const ForcePoint& p, double& ax, double& ay) const {
+        const double factor = minusMu * p.inv_r_cubed;
+        ax += factor * p.x;
+        ay += factor * p.y;
+    }
+};
+
+// Тяга вдоль скорости и линейное сопротивление: (THRUST_COEFFICIENT - DRAG_COEFFICIENT) * v.
+// Оба слагаемых линейны по скорости, поэтому объединены в один коэффициент
+struct LinearVelocityForce {
+    static constexpr bool NEEDS_RADIUS = false;
+    static constexpr bool VELOCITY_DEPENDENT = true;
+    double coefficient;
+
+    explicit LinearVelocityForce(const SimulationParameters& params)
+        : coefficient(params.THRUST_COEFFICIENT - params.DRAG_COEFFICIENT) {}
+
+    void add(const ForcePoint& p, double& ax, double& ay) const {
+        ax += coefficient * p.vx;
+        ay += coefficient * p.vy;
+    }
+};
+
+// Сжатие центрального тела (вторая зональная гармоника J2) для движения в экваториальной плоскости:
+// -G*M * r / r³ * 3/2 * J2 * (R / r)², R - CENTRAL_BODY_RADIUS
+struct J2Oblateness {
+    static constexpr bool NEEDS_RADIUS = true;
+    static constexpr bool VELOCITY_DEPENDENT = false;
+    double minusCoefficient; // -3/2 * J2 * G*M * R²
+
+    explicit J2Oblateness(const SimulationParameters& params)
+        : minusCoefficient(-1.5 * params.J2_COEFFICIENT * params.G * params.M
+            * params.CENTRAL_BODY_RADIUS * params.CENTRAL_BODY_RADIUS) {}
+
+    void add(const ForcePoint& p, double& ax, double& ay) const {
+        const double factor = (p.r_squared == 0.0) ? 0.0 : minusCoefficient * p.inv_r_cubed / p.r_squared;
+        ax += factor * p.x;
+        ay += factor * p.y;
+    }
+};
+
+// Постоянное внешнее поле (например, однородная гравитация или давление излучения)
+struct ConstantField {
+    static constexpr bool NEEDS_RADIUS = false;
+    static constexpr bool VELOCITY_DEPENDENT = false;
+    double gx, gy;
+
+    explicit ConstantField(const SimulationParameters& params)
+        : gx(params.EXTERNAL_FIELD_X), gy(params.EXTERNAL_FIELD_Y) {}
+
+    void add(const ForcePoint&, double& ax, double& ay) const {
+        ax += gx;
+        ay += gy;
+    }
+};
+
+template <class... Terms>
+class ForceModel {
+public:
+    static constexpr bool NEEDS_RADIUS = (false || ... || Terms::NEEDS_RADIUS);
+    // Модели, зависящие от скорости, неприменимы в симплектических методах
+    static constexpr bool VELOCITY_DEPENDENT = (false || ... || Terms::VELOCITY_DEPENDENT);
+
+    explicit ForceModel(const SimulationParameters& params) : m_terms(Terms(params)...) {}
+
+    // Правая часть системы: (vx, vy, ax, ay)
+    State derivatives(const State& s) const {
+        // -0.0 + a == a точно, поэтому компилятор убирает сложение с начальным нулем
+        double ax = -0.0, ay = -0.0;
+        accumulate(pointAt(s.x, s.y, s.vx, s.vy), ax, ay);
+        return { s.vx, s.vy, ax, ay };
+    }
+
+    // Ускорение, зависящее только от положения (для симплектических методов)
+    void acceleration(double x, double y, double& ax, double& ay) const {
+        static_assert(!VELOCITY_DEPENDENT, "acceleration() requires a position-only force model");
+        ax = -0.0;
+        ay = -0.0;
+        accumulate(pointAt(x, y, 0.0, 0.0), ax, ay);
+    }
+
+private:
+    static ForcePoint pointAt(double x, double y, double vx, double vy) {
+        ForcePoint p{ x, y, vx, vy, 0.0, 0.0 };
+        if constexpr (NEEDS_RADIUS) {
+            // В начале координат ускорение от радиальных сил считается нулевым, как в исходной версии:
+            // иначе один шаг через r = 0 превращает все последующие состояния в NaN
+            p.r_squared = x * x + y * y;
+            p.inv_r_cubed = (p.r_squared == 0.0) ? 0.0 : 1.0 / (p.r_squared * std::sqrt(p.r_squared));
+        }
+        return p;
+    }
+
+    void accumulate(const ForcePoint& p, double& ax, double& ay) const {
+        std::apply([&](const Terms&... term) { (term.add(p, ax, ay), ...); }, m_terms);
+    }
+
+    std::tuple<Terms...> m_terms;
+};
+
+// Выбрать модель сил по параметрам (один раз на запуск) и вызвать visitor(model).
+// Слагаемые с нулевыми коэффициентами в модель не входят
+template <class Visitor>
+decltype(auto) dispatchForceModel(const SimulationParameters& params, Visitor&& visitor) {
+    const bool velocityTerm = params.THRUST_COEFFICIENT - params.DRAG_COEFFICIENT != 0.0;
+    const bool j2Term = params.J2_COEFFICIENT != 0.0 && params.CENTRAL_BODY_RADIUS != 0.0;
+    const bool fieldTerm = params.EXTERNAL_FIELD_X != 0.0 || params.EXTERNAL_FIELD_Y != 0.0;
+
+    const int mask = (velocityTerm ? 1 : 0) | (j2Term ? 2 : 0) | (fieldTerm ? 4 : 0);
+    switch (mask) {
+    case 0: return visitor(ForceModel<PointMassGravity>(params));
+    case 1: return visitor(ForceModel<PointMassGravity, LinearVelocityForce>(params));
+    case 2: return visitor(ForceModel<PointMassGravity, J2Oblateness>(params));
+    case 3: return visitor(ForceModel<PointMassGravity, J2Oblateness, LinearVelocityForce>(params));
+    case 4: return visitor(ForceModel<PointMassGravity, ConstantField>(params));
+    case 5: return visitor(ForceModel<PointMassGravity, ConstantField, LinearVelocityForce>(params));
+    case 6: return visitor(ForceModel<PointMassGravity, J2Oblateness, ConstantField>(params));
+    default: return visitor(ForceModel<PointMassGravity, J2Oblateness, ConstantField, LinearVelocityForce>(params));
+    }
+}
+
+#endif // FORCEMODEL_H
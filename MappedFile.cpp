@@ -0,0 +1,105 @@
+﻿#include "MappedFile.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : m_data(nullptr),
+    m_size(0),
+    m_opened(false)
+#if defined(_WIN32)
+    , m_fileHandle(INVALID_HANDLE_VALUE),
+    m_mappingHandle(nullptr)
+#else
+    , m_fileDescriptor(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filename) {
+    close();
+#if defined(_WIN32)
+    m_fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_fileHandle == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_fileHandle, &fileSize)) {
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    m_opened = true;
+    if (m_size == 0) return true; // Пустой файл отобразить нельзя, но открыть можно
+
+    m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mappingHandle) {
+        close();
+        return false;
+    }
+    m_data = static_cast<const char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        close();
+        return false;
+    }
+#else
+    m_fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+    if (m_fileDescriptor < 0) return false;
+
+    struct stat fileInfo;
+    if (fstat(m_fileDescriptor, &fileInfo) != 0) {
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(fileInfo.st_size);
+    m_opened = true;
+    if (m_size == 0) return true;
+
+    void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+    if (mapped == MAP_FAILED) {
+        close();
+        return false;
+    }
+    m_data = static_cast<const char*>(mapped);
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+#if defined(_WIN32)
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mappingHandle) CloseHandle(m_mappingHandle);
+    if (m_fileHandle != INVALID_HANDLE_VALUE) CloseHandle(m_fileHandle);
+    m_mappingHandle = nullptr;
+    m_fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (m_data) munmap(const_cast<char*>(m_data), m_size);
+    if (m_fileDescriptor >= 0) ::close(m_fileDescriptor);
+    m_fileDescriptor = -1;
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_opened = false;
+}
+
+void MappedFile::adviseSequential() const {
+#if !defined(_WIN32)
+    if (m_data) madvise(const_cast<char*>(m_data), m_size, MADV_SEQUENTIAL);
+#endif
+}
@@ -0,0 +1,39 @@
+﻿#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Файл, отображенный в память только для чтения (mmap / CreateFileMapping).
+// Данные подгружаются операционной системой по страницам при первом обращении, без копирования
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+
+    bool isOpen() const { return m_opened; }
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    // Подсказка системе, что файл будет читаться последовательно (упреждающее чтение страниц)
+    void adviseSequential() const;
+
+private:
+    const char* m_data;
+    size_t m_size;
+    bool m_opened;
+#if defined(_WIN32)
+    void* m_fileHandle;
+    void* m_mappingHandle;
+#else
+    int m_fileDescriptor;
+#endif
+};
+
+#endif // MAPPEDFILE_H
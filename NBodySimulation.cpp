@@ -0,0 +1,191 @@
+﻿#include "NBodySimulation.h"
+
+#include <algorithm> // Для std::min, std::max
+#include <chrono>
+#include <cmath>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(Clock::time_point started) {
+        return std::chrono::duration<double>(Clock::now() - started).count();
+    }
+
+    // Генератор xorshift32: в отличие от распределений <random> дает одинаковую последовательность
+    // на всех стандартных библиотеках
+    double nextUniform(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state / 4294967296.0;
+    }
+}
+
+NBodySimulation::NBodySimulation(unsigned int threadCount)
+    : m_pool(threadCount) {
+}
+
+void NBodySimulation::setBodies(const std::vector<Body>& bodies) {
+    const size_t count = bodies.size();
+    m_x.resize(count); m_y.resize(count); m_vx.resize(count); m_vy.resize(count);
+    m_ax.assign(count, 0.0); m_ay.assign(count, 0.0);
+    m_mass.resize(count);
+    m_id.resize(count);
+    m_position.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        m_x[i] = bodies[i].state.x;
+        m_y[i] = bodies[i].state.y;
+        m_vx[i] = bodies[i].state.vx;
+        m_vy[i] = bodies[i].state.vy;
+        m_mass[i] = bodies[i].mass;
+        m_id[i] = static_cast<uint32_t>(i);
+        m_position[i] = static_cast<uint32_t>(i);
+    }
+    m_time = 0.0;
+    m_steps = 0;
+    m_lastStats = NBodyStepStats();
+    updateAccelerations();
+}
+
+Body NBodySimulation::body(size_t index) const {
+    const size_t p = m_position[index];
+    return { { m_x[p], m_y[p], m_vx[p], m_vy[p] }, m_mass[p] };
+}
+
+std::vector<Body> NBodySimulation::bodies() const {
+    std::vector<Body> result(bodyCount());
+    for (size_t i = 0; i < result.size(); ++i) {
+        result[i] = body(i);
+    }
+    return result;
+}
+
+void NBodySimulation::reorder(const std::vector<uint32_t>& order) {
+    const size_t count = order.size();
+    m_scratch.resize(count);
+    auto gather = [&](std::vector<double>& values) {
+        m_pool.parallelFor(count, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) m_scratch[k] = values[order[k]];
+        });
+        values.swap(m_scratch);
+    };
+    gather(m_x);
+    gather(m_y);
+    gather(m_vx);
+    gather(m_vy);
+    gather(m_mass);
+
+    std::vector<uint32_t> ids(count);
+    m_pool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            ids[k] = m_id[order[k]];
+            m_position[ids[k]] = static_cast<uint32_t>(k);
+        }
+    });
+    m_id.swap(ids);
+}
+
+void NBodySimulation::updateAccelerations() {
+    const size_t count = bodyCount();
+    if (count == 0) return;
+
+    auto started = Clock::now();
+    BarnesHutTree::sortOrder(m_x.data(), m_y.data(), count, m_order, m_pool);
+    reorder(m_order);
+    m_lastStats.sortSeconds = secondsSince(started);
+
+    started = Clock::now();
+    m_tree.build(m_x.data(), m_y.data(), m_mass.data(), count, m_pool);
+    m_lastStats.buildSeconds = secondsSince(started);
+    m_lastStats.nodes = m_tree.nodeCount();
+
+    started = Clock::now();
+    m_lastStats.interactions = m_tree.computeAccelerations(m_params.G, m_params.THETA, m_params.SOFTENING,
+        m_ax.data(), m_ay.data(), m_pool);
+    m_lastStats.forceSeconds = secondsSince(started);
+}
+
+void NBodySimulation::step() {
+    const size_t count = bodyCount();
+    const double dt = m_params.DT;
+    // Толчок на половину шага и сдвиг; ускорения вычислены в текущих положениях
+    m_pool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            m_vx[i] += 0.5 * dt * m_ax[i];
+            m_vy[i] += 0.5 * dt * m_ay[i];
+            m_x[i] += dt * m_vx[i];
+            m_y[i] += dt * m_vy[i];
+        }
+    });
+    updateAccelerations();
+    m_pool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            m_vx[i] += 0.5 * dt * m_ax[i];
+            m_vy[i] += 0.5 * dt * m_ay[i];
+        }
+    });
+    ++m_steps;
+    m_time = m_steps * dt;
+}
+
+std::vector<std::vector<State>> NBodySimulation::run(const std::vector<size_t>& recordedBodies, long long stride) {
+    stride = std::max<long long>(1, stride);
+    std::vector<std::vector<State>> trajectories(recordedBodies.size());
+    for (auto& trajectory : trajectories) {
+        trajectory.reserve(static_cast<size_t>(m_params.STEPS / stride) + 1);
+    }
+    auto record = [&]() {
+        for (size_t r = 0; r < recordedBodies.size(); ++r) {
+            trajectories[r].push_back(body(recordedBodies[r]).state);
+        }
+    };
+
+    record();
+    for (int i = 1; i <= m_params.STEPS; ++i) {
+        step();
+        if (i % stride == 0) record();
+    }
+    return trajectories;
+}
+
+double NBodySimulation::totalEnergy() {
+    const size_t count = bodyCount();
+    const double softeningSquared = m_params.SOFTENING * m_params.SOFTENING;
+    std::vector<double> partial(count, 0.0);
+    m_pool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            double potential = 0.0;
+            for (size_t j = i + 1; j < count; ++j) {
+                const double dx = m_x[j] - m_x[i], dy = m_y[j] - m_y[i];
+                potential -= m_mass[j] / std::sqrt(dx * dx + dy * dy + softeningSquared);
+            }
+            const double kinetic = 0.5 * (m_vx[i] * m_vx[i] + m_vy[i] * m_vy[i]);
+            partial[i] = m_mass[i] * (kinetic + m_params.G * potential);
+        }
+    });
+    double total = 0.0;
+    for (double value : partial) total += value;
+    return total;
+}
+
+std::vector<Body> NBodySimulation::makeDisk(size_t count, double centralMass, double innerRadius, double outerRadius,
+    double G, uint32_t seed) {
+    std::vector<Body> bodies;
+    if (count == 0) return bodies;
+    bodies.reserve(count);
+    bodies.push_back({ { 0.0, 0.0, 0.0, 0.0 }, centralMass });
+
+    const double bodyMass = (count > 1) ? centralMass * 1e-3 / static_cast<double>(count - 1) : 0.0;
+    uint32_t state = seed != 0 ? seed : 1u;
+    const double innerSquared = innerRadius * innerRadius, outerSquared = outerRadius * outerRadius;
+    const double twoPi = 2.0 * std::acos(-1.0);
+    for (size_t i = 1; i < count; ++i) {
+        // Равномерно по площади кольца
+        const double r = std::sqrt(innerSquared + (outerSquared - innerSquared) * nextUniform(state));
+        const double angle = twoPi * nextUniform(state);
+        const double speed = std::sqrt(G * centralMass / r);
+        const double c = std::cos(angle), s = std::sin(angle);
+        bodies.push_back({ { r * c, r * s, -speed * s, speed * c }, bodyMass });
+    }
+    return bodies;
+}
@@ -0,0 +1,99 @@
+﻿#ifndef NBODYSIMULATION_H
+#define NBODYSIMULATION_H
+
+#include "BarnesHutTree.h"
+#include "Calculations.h" // State
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+// Параметры режима N тел
+struct NBodyParameters {
+    double G = 1.0;
+    double THETA = 0.5;       // Критерий Барнса-Хата: узел размера s на расстоянии d принимается целиком при s / d < THETA
+    double SOFTENING = 1e-3;  // Сглаживающая длина: убирает бесконечные ускорения при сближениях
+    double DT = 0.001;
+    int STEPS = 1000;
+};
+
+// Тело: состояние в тех же обозначениях, что и у пробного тела Calculations, и масса
+struct Body {
+    State state;
+    double mass;
+};
+
+// Статистика последнего шага
+struct NBodyStepStats {
+    double sortSeconds = 0.0;   // Упорядочивание тел по коду Мортона
+    double buildSeconds = 0.0;  // Построение дерева
+    double forceSeconds = 0.0;  // Вычисление ускорений
+    long long interactions = 0; // Число вычисленных взаимодействий тело-узел и тело-тело
+    size_t nodes = 0;
+};
+
+// Режим N взаимодействующих тел. Ускорения вычисляются деревом Барнса-Хата за O(N log N),
+// построение дерева и проход по телам выполняются в пуле потоков. Интегрирование - скоростным
+// методом Верле ("толчок-сдвиг-толчок"): силы зависят только от положений, а метод симплектический,
+// как IntegratorType::VelocityVerlet у пробного тела.
+// Тела хранятся в порядке дерева (по коду Мортона), но снаружи адресуются исходными номерами
+class NBodySimulation {
+public:
+    // threadCount == 0 - по числу аппаратных потоков машины
+    explicit NBodySimulation(unsigned int threadCount = 0);
+
+    void setParameters(const NBodyParameters& params) { m_params = params; }
+    const NBodyParameters& getParameters() const { return m_params; }
+
+    // Задать тела и вычислить начальные ускорения; время и счетчик шагов сбрасываются
+    void setBodies(const std::vector<Body>& bodies);
+
+    size_t bodyCount() const { return m_x.size(); }
+    Body body(size_t index) const; // По исходному номеру
+    std::vector<Body> bodies() const;
+    double time() const { return m_time; }
+    long long stepCount() const { return m_steps; }
+
+    // Один шаг длиной DT
+    void step();
+
+    // STEPS шагов с записью траекторий выбранных тел (исходные номера) через каждые stride шагов,
+    // включая начальное состояние. i-я траектория - для recordedBodies[i], в формате Calculations::runSimulation,
+    // поэтому ее можно передать в визуализатор, таблицу или saveTrajectoryToBinaryFile
+    std::vector<std::vector<State>> run(const std::vector<size_t>& recordedBodies, long long stride = 1);
+
+    // Полная энергия (кинетическая + потенциальная со сглаживанием) прямым суммированием за O(N²).
+    // Для контроля точности на небольших системах
+    double totalEnergy();
+
+    const NBodyStepStats& getLastStepStats() const { return m_lastStats; }
+    unsigned int getThreadCount() const { return m_pool.getThreadCount(); }
+
+    // Модельная система для проверок и замеров: тяжелое центральное тело (номер 0) и count - 1 легких тел
+    // общей массой 0.1% центральной на круговых орбитах в кольце радиусов [innerRadius, outerRadius].
+    // seed задает распределение, одинаковое на всех платформах
+    static std::vector<Body> makeDisk(size_t count, double centralMass, double innerRadius, double outerRadius,
+        double G = 1.0, uint32_t seed = 1);
+
+private:
+    // Упорядочить тела по коду Мортона, построить дерево и вычислить ускорения
+    void updateAccelerations();
+    void reorder(const std::vector<uint32_t>& order);
+
+    NBodyParameters m_params;
+    ThreadPool m_pool;
+    BarnesHutTree m_tree;
+
+    // Структура массивов в порядке дерева
+    std::vector<double> m_x, m_y, m_vx, m_vy, m_ax, m_ay, m_mass;
+    std::vector<uint32_t> m_id;       // Исходный номер тела на каждой позиции
+    std::vector<uint32_t> m_position; // Позиция тела по исходному номеру
+    std::vector<uint32_t> m_order;
+    std::vector<double> m_scratch;
+
+    double m_time = 0.0;
+    long long m_steps = 0;
+    NBodyStepStats m_lastStats;
+};
+
+#endif // NBODYSIMULATION_H
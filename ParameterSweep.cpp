@@ -0,0 +1,82 @@
+﻿#include "ParameterSweep.h"
+#include "EnsembleIntegrator.h"
+
+#include <algorithm> // Для std::min, std::copy
+
+SweepAxis SweepAxis::linspace(SweepParameter parameter, double first, double last, size_t count) {
+    SweepAxis axis{ parameter, {} };
+    axis.values.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        double fraction = (count > 1) ? static_cast<double>(i) / static_cast<double>(count - 1) : 0.0;
+        axis.values.push_back(first + (last - first) * fraction);
+    }
+    return axis;
+}
+
+ParameterSweep::ParameterSweep(unsigned int threadCount)
+    : m_pool(threadCount) {
+}
+
+std::vector<SimulationParameters> ParameterSweep::makeGrid(const SimulationParameters& base, const std::vector<SweepAxis>& axes) {
+    size_t total = 1;
+    for (const auto& axis : axes) {
+        total *= axis.values.size();
+    }
+
+    std::vector<SimulationParameters> grid;
+    grid.reserve(total);
+    for (size_t index = 0; index < total; ++index) {
+        SimulationParameters params = base;
+        // Разложение линейного индекса по осям, последняя ось - младший разряд
+        size_t rest = index;
+        for (size_t a = axes.size(); a-- > 0;) {
+            const auto& values = axes[a].values;
+            applyValue(params, axes[a].parameter, values[rest % values.size()]);
+            rest /= values.size();
+        }
+        grid.push_back(params);
+    }
+    return grid;
+}
+
+std::vector<SimulationSummary> ParameterSweep::run(const std::vector<SimulationParameters>& parameterSets) {
+    std::vector<SimulationSummary> results(parameterSets.size());
+    // Запуски независимы и пишут каждый в свою ячейку results, синхронизация не нужна.
+    // Задача - один блок ансамблевого интегратора: соседние наборы сетки обычно совместимы
+    // и считаются синхронно в SIMD-дорожках, а мелкие задачи дают перехвату работы выровнять
+    // запуски разной длины (например, с ранним столкновением)
+    const size_t blockSize = EnsembleIntegrator::LANES;
+    const size_t blockCount = (parameterSets.size() + blockSize - 1) / blockSize;
+    m_pool.parallelFor(blockCount, [&](size_t beginBlock, size_t endBlock) {
+        EnsembleIntegrator integrator;
+        for (size_t block = beginBlock; block < endBlock; ++block) {
+            size_t begin = block * blockSize;
+            size_t end = std::min(parameterSets.size(), begin + blockSize);
+            std::vector<SimulationParameters> blockSets(parameterSets.begin() + begin, parameterSets.begin() + end);
+            std::vector<SimulationSummary> blockResults = integrator.run(blockSets);
+            std::copy(blockResults.begin(), blockResults.end(), results.begin() + begin);
+        }
+    }, 1);
+    return results;
+}
+
+std::vector<SimulationSummary> ParameterSweep::runGrid(const SimulationParameters& base, const std::vector<SweepAxis>& axes) {
+    return run(makeGrid(base, axes));
+}
+
+void ParameterSweep::applyValue(SimulationParameters& params, SweepParameter parameter, double value) {
+    switch (parameter) {
+    case SweepParameter::CentralMass:
+        params.M = value;
+        break;
+    case SweepParameter::DragCoefficient:
+        params.DRAG_COEFFICIENT = value;
+        break;
+    case SweepParameter::ThrustCoefficient:
+        params.THRUST_COEFFICIENT = value;
+        break;
+    case SweepParameter::InitialVy:
+        params.initialState.vy = value;
+        break;
+    }
+}
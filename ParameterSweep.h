@@ -0,0 +1,50 @@
+﻿#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include "Calculations.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+// Параметр, который варьируется вдоль оси сетки
+enum class SweepParameter {
+    CentralMass,       // SimulationParameters::M
+    DragCoefficient,   // SimulationParameters::DRAG_COEFFICIENT
+    ThrustCoefficient, // SimulationParameters::THRUST_COEFFICIENT
+    InitialVy          // SimulationParameters::initialState.vy
+};
+
+// Ось сетки: параметр и список его значений
+struct SweepAxis {
+    SweepParameter parameter;
+    std::vector<double> values;
+
+    // count равномерно распределенных значений от first до last включительно
+    static SweepAxis linspace(SweepParameter parameter, double first, double last, size_t count);
+};
+
+// Массовый запуск симуляций по набору параметров.
+// Запуски выполняются блоками EnsembleIntegrator (или Calculations::runSummary для несовместимых наборов),
+// поэтому полные траектории в памяти не хранятся
+class ParameterSweep {
+public:
+    // threadCount == 0 - по числу аппаратных потоков машины
+    explicit ParameterSweep(unsigned int threadCount = 0);
+
+    // Декартово произведение осей поверх базовых параметров. Последняя ось меняется быстрее всего
+    static std::vector<SimulationParameters> makeGrid(const SimulationParameters& base, const std::vector<SweepAxis>& axes);
+
+    // Запустить все наборы параметров; i-й результат соответствует i-му набору
+    std::vector<SimulationSummary> run(const std::vector<SimulationParameters>& parameterSets);
+
+    std::vector<SimulationSummary> runGrid(const SimulationParameters& base, const std::vector<SweepAxis>& axes);
+
+    unsigned int getThreadCount() const { return m_pool.getThreadCount(); }
+
+private:
+    static void applyValue(SimulationParameters& params, SweepParameter parameter, double value);
+
+    ThreadPool m_pool;
+};
+
+#endif // PARAMETERSWEEP_H
@@ -0,0 +1,182 @@
+﻿#include "PararealIntegrator.h"
+
+#include <algorithm> // Для std::min, std::max
+#include <cmath>     // Для std::abs, std::sqrt
+
+namespace {
+    State initialStateOf(const SimulationParameters& params) {
+        return { params.initialState.x, params.initialState.y, params.initialState.vx, params.initialState.vy };
+    }
+
+    double radius(const State& s) {
+        return std::sqrt(s.x * s.x + s.y * s.y);
+    }
+
+    // Грубый метод: RK4 с крупным шагом от state на отрезке длительностью duration
+    SimulationSummary coarsePropagate(const SimulationParameters& params, const State& state, double duration,
+        long long fineSteps, long long stepFactor) {
+        SimulationParameters coarse = params;
+        coarse.INTEGRATOR = IntegratorType::RungeKutta4;
+        coarse.STEPS = static_cast<int>(std::max(1LL, (fineSteps + stepFactor - 1) / stepFactor));
+        coarse.DT = duration / coarse.STEPS;
+        coarse.initialState = { state.x, state.y, state.vx, state.vy };
+        Calculations calculator;
+        return calculator.runSummary(coarse);
+    }
+
+    // Наибольшая поправка компонент в долях допуска
+    double correctionNorm(const State& updated, const State& previous, double tolerance) {
+        const double a[4] = { updated.x, updated.y, updated.vx, updated.vy };
+        const double b[4] = { previous.x, previous.y, previous.vx, previous.vy };
+        double norm = 0.0;
+        for (int i = 0; i < 4; ++i) {
+            const double scale = 1.0 + std::max(std::abs(a[i]), std::abs(b[i]));
+            const double difference = std::abs(a[i] - b[i]);
+            // NaN (грубый метод расходится) - не сошлось
+            norm = std::max(norm, difference == difference ? difference / (tolerance * scale) : HUGE_VAL);
+        }
+        return norm;
+    }
+
+    State add(const State& a, const State& b) { return { a.x + b.x, a.y + b.y, a.vx + b.vx, a.vy + b.vy }; }
+    State subtract(const State& a, const State& b) { return { a.x - b.x, a.y - b.y, a.vx - b.vx, a.vy - b.vy }; }
+}
+
+PararealIntegrator::PararealIntegrator(unsigned int threadCount)
+    : m_pool(threadCount) {
+}
+
+SimulationSummary PararealIntegrator::runSummary(const SimulationParameters& params, const PararealOptions& options) {
+    return run(params, options, nullptr);
+}
+
+std::vector<State> PararealIntegrator::runSimulation(const SimulationParameters& params, const PararealOptions& options) {
+    std::vector<State> states;
+    run(params, options, &states);
+    return states;
+}
+
+SimulationSummary PararealIntegrator::run(const SimulationParameters& params, const PararealOptions& options,
+    std::vector<State>* states) {
+    m_lastStats = PararealStats();
+    const long long totalSteps = params.STEPS;
+    const State initialState = initialStateOf(params);
+    size_t sliceCount = options.slices ? options.slices : m_pool.getThreadCount();
+    sliceCount = static_cast<size_t>(std::min<long long>(static_cast<long long>(sliceCount),
+        totalSteps / std::max<long long>(1, static_cast<long long>(options.minSliceSteps))));
+
+    // Отрезки по числу шагов существуют только у методов с постоянным шагом
+    if (sliceCount < 2 || !isFixedStepIntegrator(Calculations::effectiveIntegrator(params))
+        || radius(initialState) < params.CENTRAL_BODY_RADIUS) {
+        m_lastStats.slices = 1;
+        m_lastStats.iterations = 1;
+        m_lastStats.converged = true;
+        Calculations calculator;
+        if (!states) return calculator.runSummary(params);
+        *states = calculator.runSimulation(params);
+        return calculator.getLastSummary();
+    }
+
+    // Отрезок j - шаги (boundaries[j], boundaries[j + 1]]
+    std::vector<long long> boundaries(sliceCount + 1);
+    for (size_t j = 0; j <= sliceCount; ++j) {
+        boundaries[j] = totalSteps * static_cast<long long>(j) / static_cast<long long>(sliceCount);
+    }
+    const long long stepFactor = std::max<long long>(1, options.coarseStepFactor);
+    const size_t maxIterations = options.maxIterations ? std::min(options.maxIterations, sliceCount) : sliceCount;
+    const double tolerance = options.tolerance;
+    long long coarseEvaluations = 0;
+    long long fineEvaluations = 0;
+
+    auto coarse = [&](size_t slice, const State& state) {
+        const long long fineSteps = boundaries[slice + 1] - boundaries[slice];
+        SimulationSummary result = coarsePropagate(params, state, fineSteps * params.DT, fineSteps, stepFactor);
+        coarseEvaluations += result.derivativeEvaluations;
+        return result.finalState;
+    };
+
+    // start[j] - начальное состояние отрезка j, coarseEnd[j] - грубый результат от start[j]
+    std::vector<State> start(sliceCount + 1);
+    std::vector<State> coarseEnd(sliceCount);
+    start[0] = initialState;
+    for (size_t j = 0; j < sliceCount; ++j) {
+        coarseEnd[j] = coarse(j, start[j]);
+        start[j + 1] = coarseEnd[j];
+    }
+
+    if (states) {
+        states->assign(static_cast<size_t>(totalSteps) + 1, State{ 0, 0, 0, 0 });
+        (*states)[0] = initialState;
+    }
+    std::vector<SimulationSummary> fine(sliceCount);
+    size_t exactSlices = 0;        // Отрезки [0, exactSlices) уже совпадают с последовательным расчетом
+    size_t lastSlice = sliceCount; // Отрезок столкновения + 1: дальше траектории нет
+    while (m_lastStats.iterations < maxIterations) {
+        ++m_lastStats.iterations;
+        // Точный метод на всех еще не точных отрезках. Каждая задача пишет только в свои
+        // элементы fine и states, синхронизация не нужна
+        const size_t first = exactSlices;
+        m_pool.parallelFor(sliceCount - first, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const size_t j = first + i;
+                SimulationParameters sliceParams = params;
+                sliceParams.STEPS = static_cast<int>(boundaries[j + 1]);
+                SimulationSummary from;
+                from.finalState = start[j];
+                from.finalTime = boundaries[j] * params.DT;
+                from.steps = boundaries[j];
+                from.minRadius = from.maxRadius = radius(start[j]);
+                StreamOptions streamOptions;
+                streamOptions.reportImpact = false;
+                streamOptions.includeFinal = false;
+                streamOptions.stride = states ? 1 : totalSteps + 1; // Без сохранения sink не вызывается
+                Calculations calculator;
+                fine[j] = calculator.continueSimulation(sliceParams, from, [states](long long step, double, const State& s) {
+                    (*states)[static_cast<size_t>(step)] = s;
+                    return true;
+                }, streamOptions);
+            }
+        }, 1);
+        // Столкновение на неточном отрезке может исчезнуть после уточнения, поэтому ищется заново
+        lastSlice = sliceCount;
+        for (size_t j = first; j < sliceCount; ++j) {
+            fineEvaluations += fine[j].derivativeEvaluations;
+            if (fine[j].impactStep >= 0 && lastSlice == sliceCount) lastSlice = j + 1;
+        }
+
+        // Поправка: start[j + 1] = F(start[j]) + G(новое start[j]) - G(старое start[j]).
+        // Начало первого неточного отрезка уже точное, поэтому его конец - просто F(start[j])
+        double correction = 0.0;
+        for (size_t j = first; j < lastSlice; ++j) {
+            State updated = fine[j].finalState;
+            if (j != first) {
+                const State updatedCoarse = coarse(j, start[j]);
+                updated = add(updated, subtract(updatedCoarse, coarseEnd[j]));
+                coarseEnd[j] = updatedCoarse;
+            }
+            if (j + 1 < lastSlice) correction = std::max(correction, correctionNorm(updated, start[j + 1], tolerance));
+            start[j + 1] = updated;
+        }
+        exactSlices = first + 1;
+        m_lastStats.lastCorrection = correction;
+        if (exactSlices >= lastSlice || (tolerance > 0.0 && correction <= 1.0)) {
+            m_lastStats.converged = true;
+            break;
+        }
+    }
+    m_lastStats.slices = sliceCount;
+    m_lastStats.parallel = true;
+
+    // Сводка из точных проходов последней итерации
+    SimulationSummary summary = fine[lastSlice - 1];
+    summary.minRadius = fine[0].minRadius;
+    summary.maxRadius = fine[0].maxRadius;
+    for (size_t j = 1; j < lastSlice; ++j) {
+        summary.minRadius = std::min(summary.minRadius, fine[j].minRadius);
+        summary.maxRadius = std::max(summary.maxRadius, fine[j].maxRadius);
+    }
+    summary.derivativeEvaluations = fineEvaluations + coarseEvaluations;
+    summary.nextStepSize = 0.0;
+    if (states) states->resize(static_cast<size_t>(summary.steps) + 1);
+    return summary;
+}
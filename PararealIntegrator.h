@@ -0,0 +1,62 @@
+﻿#ifndef PARAREALINTEGRATOR_H
+#define PARAREALINTEGRATOR_H
+
+#include "Calculations.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+// Настройки параллельного по времени расчета
+struct PararealOptions {
+    size_t slices = 0;              // Отрезков времени; 0 - по числу потоков пула
+    long long coarseStepFactor = 64; // Шаг грубого метода (RK4) во столько раз больше DT
+    // Сходимость: поправка каждой компоненты состояния на границах отрезков не больше
+    // tolerance * (1 + |компонента|). 0 - итерации до совпадения с последовательным расчетом
+    double tolerance = 1e-10;
+    size_t maxIterations = 0;       // 0 - не больше числа отрезков
+    size_t minSliceSteps = 1000;    // Более короткие отрезки не выгодны, их число уменьшается
+};
+
+// Как прошел последний расчет
+struct PararealStats {
+    size_t slices = 0;
+    size_t iterations = 0;          // Параллельных проходов точного метода
+    bool converged = false;         // Поправка опустилась ниже допуска (или отрезки кончились)
+    double lastCorrection = 0.0;    // Наибольшая поправка последней итерации в долях допуска
+    bool parallel = false;          // false - расчет выполнен последовательно (см. run)
+};
+
+// Parareal: длинный расчет с постоянным шагом делится на отрезки времени. Дешевый грубый метод
+// (RK4 с шагом coarseStepFactor * DT) последовательно дает начальные состояния отрезков, точный
+// метод (интегратор из параметров, через Calculations::continueSimulation) уточняет все отрезки
+// параллельно, а поправка G(новое) + F(старое) - G(старое) переносит уточнение на следующие
+// отрезки. После k итераций первые k отрезков совпадают с последовательным расчетом побитно,
+// поэтому при tolerance = 0 результат тот же, что и у Calculations. Выигрыш по времени - примерно
+// slices / iterations без учета грубых проходов, т.е. для гладких орбит без сильного сопротивления,
+// где грубый метод близок к точному и хватает нескольких итераций.
+// Адаптивный метод, короткие расчеты и старт внутри центрального тела считаются последовательно
+class PararealIntegrator {
+public:
+    // threadCount == 0 - по числу аппаратных потоков машины
+    explicit PararealIntegrator(unsigned int threadCount = 0);
+
+    // То же, что Calculations::runSummary. Минимальный и максимальный радиус и шаг столкновения
+    // берутся из точного прохода последней итерации; derivativeEvaluations - все вычисления правой
+    // части обоих методов за все итерации (реальная стоимость расчета)
+    SimulationSummary runSummary(const SimulationParameters& params, const PararealOptions& options = PararealOptions());
+
+    // То же, что Calculations::runSimulation: все STEPS + 1 состояний (до столкновения включительно)
+    std::vector<State> runSimulation(const SimulationParameters& params, const PararealOptions& options = PararealOptions());
+
+    const PararealStats& getLastStats() const { return m_lastStats; }
+    unsigned int getThreadCount() const { return m_pool.getThreadCount(); }
+
+private:
+    // states != nullptr - сохранить все состояния последнего точного прохода
+    SimulationSummary run(const SimulationParameters& params, const PararealOptions& options, std::vector<State>* states);
+
+    ThreadPool m_pool;
+    PararealStats m_lastStats;
+};
+
+#endif // PARAREALINTEGRATOR_H
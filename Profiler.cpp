@@ -0,0 +1,183 @@
+﻿#include "Profiler.h"
+
+#include <algorithm> // Для std::max, std::upper_bound
+#include <charconv>  // Для std::to_chars (не зависит от setlocale)
+#include <fstream>
+#include <iostream>
+
+namespace {
+    void appendNumber(std::string& out, double value, int precision = 6) {
+        char buffer[64];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, precision);
+        out.append(buffer, result.ptr);
+    }
+
+    void appendPadded(std::string& out, const char* text, size_t width) {
+        size_t length = out.size();
+        out += text;
+        while (out.size() - length < width) out += ' ';
+    }
+}
+
+void Profiler::setEnabled(bool enabled) {
+    m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_phases.fill(PhaseStats());
+    m_frames = FrameStats();
+    for (auto& counter : m_counters) counter.store(0, std::memory_order_relaxed);
+}
+
+void Profiler::addTime(ProfilePhase phase, double seconds) {
+    if (!isEnabled()) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    PhaseStats& stats = m_phases[static_cast<size_t>(phase)];
+    ++stats.calls;
+    stats.totalSeconds += seconds;
+    stats.lastSeconds = seconds;
+    stats.maxSeconds = std::max(stats.maxSeconds, seconds);
+}
+
+void Profiler::recordFrame(double seconds) {
+    if (!isEnabled()) return;
+    const double milliseconds = seconds * 1000.0;
+    const size_t bucket = static_cast<size_t>(std::upper_bound(FRAME_BUCKET_LIMITS_MS.begin(),
+        FRAME_BUCKET_LIMITS_MS.end(), milliseconds) - FRAME_BUCKET_LIMITS_MS.begin());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_frames.frames;
+    m_frames.totalSeconds += seconds;
+    m_frames.lastSeconds = seconds;
+    m_frames.maxSeconds = std::max(m_frames.maxSeconds, seconds);
+    ++m_frames.histogram[bucket];
+}
+
+Profiler::PhaseStats Profiler::phase(ProfilePhase phase) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_phases[static_cast<size_t>(phase)];
+}
+
+Profiler::FrameStats Profiler::frames() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_frames;
+}
+
+const char* Profiler::phaseName(ProfilePhase phase) {
+    switch (phase) {
+    case ProfilePhase::Simulation: return "simulation";
+    case ProfilePhase::TrajectoryLoad: return "trajectory_load";
+    case ProfilePhase::LodBuild: return "lod_build";
+    case ProfilePhase::VertexPreparation: return "vertex_preparation";
+    case ProfilePhase::TableUpdate: return "table_update";
+    case ProfilePhase::CanvasDraw: return "canvas_draw";
+    case ProfilePhase::GuiDraw: return "gui_draw";
+    default: return "unknown";
+    }
+}
+
+const char* Profiler::counterName(ProfileCounter counter) {
+    switch (counter) {
+    case ProfileCounter::IntegrationSteps: return "integration_steps";
+    case ProfileCounter::TrajectoryNodes: return "trajectory_nodes";
+    case ProfileCounter::VerticesPrepared: return "vertices_prepared";
+    case ProfileCounter::TableRowsFormatted: return "table_rows_formatted";
+    case ProfileCounter::CanvasRedraws: return "canvas_redraws";
+    default: return "unknown";
+    }
+}
+
+std::string Profiler::overlayText() const {
+    std::array<PhaseStats, PHASE_COUNT> phases;
+    FrameStats frameStats;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        phases = m_phases;
+        frameStats = m_frames;
+    }
+
+    std::string text = "Profiling (ms: last / avg / max)\n";
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        const PhaseStats& stats = phases[i];
+        if (stats.calls == 0) continue;
+        appendPadded(text, phaseName(static_cast<ProfilePhase>(i)), 20);
+        appendNumber(text, stats.lastSeconds * 1000.0, 2);
+        text += " / ";
+        appendNumber(text, stats.totalSeconds * 1000.0 / static_cast<double>(stats.calls), 2);
+        text += " / ";
+        appendNumber(text, stats.maxSeconds * 1000.0, 2);
+        text += "  x" + std::to_string(stats.calls) + "\n";
+    }
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        const long long value = counter(static_cast<ProfileCounter>(i));
+        if (value == 0) continue;
+        appendPadded(text, counterName(static_cast<ProfileCounter>(i)), 20);
+        text += std::to_string(value) + "\n";
+    }
+    if (frameStats.frames > 0) {
+        text += "frames " + std::to_string(frameStats.frames) + ", avg ";
+        appendNumber(text, frameStats.totalSeconds * 1000.0 / static_cast<double>(frameStats.frames), 2);
+        text += " ms, max ";
+        appendNumber(text, frameStats.maxSeconds * 1000.0, 2);
+        text += " ms\n";
+        for (size_t b = 0; b < FRAME_BUCKETS; ++b) {
+            text += (b < FRAME_BUCKET_LIMITS_MS.size()) ? "  <" : "  >";
+            appendNumber(text, FRAME_BUCKET_LIMITS_MS[std::min(b, FRAME_BUCKET_LIMITS_MS.size() - 1)], 1);
+            text += " ms: " + std::to_string(frameStats.histogram[b]) + "\n";
+        }
+    }
+    return text;
+}
+
+void Profiler::writeJson(std::ostream& out) const {
+    std::array<PhaseStats, PHASE_COUNT> phases;
+    FrameStats frameStats;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        phases = m_phases;
+        frameStats = m_frames;
+    }
+
+    std::string json = "{\n  \"phases\": {";
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        const PhaseStats& stats = phases[i];
+        json += (i == 0) ? "\n    \"" : ",\n    \"";
+        json += phaseName(static_cast<ProfilePhase>(i));
+        json += "\": {\"calls\": " + std::to_string(stats.calls) + ", \"total_seconds\": ";
+        appendNumber(json, stats.totalSeconds, 9);
+        json += ", \"last_seconds\": ";
+        appendNumber(json, stats.lastSeconds, 9);
+        json += ", \"max_seconds\": ";
+        appendNumber(json, stats.maxSeconds, 9);
+        json += "}";
+    }
+    json += "\n  },\n  \"counters\": {";
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        json += (i == 0) ? "\n    \"" : ",\n    \"";
+        json += counterName(static_cast<ProfileCounter>(i));
+        json += "\": " + std::to_string(counter(static_cast<ProfileCounter>(i)));
+    }
+    json += "\n  },\n  \"frames\": {\"count\": " + std::to_string(frameStats.frames) + ", \"total_seconds\": ";
+    appendNumber(json, frameStats.totalSeconds, 9);
+    json += ", \"max_seconds\": ";
+    appendNumber(json, frameStats.maxSeconds, 9);
+    json += ",\n    \"histogram_ms\": [";
+    for (size_t b = 0; b < FRAME_BUCKETS; ++b) {
+        json += (b == 0) ? "{\"le\": " : ", {\"le\": ";
+        if (b < FRAME_BUCKET_LIMITS_MS.size()) appendNumber(json, FRAME_BUCKET_LIMITS_MS[b], 1);
+        else json += "null";
+        json += ", \"count\": " + std::to_string(frameStats.histogram[b]) + "}";
+    }
+    json += "]}\n}\n";
+    out << json;
+}
+
+bool Profiler::writeJson(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Ошибка: не удалось открыть файл '" << filename << "' для записи замеров.\n";
+        return false;
+    }
+    writeJson(file);
+    return static_cast<bool>(file);
+}
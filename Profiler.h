@@ -0,0 +1,127 @@
+﻿#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+
+// Замеряемые этапы работы программы
+enum class ProfilePhase {
+    Simulation,         // Расчет траектории (рабочий поток)
+    TrajectoryLoad,     // Загрузка траектории из файла
+    LodBuild,           // Построение уровней детализации
+    VertexPreparation,  // Вершины для отрисовки выбранного уровня
+    TableUpdate,        // Заполнение видимых строк таблицы
+    CanvasDraw,         // Отрисовка траектории
+    GuiDraw,            // Отрисовка интерфейса и вывод кадра
+    Count
+};
+
+// Счетчики событий
+enum class ProfileCounter {
+    IntegrationSteps,
+    TrajectoryNodes,
+    VerticesPrepared,
+    TableRowsFormatted,
+    CanvasRedraws,
+    Count
+};
+
+// Встроенные замеры: время этапов, счетчики и гистограмма длительности кадров.
+// По умолчанию выключены; в выключенном состоянии каждый замер стоит одной атомарной загрузки
+// и ветвления, поэтому вызовы можно оставлять в рабочем коде. Потокобезопасен: этапы
+// рабочего потока расчета и главного потока складываются в одни и те же итоги
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Верхние границы интервалов гистограммы кадров, мс; последний интервал - все, что длиннее
+    static constexpr std::array<double, 7> FRAME_BUCKET_LIMITS_MS = { 2.0, 4.0, 8.0, 16.7, 33.3, 50.0, 100.0 };
+    static constexpr size_t FRAME_BUCKETS = FRAME_BUCKET_LIMITS_MS.size() + 1;
+
+    struct PhaseStats {
+        long long calls = 0;
+        double totalSeconds = 0.0;
+        double lastSeconds = 0.0;
+        double maxSeconds = 0.0;
+    };
+
+    struct FrameStats {
+        long long frames = 0;
+        double totalSeconds = 0.0;
+        double lastSeconds = 0.0;
+        double maxSeconds = 0.0;
+        std::array<long long, FRAME_BUCKETS> histogram{};
+    };
+
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled);
+    void reset();
+
+    void addTime(ProfilePhase phase, double seconds);
+    void addCount(ProfileCounter counter, long long value = 1) {
+        if (!isEnabled()) return;
+        m_counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+    void recordFrame(double seconds);
+
+    PhaseStats phase(ProfilePhase phase) const;
+    long long counter(ProfileCounter counter) const {
+        return m_counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    FrameStats frames() const;
+
+    static const char* phaseName(ProfilePhase phase);
+    static const char* counterName(ProfileCounter counter);
+
+    // Краткий многострочный отчет для вывода поверх окна (только ASCII, подходит для sf::Text)
+    std::string overlayText() const;
+    void writeJson(std::ostream& out) const;
+    bool writeJson(const std::string& filename) const;
+
+private:
+    Profiler() = default;
+
+    static constexpr size_t PHASE_COUNT = static_cast<size_t>(ProfilePhase::Count);
+    static constexpr size_t COUNTER_COUNT = static_cast<size_t>(ProfileCounter::Count);
+
+    std::atomic<bool> m_enabled{ false };
+    mutable std::mutex m_mutex; // Защищает m_phases и m_frames
+    std::array<PhaseStats, PHASE_COUNT> m_phases{};
+    FrameStats m_frames;
+    std::array<std::atomic<long long>, COUNTER_COUNT> m_counters{};
+};
+
+// Замер времени области видимости. Если замеры выключены в момент создания, ничего не делает
+class ScopedTimer {
+public:
+    explicit ScopedTimer(ProfilePhase phase)
+        : m_phase(phase), m_active(Profiler::instance().isEnabled()) {
+        if (m_active) m_started = Profiler::Clock::now();
+    }
+    ~ScopedTimer() {
+        if (m_active) {
+            Profiler::instance().addTime(m_phase,
+                std::chrono::duration<double>(Profiler::Clock::now() - m_started).count());
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    ProfilePhase m_phase;
+    bool m_active;
+    Profiler::Clock::time_point m_started;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,274 @@
+﻿#include "SimulationCache.h"
+#include "TrajectoryIO.h"
+
+#include <charconv>    // Для std::to_chars (не зависит от setlocale)
+#include <cstring>     // Для std::memcmp
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <utility>     // Для std::move
+
+namespace {
+    constexpr char CACHE_FILE_MAGIC[8] = { 'T', 'R', 'J', 'C', 'A', 'C', 'H', 'E' };
+    constexpr uint32_t CACHE_FILE_VERSION = 4;
+    // Ключ - несколько десятков байт; больший размер в файле означает повреждение
+    constexpr uint64_t MAX_KEY_BYTES = 4096;
+
+    static_assert(std::is_trivially_copyable<SimulationSummary>::value, "SimulationSummary is written to cache files as is");
+
+    template<class T>
+    void appendValue(std::string& key, const T& value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void appendDouble(std::string& key, double value) {
+        if (value == 0.0) value = 0.0; // -0.0 -> 0.0
+        appendValue(key, value);
+    }
+
+    template<class T>
+    void writeValue(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template<class T>
+    bool readValue(std::istream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+}
+
+SimulationCache::SimulationCache(size_t memoryLimitBytes, const std::string& directory)
+    : m_memoryLimit(memoryLimitBytes) {
+    if (!directory.empty()) setDirectory(directory);
+}
+
+bool SimulationCache::setDirectory(const std::string& directory) {
+    m_directory.clear();
+    if (directory.empty()) return true;
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error || !std::filesystem::is_directory(directory, error)) {
+        std::cerr << "Ошибка: не удалось создать каталог кэша результатов '" << directory
+            << "', результаты хранятся только в памяти.\n";
+        return false;
+    }
+    m_directory = directory;
+    return true;
+}
+
+void SimulationCache::setMemoryLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memoryLimit = bytes;
+    evictOverLimit();
+}
+
+std::string SimulationCache::canonicalKey(const SimulationParameters& params, const std::string& variant) {
+    const IntegratorType integrator = Calculations::effectiveIntegrator(params);
+    const bool fixedStep = isFixedStepIntegrator(integrator);
+
+    std::string key;
+    key.reserve(192 + variant.size());
+    appendValue(key, KEY_VERSION);
+    appendDouble(key, params.G);
+    appendDouble(key, params.M);
+    appendDouble(key, params.CENTRAL_BODY_RADIUS);
+    appendDouble(key, params.DRAG_COEFFICIENT);
+    appendDouble(key, params.THRUST_COEFFICIENT);
+    appendDouble(key, params.J2_COEFFICIENT);
+    appendDouble(key, params.EXTERNAL_FIELD_X);
+    appendDouble(key, params.EXTERNAL_FIELD_Y);
+    appendDouble(key, params.DT);
+    appendValue(key, static_cast<int64_t>(params.STEPS));
+    appendValue(key, static_cast<uint32_t>(integrator));
+    // Методы с постоянным шагом не используют допуски и границы шага
+    appendDouble(key, fixedStep ? 0.0 : params.RELATIVE_TOLERANCE);
+    appendDouble(key, fixedStep ? 0.0 : params.ABSOLUTE_TOLERANCE);
+    appendDouble(key, fixedStep ? 0.0 : params.MIN_DT);
+    appendDouble(key, fixedStep ? 0.0 : params.MAX_DT);
+    appendDouble(key, params.initialState.x);
+    appendDouble(key, params.initialState.y);
+    appendDouble(key, params.initialState.vx);
+    appendDouble(key, params.initialState.vy);
+    appendValue(key, static_cast<uint32_t>(variant.size()));
+    key += variant;
+    return key;
+}
+
+uint64_t SimulationCache::hashKey(const std::string& key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char byte : key) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::shared_ptr<const CachedSimulation> SimulationCache::find(const SimulationParameters& params,
+    const std::string& variant) {
+    const std::string key = canonicalKey(params, variant);
+    const uint64_t hash = hashKey(key);
+    if (auto result = findInMemory(hash, key)) return result;
+
+    if (!m_directory.empty()) {
+        bool diskError = false;
+        std::shared_ptr<const CachedSimulation> result = readFile(filePath(hash), key, diskError);
+        if (result) {
+            insertInMemory(hash, key, result);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.diskHits;
+            return result;
+        }
+        if (diskError) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.diskErrors;
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.misses;
+    return nullptr;
+}
+
+std::shared_ptr<const CachedSimulation> SimulationCache::store(const SimulationParameters& params,
+    const std::string& variant, CachedSimulation result) {
+    const std::string key = canonicalKey(params, variant);
+    const uint64_t hash = hashKey(key);
+    result.trajectory.shrinkToFit();
+    auto shared = std::make_shared<const CachedSimulation>(std::move(result));
+    insertInMemory(hash, key, shared);
+
+    // Файл пишется вне блокировки: другие потоки тем временем находят результат в памяти
+    const bool written = m_directory.empty() || writeFile(filePath(hash), key, *shared);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.stores;
+    if (!written) ++m_stats.diskErrors;
+    return shared;
+}
+
+SimulationSummary SimulationCache::runSummary(const SimulationParameters& params, bool* fromCache) {
+    if (auto cached = find(params, SUMMARY_VARIANT)) {
+        if (fromCache) *fromCache = true;
+        return cached->summary;
+    }
+    if (fromCache) *fromCache = false;
+    Calculations calculator;
+    CachedSimulation result;
+    result.summary = calculator.runSummary(params);
+    const SimulationSummary summary = result.summary;
+    store(params, SUMMARY_VARIANT, std::move(result));
+    return summary;
+}
+
+void SimulationCache::clearMemory() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+    m_memoryBytes = 0;
+}
+
+SimulationCacheStats SimulationCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SimulationCacheStats stats = m_stats;
+    stats.entries = m_entries.size();
+    stats.memoryBytes = m_memoryBytes;
+    return stats;
+}
+
+void SimulationCache::resetStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats = SimulationCacheStats();
+}
+
+std::shared_ptr<const CachedSimulation> SimulationCache::findInMemory(uint64_t hash, const std::string& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(hash);
+    if (found == m_index.end() || found->second->key != key) return nullptr;
+    m_entries.splice(m_entries.begin(), m_entries, found->second); // Итераторы списка остаются верными
+    ++m_stats.memoryHits;
+    return found->second->result;
+}
+
+void SimulationCache::insertInMemory(uint64_t hash, const std::string& key,
+    std::shared_ptr<const CachedSimulation> result) {
+    const size_t bytes = result->memoryBytes() + sizeof(Entry) + key.size();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(hash);
+    if (found != m_index.end()) {
+        m_memoryBytes -= found->second->bytes;
+        m_entries.erase(found->second);
+        m_index.erase(found);
+    }
+    if (bytes > m_memoryLimit) return; // Не помещается даже в пустой кэш; файл (если есть) остается
+    m_entries.push_front({ hash, key, std::move(result), bytes });
+    m_index[hash] = m_entries.begin();
+    m_memoryBytes += bytes;
+    evictOverLimit();
+}
+
+void SimulationCache::evictOverLimit() {
+    while (m_memoryBytes > m_memoryLimit && !m_entries.empty()) {
+        const Entry& oldest = m_entries.back();
+        m_memoryBytes -= oldest.bytes;
+        m_index.erase(oldest.hash);
+        m_entries.pop_back();
+        ++m_stats.evictions;
+    }
+}
+
+std::string SimulationCache::filePath(uint64_t hash) const {
+    char name[17];
+    auto result = std::to_chars(name, name + 16, hash, 16);
+    const size_t digits = static_cast<size_t>(result.ptr - name);
+    std::string file(16 - digits, '0');
+    file.append(name, digits);
+    return (std::filesystem::path(m_directory) / (file + FILE_EXTENSION)).string();
+}
+
+std::shared_ptr<const CachedSimulation> SimulationCache::readFile(const std::string& path, const std::string& key,
+    bool& diskError) {
+    diskError = false;
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return nullptr;
+
+    char magic[sizeof(CACHE_FILE_MAGIC)] = {};
+    uint32_t version = 0;
+    uint64_t keyBytes = 0;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, CACHE_FILE_MAGIC, sizeof(magic)) != 0
+        || !readValue(file, version) || version != CACHE_FILE_VERSION
+        || !readValue(file, keyBytes) || keyBytes > MAX_KEY_BYTES) {
+        std::cerr << "Ошибка: файл кэша результатов '" << path << "' поврежден или другой версии.\n";
+        diskError = true;
+        return nullptr;
+    }
+    std::string storedKey(static_cast<size_t>(keyBytes), '\0');
+    if (!file.read(&storedKey[0], static_cast<std::streamsize>(storedKey.size()))) {
+        std::cerr << "Ошибка: файл кэша результатов '" << path << "' поврежден.\n";
+        diskError = true;
+        return nullptr;
+    }
+    if (storedKey != key) return nullptr; // Совпадение хэшей разных ключей (или другая версия ключа)
+
+    auto result = std::make_shared<CachedSimulation>();
+    uint8_t hasTrajectory = 0;
+    if (!readValue(file, result->summary) || !readValue(file, hasTrajectory)
+        || (hasTrajectory && !result->trajectory.read(file))) {
+        std::cerr << "Ошибка: файл кэша результатов '" << path << "' поврежден.\n";
+        diskError = true;
+        return nullptr;
+    }
+    return result;
+}
+
+bool SimulationCache::writeFile(const std::string& path, const std::string& key, const CachedSimulation& result) {
+    // Другие потоки и процессы, читающие тот же ключ, видят либо прежний файл, либо новый целиком
+    return writeFileAtomically(path, [&](std::ostream& file) {
+        file.write(CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC));
+        writeValue(file, CACHE_FILE_VERSION);
+        writeValue(file, static_cast<uint64_t>(key.size()));
+        file.write(key.data(), static_cast<std::streamsize>(key.size()));
+        writeValue(file, result.summary);
+        const uint8_t hasTrajectory = result.trajectory.empty() ? 0 : 1;
+        writeValue(file, hasTrajectory);
+        return !hasTrajectory || result.trajectory.write(file);
+    });
+}
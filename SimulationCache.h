@@ -0,0 +1,108 @@
+﻿#ifndef SIMULATIONCACHE_H
+#define SIMULATIONCACHE_H
+
+#include "Calculations.h"
+#include "CompressedTrajectory.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Сохраненный результат расчета: сводка и (необязательно) сжатые узлы траектории
+struct CachedSimulation {
+    SimulationSummary summary;
+    CompressedTrajectory trajectory; // Пусто, если сохранялась только сводка
+
+    size_t memoryBytes() const { return sizeof(CachedSimulation) + trajectory.memoryBytes(); }
+};
+
+// Статистика кэша с момента создания или resetStats
+struct SimulationCacheStats {
+    long long memoryHits = 0;
+    long long diskHits = 0;
+    long long misses = 0;
+    long long stores = 0;
+    long long evictions = 0;   // Вытеснено из памяти по ограничению объема
+    long long diskErrors = 0;  // Неудачные чтения и записи файлов кэша
+    size_t entries = 0;        // Записей в памяти сейчас
+    size_t memoryBytes = 0;
+
+    long long hits() const { return memoryHits + diskHits; }
+    long long lookups() const { return hits() + misses; }
+};
+
+// Кэш результатов расчета с адресацией по содержимому. Ключ - каноническая байтовая запись всех
+// параметров, влияющих на результат (начальное состояние, DT, STEPS, фактический интегратор и его
+// допуски), и варианта - строки, различающей виды сохраняемого результата (только сводка, узлы с
+// заданным прореживанием). Записи в памяти вытесняются по давности использования при превышении
+// ограничения объема. Если задан каталог, результаты также сохраняются в файлы <хэш>.simcache
+// (сжатые узлы как есть) и находятся после перезапуска программы.
+// Потокобезопасен; найденный результат неизменяем и разделяется между всеми, кто его запросил
+class SimulationCache {
+public:
+    static constexpr size_t DEFAULT_MEMORY_LIMIT_BYTES = size_t(256) << 20;
+    static constexpr const char* FILE_EXTENSION = ".simcache";
+    // Увеличивается при любом изменении численных методов, меняющем результаты: старые файлы
+    // кэша перестают совпадать по ключу
+    static constexpr uint32_t KEY_VERSION = 1;
+
+    explicit SimulationCache(size_t memoryLimitBytes = DEFAULT_MEMORY_LIMIT_BYTES, const std::string& directory = "");
+
+    // Каталог файлового уровня; пустая строка - только память. Каталог создается при необходимости
+    bool setDirectory(const std::string& directory);
+    const std::string& directory() const { return m_directory; }
+    void setMemoryLimit(size_t bytes);
+
+    // Каноническая запись параметров: -0.0 и 0.0 совпадают, допуски и границы шага
+    // не учитываются для методов с постоянным шагом, симплектический метод при сопротивлении
+    // или тяге записывается как RungeKutta4 (см. Calculations::effectiveIntegrator)
+    static std::string canonicalKey(const SimulationParameters& params, const std::string& variant);
+    static uint64_t hashKey(const std::string& key); // FNV-1a, 64 бита
+
+    // nullptr - результата нет ни в памяти, ни в каталоге
+    std::shared_ptr<const CachedSimulation> find(const SimulationParameters& params, const std::string& variant);
+    // Сохранить результат (заменяет прежний с тем же ключом) и вернуть разделяемую копию
+    std::shared_ptr<const CachedSimulation> store(const SimulationParameters& params, const std::string& variant,
+        CachedSimulation result);
+
+    // Сводка расчета через кэш (вариант SUMMARY_VARIANT)
+    static constexpr const char* SUMMARY_VARIANT = "summary";
+    SimulationSummary runSummary(const SimulationParameters& params, bool* fromCache = nullptr);
+
+    void clearMemory();
+    SimulationCacheStats stats() const;
+    void resetStats();
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::string key;
+        std::shared_ptr<const CachedSimulation> result;
+        size_t bytes;
+    };
+    using EntryList = std::list<Entry>; // Начало - последние использованные
+
+    std::shared_ptr<const CachedSimulation> findInMemory(uint64_t hash, const std::string& key);
+    void insertInMemory(uint64_t hash, const std::string& key, std::shared_ptr<const CachedSimulation> result);
+    void evictOverLimit(); // Вызывается под m_mutex
+
+    std::string filePath(uint64_t hash) const;
+    // nullptr - файла нет, он принадлежит другому ключу (совпадение хэшей) или поврежден (diskError = true)
+    static std::shared_ptr<const CachedSimulation> readFile(const std::string& path, const std::string& key,
+        bool& diskError);
+    static bool writeFile(const std::string& path, const std::string& key, const CachedSimulation& result);
+
+    mutable std::mutex m_mutex; // Защищает все поля ниже, кроме m_directory
+    EntryList m_entries;
+    std::unordered_map<uint64_t, EntryList::iterator> m_index;
+    size_t m_memoryLimit;
+    size_t m_memoryBytes = 0;
+    SimulationCacheStats m_stats;
+    std::string m_directory; // Меняется только при настройке, до использования кэша из нескольких потоков
+};
+
+#endif // SIMULATIONCACHE_H
@@ -0,0 +1,104 @@
+﻿#include "SimulationCheckpoint.h"
+#include "TrajectoryIO.h"
+
+#include <cstring>  // Для std::memcmp
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+namespace {
+    constexpr char CHECKPOINT_FILE_MAGIC[8] = { 'T', 'R', 'J', 'C', 'K', 'P', 'T', '\0' };
+    constexpr uint32_t CHECKPOINT_FILE_VERSION = 2;
+
+    static_assert(std::is_trivially_copyable<SimulationParameters>::value, "SimulationParameters is written to checkpoint files as is");
+    static_assert(std::is_trivially_copyable<SimulationSummary>::value, "SimulationSummary is written to checkpoint files as is");
+
+    template<class T>
+    void writeValue(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template<class T>
+    bool readValue(std::istream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+}
+
+bool saveCheckpoint(const std::string& filename, const SimulationCheckpoint& checkpoint) {
+    return writeFileAtomically(filename, [&](std::ostream& file) {
+        file.write(CHECKPOINT_FILE_MAGIC, sizeof(CHECKPOINT_FILE_MAGIC));
+        writeValue(file, CHECKPOINT_FILE_VERSION);
+        writeValue(file, checkpoint.params);
+        writeValue(file, checkpoint.progress);
+        writeValue(file, checkpoint.outputRecords);
+        return static_cast<bool>(file);
+    });
+}
+
+bool loadCheckpoint(const std::string& filename, SimulationCheckpoint& checkpoint) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    char magic[sizeof(CHECKPOINT_FILE_MAGIC)] = {};
+    uint32_t version = 0;
+    SimulationCheckpoint loaded;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, CHECKPOINT_FILE_MAGIC, sizeof(magic)) != 0
+        || !readValue(file, version) || version != CHECKPOINT_FILE_VERSION
+        || !readValue(file, loaded.params) || !readValue(file, loaded.progress)
+        || !readValue(file, loaded.outputRecords)) {
+        std::cerr << "Ошибка: файл контрольной точки '" << filename << "' поврежден или другой версии.\n";
+        return false;
+    }
+    checkpoint = loaded;
+    return true;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& filename, double intervalSeconds)
+    : m_filename(filename),
+    m_interval(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(intervalSeconds))),
+    m_nextDue(Clock::now() + m_interval),
+    m_thread(&CheckpointWriter::run, this) {
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    finish(false);
+}
+
+void CheckpointWriter::submit(const SimulationCheckpoint& checkpoint) {
+    m_nextDue = Clock::now() + m_interval;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = checkpoint;
+        m_hasPending = true;
+    }
+    m_wakeup.notify_one();
+}
+
+void CheckpointWriter::finish(bool removeFile) {
+    if (!m_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (removeFile) m_hasPending = false;
+        m_stopping = true;
+    }
+    m_wakeup.notify_one();
+    m_thread.join();
+    if (removeFile) {
+        std::error_code ignored;
+        std::filesystem::remove(m_filename, ignored);
+    }
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wakeup.wait(lock, [this] { return m_hasPending || m_stopping; });
+        if (!m_hasPending) return; // Остановка, все снимки записаны
+        const SimulationCheckpoint checkpoint = m_pending;
+        m_hasPending = false;
+        lock.unlock();
+        if (saveCheckpoint(m_filename, checkpoint)) m_written.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+    }
+}
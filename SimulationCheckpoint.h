@@ -0,0 +1,69 @@
+﻿#ifndef SIMULATIONCHECKPOINT_H
+#define SIMULATIONCHECKPOINT_H
+
+#include "Calculations.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Контрольная точка долгого расчета: параметры, сводка на момент сохранения (состояние, время, номер
+// шага, следующий шаг адаптивного метода - все, что нужно Calculations::continueSimulation) и число
+// записей, уже переданных в файл траектории
+struct SimulationCheckpoint {
+    SimulationParameters params;
+    SimulationSummary progress;
+    uint64_t outputRecords = 0;
+};
+
+// Сохранение через временный файл и переименование (writeFileAtomically): при аварийном завершении
+// на диске остается предыдущая контрольная точка целиком
+bool saveCheckpoint(const std::string& filename, const SimulationCheckpoint& checkpoint);
+// false - файла нет (без сообщения) или он поврежден (с сообщением в std::cerr)
+bool loadCheckpoint(const std::string& filename, SimulationCheckpoint& checkpoint);
+
+// Фоновая запись контрольных точек. Поток интегрирования только копирует снимок в submit, файл
+// пишется отдельным потоком; если предыдущая запись еще идет, ожидающий снимок заменяется новым,
+// так что интегрирование никогда не ждет диска. due() ограничивает частоту снимков по времени
+class CheckpointWriter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CheckpointWriter(const std::string& filename, double intervalSeconds);
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Прошло ли intervalSeconds с создания или последнего submit (вызывается из потока интегрирования)
+    bool due() const { return Clock::now() >= m_nextDue; }
+    void submit(const SimulationCheckpoint& checkpoint);
+
+    // Дождаться записи последнего снимка и остановить поток. removeFile - расчет завершен, контрольная
+    // точка больше не нужна: ожидающий снимок отбрасывается, файл удаляется
+    void finish(bool removeFile);
+
+    const std::string& filename() const { return m_filename; }
+    long long writtenCount() const { return m_written.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    std::string m_filename;
+    Clock::duration m_interval;
+    Clock::time_point m_nextDue;
+
+    std::mutex m_mutex; // Защищает m_pending, m_hasPending, m_stopping
+    std::condition_variable m_wakeup;
+    SimulationCheckpoint m_pending;
+    bool m_hasPending = false;
+    bool m_stopping = false;
+    std::atomic<long long> m_written{ 0 };
+    std::thread m_thread;
+};
+
+#endif // SIMULATIONCHECKPOINT_H
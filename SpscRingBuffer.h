@@ -0,0 +1,70 @@
+﻿#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <algorithm> // Для std::min
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// Кольцевой буфер без блокировок для одного потока-производителя и одного потока-потребителя.
+// push вызывается только производителем, pop - только потребителем; ни один из них не ждет другого:
+// если места (или данных) нет, передается столько элементов, сколько есть. Каждая сторона хранит
+// копию чужого индекса и перечитывает атомарный индекс, только когда копии не хватает, поэтому
+// передача пачки элементов стоит двух атомарных операций
+template <class T>
+class SpscRingBuffer {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRingBuffer copies elements as plain data");
+
+public:
+    // Емкость округляется вверх до степени двойки
+    explicit SpscRingBuffer(size_t capacity)
+        : m_mask(roundUpToPowerOfTwo(capacity) - 1),
+        m_items(m_mask + 1) {
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // Производитель: дописать до count элементов, вернуть число поместившихся
+    size_t push(const T* items, size_t count) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (capacity() - (head - m_cachedTail) < count) m_cachedTail = m_tail.load(std::memory_order_acquire);
+        const size_t pushed = std::min(count, capacity() - (head - m_cachedTail));
+        for (size_t i = 0; i < pushed; ++i) m_items[(head + i) & m_mask] = items[i];
+        m_head.store(head + pushed, std::memory_order_release);
+        return pushed;
+    }
+
+    // Потребитель: забрать до maxCount элементов в out, вернуть число забранных
+    size_t pop(T* out, size_t maxCount) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_cachedHead - tail < maxCount) m_cachedHead = m_head.load(std::memory_order_acquire);
+        const size_t popped = std::min(maxCount, m_cachedHead - tail);
+        for (size_t i = 0; i < popped; ++i) out[i] = m_items[(tail + i) & m_mask];
+        m_tail.store(tail + popped, std::memory_order_release);
+        return popped;
+    }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) result <<= 1;
+        return result;
+    }
+
+    const size_t m_mask;
+    std::vector<T> m_items;
+    // Индексы растут неограниченно (переполнение size_t безопасно: важны только разности)
+    // и лежат в разных строках кэша, чтобы стороны не мешали друг другу
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{ 0 }; // Пишет производитель
+    size_t m_cachedTail = 0;                                  // Копия m_tail у производителя
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{ 0 }; // Пишет потребитель
+    size_t m_cachedHead = 0;                                  // Копия m_head у потребителя
+};
+
+#endif // SPSCRINGBUFFER_H
@@ -0,0 +1,189 @@
+﻿#include "ThreadPool.h"
+
+#include <algorithm> // Для std::min, std::max
+#include <cassert>
+
+namespace {
+    // Пул и индекс очереди, которым принадлежит текущий рабочий поток
+    thread_local const ThreadPool* t_currentPool = nullptr;
+    thread_local unsigned int t_workerIndex = 0;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : m_queuedTasks(0),
+    m_pendingTasks(0),
+    m_nextQueue(0),
+    m_stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_queues.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    m_workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wakeCondition.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    unsigned int queueIndex;
+    if (t_currentPool == this) {
+        queueIndex = t_workerIndex; // Вложенные задачи кладем в свою очередь
+    }
+    else {
+        queueIndex = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % getThreadCount();
+    }
+
+    m_pendingTasks.fetch_add(1);
+    {
+        // Увеличиваем счетчик под мьютексом ожидания, чтобы спящий поток не пропустил уведомление.
+        // Счетчик растет до вставки в очередь, поэтому никогда не уходит в минус
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queuedTasks.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queueIndex]->mutex);
+        m_queues[queueIndex]->tasks.push_back(std::move(task));
+    }
+    m_wakeCondition.notify_one();
+}
+
+void ThreadPool::wait() {
+    // Вызвавшая задача сама входит в m_pendingTasks, поэтому ожидание из нее не закончилось бы
+    assert(t_currentPool != this && "ThreadPool::wait() from a pool task; use parallelFor");
+    {
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_doneCondition.wait(lock, [this] { return m_pendingTasks.load() == 0; });
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        std::swap(error, m_firstError);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body, size_t grain) {
+    if (count == 0) return;
+    if (grain == 0) {
+        // Несколько частей на поток, чтобы перехват работы мог выровнять нагрузку
+        grain = std::max<size_t>(1, count / (static_cast<size_t>(getThreadCount()) * 8));
+    }
+    // Защелка вызова: счетчик невыполненных частей. Он уменьшается под мьютексом вместе с уведомлением,
+    // поэтому после того как ожидающий увидел ноль, задачи к batch больше не обращаются
+    struct Batch {
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining = 0;
+        std::exception_ptr error;
+    } batch;
+    batch.remaining = (count + grain - 1) / grain;
+    for (size_t begin = 0; begin < count; begin += grain) {
+        size_t end = std::min(count, begin + grain);
+        submit([&body, &batch, begin, end] {
+            std::exception_ptr error;
+            try {
+                body(begin, end);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            if (error && !batch.error) batch.error = error;
+            if (--batch.remaining == 0) batch.done.notify_all();
+        });
+    }
+
+    if (t_currentPool == this) {
+        // Вложенный вызов: пока части стоят в очередях, выполняем задачи сами, чтобы не занять
+        // рабочий поток ожиданием. Когда очереди пусты, все части уже выполняются другими потоками
+        std::function<void()> task;
+        while (popTask(t_workerIndex, task)) {
+            runTask(task);
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            if (batch.remaining == 0) break;
+        }
+    }
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.done.wait(lock, [&batch] { return batch.remaining == 0; });
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+    t_currentPool = this;
+    t_workerIndex = index;
+
+    std::function<void()> task;
+    while (true) {
+        if (popTask(index, task)) {
+            runTask(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wakeCondition.wait(lock, [this] { return m_stopping || m_queuedTasks.load() > 0; });
+        if (m_stopping && m_queuedTasks.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::popTask(unsigned int index, std::function<void()>& task) {
+    // Сначала своя очередь (с конца - самые "горячие" задачи)
+    {
+        WorkerQueue& own = *m_queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+    // Затем перехват с начала чужих очередей
+    const unsigned int count = getThreadCount();
+    for (unsigned int offset = 1; offset < count; ++offset) {
+        WorkerQueue& victim = *m_queues[(index + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::runTask(std::function<void()>& task) {
+    try {
+        task();
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        if (!m_firstError) m_firstError = std::current_exception();
+    }
+    task = nullptr;
+
+    if (m_pendingTasks.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_doneCondition.notify_all();
+    }
+}
@@ -0,0 +1,70 @@
+﻿#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с перехватом работы (work stealing).
+// У каждого рабочего потока своя очередь: поток берет задачи с конца своей очереди,
+// а при ее опустошении забирает задачи с начала очередей других потоков.
+// Задачи, поставленные из рабочего потока, попадают в его собственную очередь.
+class ThreadPool {
+public:
+    // threadCount == 0 - по числу аппаратных потоков машины
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Поставить задачу в очередь
+    void submit(std::function<void()> task);
+
+    // Дождаться выполнения всех поставленных задач.
+    // Если какая-либо задача выбросила исключение, первое из них пробрасывается отсюда.
+    // Только вне пула: задача, вызвавшая wait, ждала бы сама себя. Внутри задач - parallelFor
+    void wait();
+
+    // Выполнить body(begin, end) для диапазонов [0, count), разбитых на части не меньше grain,
+    // и дождаться завершения. grain == 0 - автоматический выбор.
+    // Ожидаются только части этого вызова, поэтому parallelFor можно вызывать из задач пула: рабочий
+    // поток пока выполняет задачи из очередей. Исключение из body пробрасывается отсюда
+    void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body, size_t grain = 0);
+
+    // Очереди создаются до запуска потоков, поэтому их число можно читать из рабочих потоков сразу
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(m_queues.size()); }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(unsigned int index);
+    bool popTask(unsigned int index, std::function<void()>& task);
+    void runTask(std::function<void()>& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeCondition;  // Появились задачи или пул останавливается
+    std::condition_variable m_doneCondition;  // Все задачи выполнены
+    std::atomic<size_t> m_queuedTasks;        // Задачи, ожидающие в очередях
+    std::atomic<size_t> m_pendingTasks;       // Поставленные, но еще не завершенные задачи
+    std::atomic<unsigned int> m_nextQueue;    // Для распределения внешних задач по очередям
+    bool m_stopping;
+
+    std::mutex m_errorMutex;
+    std::exception_ptr m_firstError;
+};
+
+#endif // THREADPOOL_H
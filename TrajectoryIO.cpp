@@ -0,0 +1,547 @@
+﻿#include "TrajectoryIO.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>    // Для std::round
+#include <charconv> // Для std::to_chars, std::from_chars (не зависят от setlocale)
+#include <cstddef>  // Для offsetof
+#include <cstring>  // Для std::memcpy, std::memcmp
+#include <filesystem>
+#include <iostream>
+
+namespace {
+    // Размер буфера, после заполнения которого данные сбрасываются в файл
+    constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+    // Число в формате "%.10f"; слишком большие по модулю значения - в экспоненциальной записи
+    char* appendNumber(char* first, char* last, double value) {
+        auto result = std::to_chars(first, last, value, std::chars_format::fixed, 10);
+        if (result.ec != std::errc()) {
+            result = std::to_chars(first, last, value, std::chars_format::general, 17);
+        }
+        return result.ptr;
+    }
+
+    // Части текстового файла меньше этого размера не имеет смысла разбирать отдельными задачами
+    constexpr size_t MIN_PARSE_CHUNK_SIZE = 1 << 20;
+
+    // Часть текстового файла из целых строк и результаты ее разбора
+    struct TextChunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        size_t lineCount = 0;   // Число строк в части
+        size_t firstPoint = 0;  // Индекс первой точки части в общем буфере
+        size_t parsedCount = 0; // Сколько точек разобрано успешно
+        std::vector<std::string> malformedLines;
+    };
+
+    bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    // Число в начале [first, last) с пропуском пробелов, как у operator>>
+    const char* parseNumber(const char* first, const char* last, double& value) {
+        while (first != last && isBlank(*first)) ++first;
+        if (first != last && *first == '+') ++first;
+        auto result = std::from_chars(first, last, value);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+
+    // Строка [first, last) без '\n' -> точка; остаток строки после двух чисел игнорируется, как у istringstream
+    bool parseLine(const char* first, const char* last, WorldTrajectoryPoint& point) {
+        const char* next = parseNumber(first, last, point.first);
+        return next && parseNumber(next, last, point.second);
+    }
+
+    size_t countLines(const char* begin, const char* end) {
+        if (begin == end) return 0;
+        size_t lines = static_cast<size_t>(std::count(begin, end, '\n'));
+        return end[-1] == '\n' ? lines : lines + 1; // Последняя строка может быть без перевода строки
+    }
+
+    void parseChunk(TextChunk& chunk, WorldTrajectoryPoint* output) {
+        const char* line = chunk.begin;
+        while (line < chunk.end) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', chunk.end - line));
+            if (!lineEnd) lineEnd = chunk.end;
+            if (parseLine(line, lineEnd, output[chunk.parsedCount])) {
+                ++chunk.parsedCount;
+            }
+            else {
+                chunk.malformedLines.emplace_back(line, lineEnd);
+            }
+            line = lineEnd + 1;
+        }
+    }
+}
+
+bool parseTrajectoryTextFile(const std::string& filename, TextTrajectoryParseResult& result, unsigned int threadCount) {
+    result.points.clear();
+    result.malformedLines.clear();
+
+    MappedFile file;
+    if (!file.open(filename)) return false;
+    if (file.size() == 0) return true;
+    file.adviseSequential();
+
+    const char* data = file.data();
+    const size_t size = file.size();
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // Границы частей сдвигаются вперед до ближайшего перевода строки, чтобы строка не разрезалась
+    const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(size / MIN_PARSE_CHUNK_SIZE, threadCount * 4));
+    std::vector<TextChunk> chunks;
+    chunks.reserve(chunkCount);
+    const char* chunkBegin = data;
+    for (size_t i = 1; i <= chunkCount && chunkBegin < data + size; ++i) {
+        const char* chunkEnd = data + size;
+        if (i < chunkCount) {
+            const char* split = std::max(chunkBegin, data + size / chunkCount * i);
+            const char* newline = static_cast<const char*>(std::memchr(split, '\n', data + size - split));
+            if (newline) chunkEnd = newline + 1;
+        }
+        TextChunk chunk;
+        chunk.begin = chunkBegin;
+        chunk.end = chunkEnd;
+        chunks.push_back(std::move(chunk));
+        chunkBegin = chunkEnd;
+    }
+
+    // Один буфер на все точки: подсчет строк, затем разбор каждой части в свой участок буфера
+    auto countAndParse = [&](auto&& forEachChunk) {
+        forEachChunk([&](TextChunk& chunk) { chunk.lineCount = countLines(chunk.begin, chunk.end); });
+        size_t totalLines = 0;
+        for (auto& chunk : chunks) {
+            chunk.firstPoint = totalLines;
+            totalLines += chunk.lineCount;
+        }
+        result.points.resize(totalLines);
+        forEachChunk([&](TextChunk& chunk) { parseChunk(chunk, result.points.data() + chunk.firstPoint); });
+    };
+
+    if (chunks.size() == 1 || threadCount == 1) {
+        countAndParse([&](auto&& body) {
+            for (auto& chunk : chunks) body(chunk);
+        });
+    }
+    else {
+        ThreadPool pool(std::min<unsigned int>(threadCount, static_cast<unsigned int>(chunks.size())));
+        countAndParse([&](auto&& body) {
+            pool.parallelFor(chunks.size(), [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) body(chunks[i]);
+            }, 1);
+        });
+    }
+
+    // Сдвигаем точки частей вплотную друг к другу, если где-то встретились неверные строки
+    size_t written = 0;
+    for (auto& chunk : chunks) {
+        if (written != chunk.firstPoint) {
+            std::copy(result.points.begin() + chunk.firstPoint,
+                result.points.begin() + chunk.firstPoint + chunk.parsedCount,
+                result.points.begin() + written);
+        }
+        written += chunk.parsedCount;
+        for (auto& line : chunk.malformedLines) {
+            result.malformedLines.push_back(std::move(line));
+        }
+    }
+    result.points.resize(written);
+    return true;
+}
+
+bool writeFileAtomically(const std::string& filename, const std::function<bool(std::ostream&)>& writeContents) {
+    // Имя временного файла уникально и между потоками, и между процессами, пишущими тот же файл
+    static std::atomic<unsigned long long> tempCounter{ 0 };
+    const std::string tempPath = filename + ".tmp" + std::to_string(tempCounter.fetch_add(1))
+        + "_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Ошибка: не удалось открыть файл '" << tempPath << "' для записи.\n";
+            return false;
+        }
+        const bool written = writeContents(file);
+        file.close();
+        if (!written || !file) {
+            std::cerr << "Ошибка записи в файл '" << tempPath << "'.\n";
+            std::error_code ignored;
+            std::filesystem::remove(tempPath, ignored);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, filename, error);
+    if (error) {
+        std::cerr << "Ошибка: не удалось переименовать '" << tempPath << "' в '" << filename << "'.\n";
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+void saveTrajectoryToFile(const WorldTrajectoryData& trajectoryData, const std::string& filename) {
+    TrajectoryTextWriter writer(filename);
+    if (!writer.isOpen()) {
+        std::cerr << "Ошибка: не удалось открыть файл '" << filename << "' для записи.\n";
+        return;
+    }
+    for (const auto& point : trajectoryData) {
+        writer.write(point.first, point.second);
+    }
+    if (!writer.close()) {
+        std::cerr << "Ошибка записи в файл '" << filename << "'.\n";
+        return;
+    }
+    std::cout << "Результаты симуляции (" << trajectoryData.size() << " точек) записаны в " << filename << "\n";
+}
+
+TrajectoryTextWriter::TrajectoryTextWriter(const std::string& filename)
+    : m_file(filename),
+    m_pointsWritten(0) {
+    m_buffer.reserve(WRITE_BUFFER_SIZE + 128);
+}
+
+TrajectoryTextWriter::TrajectoryTextWriter(const std::string& filename, size_t keepPoints)
+    : m_pointsWritten(0) {
+    // Длина первых keepPoints строк; все, что после них (недописанный хвост), отбрасывается
+    uint64_t keepBytes = 0;
+    size_t lines = 0;
+    {
+        std::ifstream in(filename, std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Ошибка: не удалось открыть файл '" << filename << "' для продолжения записи.\n";
+            return;
+        }
+        std::vector<char> chunk(WRITE_BUFFER_SIZE);
+        uint64_t offset = 0; // Позиция начала chunk в файле
+        while (lines < keepPoints && in) {
+            in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            const size_t count = static_cast<size_t>(in.gcount());
+            for (size_t i = 0; i < count; ++i) {
+                if (chunk[i] == '\n' && ++lines == keepPoints) {
+                    keepBytes = offset + i + 1;
+                    break;
+                }
+            }
+            offset += count;
+        }
+    }
+    if (lines < keepPoints) {
+        std::cerr << "Ошибка: в файле '" << filename << "' " << lines << " точек, ожидалось не меньше "
+            << keepPoints << ".\n";
+        return;
+    }
+    std::error_code error;
+    std::filesystem::resize_file(filename, keepBytes, error);
+    if (error) {
+        std::cerr << "Ошибка: не удалось обрезать файл '" << filename << "'.\n";
+        return;
+    }
+    m_file.open(filename, std::ios::app);
+    m_pointsWritten = keepPoints;
+    m_buffer.reserve(WRITE_BUFFER_SIZE + 128);
+}
+
+TrajectoryTextWriter::~TrajectoryTextWriter() {
+    close();
+}
+
+void TrajectoryTextWriter::write(double x, double y) {
+    // std::to_chars вместо operator<< с std::fixed и std::setprecision(10): тот же формат, но без накладных
+    // расходов потоков и без зависимости от setlocale (в русской локали printf поставил бы запятую)
+    char line[128];
+    char* end = appendNumber(line, line + 60, x);
+    *end++ = ' ';
+    end = appendNumber(end, end + 60, y);
+    *end++ = '\n';
+    m_buffer.append(line, end);
+    ++m_pointsWritten;
+    if (m_buffer.size() >= WRITE_BUFFER_SIZE) {
+        flushBuffer();
+    }
+}
+
+bool TrajectoryTextWriter::flush() {
+    if (!m_file.is_open()) return false;
+    flushBuffer();
+    m_file.flush();
+    return !m_file.fail();
+}
+
+bool TrajectoryTextWriter::close() {
+    if (!m_file.is_open()) return !m_file.fail();
+    flushBuffer();
+    m_file.close();
+    return !m_file.fail();
+}
+
+void TrajectoryTextWriter::flushBuffer() {
+    m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+}
+
+// --- Бинарный формат ---
+
+namespace {
+    TrajectoryFileHeader makeHeader(const SimulationParameters& params, double recordDt, unsigned int columns,
+        TrajectoryPrecision precision) {
+        TrajectoryFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, TRAJECTORY_FILE_MAGIC, sizeof(header.magic));
+        header.version = TRAJECTORY_FILE_VERSION;
+        header.flags = (precision == TrajectoryPrecision::Float) ? TRAJECTORY_FLAG_FLOAT : 0u;
+        header.columns = columns;
+        header.headerSize = sizeof(TrajectoryFileHeader);
+        header.count = 0;
+        header.recordDt = recordDt;
+        header.G = params.G;
+        header.M = params.M;
+        header.centralBodyRadius = params.CENTRAL_BODY_RADIUS;
+        header.dragCoefficient = params.DRAG_COEFFICIENT;
+        header.thrustCoefficient = params.THRUST_COEFFICIENT;
+        header.initialX = params.initialState.x;
+        header.initialY = params.initialState.y;
+        header.initialVx = params.initialState.vx;
+        header.initialVy = params.initialState.vy;
+        header.steps = params.STEPS;
+        header.integrator = static_cast<int32_t>(params.INTEGRATOR);
+        header.integrationDt = params.DT;
+        header.j2Coefficient = params.J2_COEFFICIENT;
+        header.externalFieldX = params.EXTERNAL_FIELD_X;
+        header.externalFieldY = params.EXTERNAL_FIELD_Y;
+        header.relativeTolerance = params.RELATIVE_TOLERANCE;
+        header.absoluteTolerance = params.ABSOLUTE_TOLERANCE;
+        header.minDt = params.MIN_DT;
+        header.maxDt = params.MAX_DT;
+        return header;
+    }
+}
+
+TrajectoryBinaryWriter::TrajectoryBinaryWriter(const std::string& filename, const SimulationParameters& params,
+    double recordDt, unsigned int columns, TrajectoryPrecision precision)
+    : m_file(filename, std::ios::out | std::ios::trunc | std::ios::binary),
+    m_columns(columns == 2 ? 2u : 4u),
+    m_precision(precision),
+    m_pointsWritten(0) {
+    if (!m_file.is_open()) return;
+    TrajectoryFileHeader header = makeHeader(params, recordDt, m_columns, m_precision);
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_buffer.reserve(WRITE_BUFFER_SIZE + 4 * sizeof(double));
+}
+
+TrajectoryBinaryWriter::TrajectoryBinaryWriter(const std::string& filename, size_t keepRecords)
+    : m_columns(4),
+    m_precision(TrajectoryPrecision::Double),
+    m_pointsWritten(0) {
+    TrajectoryFileHeader header;
+    std::error_code error;
+    const uintmax_t fileSize = std::filesystem::file_size(filename, error);
+    {
+        std::ifstream in(filename, std::ios::binary);
+        if (error || !in.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || std::memcmp(header.magic, TRAJECTORY_FILE_MAGIC, sizeof(header.magic)) != 0
+            || header.version != TRAJECTORY_FILE_VERSION || (header.columns != 2 && header.columns != 4)
+            || header.headerSize != sizeof(TrajectoryFileHeader)) {
+            std::cerr << "Ошибка: файл '" << filename << "' не является бинарной траекторией этой версии.\n";
+            return;
+        }
+    }
+    m_columns = header.columns;
+    m_precision = (header.flags & TRAJECTORY_FLAG_FLOAT) ? TrajectoryPrecision::Float : TrajectoryPrecision::Double;
+    const uint64_t recordSize = m_columns * ((m_precision == TrajectoryPrecision::Float) ? sizeof(float) : sizeof(double));
+    const uint64_t keepBytes = header.headerSize + keepRecords * recordSize;
+    if (fileSize < keepBytes) {
+        std::cerr << "Ошибка: в файле '" << filename << "' " << (fileSize - header.headerSize) / recordSize
+            << " записей, ожидалось не меньше " << keepRecords << ".\n";
+        return;
+    }
+    std::filesystem::resize_file(filename, keepBytes, error);
+    if (error) {
+        std::cerr << "Ошибка: не удалось обрезать файл '" << filename << "'.\n";
+        return;
+    }
+    m_file.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file.is_open()) return;
+    m_file.seekp(0, std::ios::end);
+    m_pointsWritten = keepRecords;
+    m_buffer.reserve(WRITE_BUFFER_SIZE + 4 * sizeof(double));
+}
+
+TrajectoryBinaryWriter::~TrajectoryBinaryWriter() {
+    close();
+}
+
+void TrajectoryBinaryWriter::write(const State& s) {
+    const double values[4] = { s.x, s.y, s.vx, s.vy };
+    if (m_precision == TrajectoryPrecision::Float) {
+        float packed[4];
+        for (unsigned int c = 0; c < m_columns; ++c) packed[c] = static_cast<float>(values[c]);
+        const char* bytes = reinterpret_cast<const char*>(packed);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + m_columns * sizeof(float));
+    }
+    else {
+        const char* bytes = reinterpret_cast<const char*>(values);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + m_columns * sizeof(double));
+    }
+    ++m_pointsWritten;
+    if (m_buffer.size() >= WRITE_BUFFER_SIZE) {
+        flushBuffer();
+    }
+}
+
+bool TrajectoryBinaryWriter::flush() {
+    if (!m_file.is_open()) return false;
+    flushBuffer();
+    m_file.flush();
+    return !m_file.fail();
+}
+
+bool TrajectoryBinaryWriter::close() {
+    if (!m_file.is_open()) return !m_file.fail();
+    flushBuffer();
+    // Количество записей известно только в конце - дописываем его в заголовок
+    const uint64_t count = m_pointsWritten;
+    m_file.seekp(offsetof(TrajectoryFileHeader, count));
+    m_file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    m_file.close();
+    return !m_file.fail();
+}
+
+void TrajectoryBinaryWriter::flushBuffer() {
+    m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+}
+
+bool saveTrajectoryToBinaryFile(const std::vector<State>& states, const SimulationParameters& params,
+    const std::string& filename, TrajectoryPrecision precision) {
+    // При адаптивном шаге записи неравномерны по времени, шаг в заголовке не задается
+    const double dt = isFixedStepIntegrator(params.INTEGRATOR) ? params.DT : 0.0;
+    TrajectoryBinaryWriter writer(filename, params, dt, 4, precision);
+    if (!writer.isOpen()) {
+        std::cerr << "Ошибка: не удалось открыть файл '" << filename << "' для записи.\n";
+        return false;
+    }
+    for (const auto& state : states) {
+        writer.write(state);
+    }
+    if (!writer.close()) {
+        std::cerr << "Ошибка записи в файл '" << filename << "'.\n";
+        return false;
+    }
+    std::cout << "Результаты симуляции (" << states.size() << " точек) записаны в " << filename << "\n";
+    return true;
+}
+
+bool saveTrajectoryToBinaryFile(const CompressedTrajectory& trajectory, const SimulationParameters& params,
+    const std::string& filename, TrajectoryPrecision precision) {
+    // Записи могут быть прореженными: шаг между ними - целое число шагов DT
+    double dt = 0.0;
+    if (isFixedStepIntegrator(params.INTEGRATOR) && trajectory.size() > 1 && params.DT > 0.0) {
+        dt = params.DT * std::max(1.0, std::round((trajectory.time(1) - trajectory.time(0)) / params.DT));
+    }
+    TrajectoryBinaryWriter writer(filename, params, dt, 4, precision);
+    if (!writer.isOpen()) {
+        std::cerr << "Ошибка: не удалось открыть файл '" << filename << "' для записи.\n";
+        return false;
+    }
+    trajectory.forEach(0, trajectory.size(), [&writer](size_t, double, const State& state) {
+        writer.write(state);
+    });
+    if (!writer.close()) {
+        std::cerr << "Ошибка записи в файл '" << filename << "'.\n";
+        return false;
+    }
+    std::cout << "Результаты симуляции (" << trajectory.size() << " точек) записаны в " << filename << "\n";
+    return true;
+}
+
+bool MappedTrajectoryFile::isBinaryTrajectoryFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(TRAJECTORY_FILE_MAGIC)] = {};
+    if (!file.read(magic, sizeof(magic))) return false;
+    return std::memcmp(magic, TRAJECTORY_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+bool MappedTrajectoryFile::open(const std::string& filename, std::string& error) {
+    close();
+    error.clear();
+    if (!m_file.open(filename)) {
+        error = "не удалось открыть файл " + filename;
+        return false;
+    }
+    // Сигнатура и версия проверяются до размера: заголовок старой версии короче нынешнего
+    const size_t versionEnd = offsetof(TrajectoryFileHeader, version) + sizeof(uint32_t);
+    const TrajectoryFileHeader* header = reinterpret_cast<const TrajectoryFileHeader*>(m_file.data());
+    if (m_file.size() < versionEnd || std::memcmp(header->magic, TRAJECTORY_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        error = "файл " + filename + " не является бинарной траекторией";
+    }
+    else if (header->version != TRAJECTORY_FILE_VERSION) {
+        error = "неподдерживаемая версия формата " + std::to_string(header->version)
+            + " (поддерживается " + std::to_string(TRAJECTORY_FILE_VERSION) + ")";
+    }
+    else if (m_file.size() < sizeof(TrajectoryFileHeader)) {
+        error = "файл " + filename + " слишком мал для бинарной траектории";
+    }
+    else if ((header->columns != 2 && header->columns != 4) || header->headerSize < sizeof(TrajectoryFileHeader)
+        || header->headerSize % sizeof(double) != 0 || header->headerSize > m_file.size()) {
+        error = "поврежденный заголовок файла " + filename;
+    }
+    else {
+        const size_t valueSize = (header->flags & TRAJECTORY_FLAG_FLOAT) ? sizeof(float) : sizeof(double);
+        const uint64_t available = (m_file.size() - header->headerSize) / (valueSize * header->columns);
+        if (header->count > available) {
+            error = "файл " + filename + " обрезан: ожидалось " + std::to_string(header->count)
+                + " записей, есть " + std::to_string(available);
+        }
+    }
+    if (!error.empty()) {
+        close();
+        return false;
+    }
+
+    m_header = header;
+    m_values = m_file.data() + header->headerSize;
+    m_file.adviseSequential();
+    return true;
+}
+
+void MappedTrajectoryFile::close() {
+    m_header = nullptr;
+    m_values = nullptr;
+    m_file.close();
+}
+
+State MappedTrajectoryFile::state(size_t index) const {
+    const size_t offset = index * m_header->columns;
+    if (m_header->columns == 4) {
+        return { value(offset), value(offset + 1), value(offset + 2), value(offset + 3) };
+    }
+    return { value(offset), value(offset + 1), 0.0, 0.0 };
+}
+
+SimulationParameters MappedTrajectoryFile::parameters() const {
+    SimulationParameters params;
+    params.G = m_header->G;
+    params.M = m_header->M;
+    params.CENTRAL_BODY_RADIUS = m_header->centralBodyRadius;
+    params.DRAG_COEFFICIENT = m_header->dragCoefficient;
+    params.THRUST_COEFFICIENT = m_header->thrustCoefficient;
+    params.J2_COEFFICIENT = m_header->j2Coefficient;
+    params.EXTERNAL_FIELD_X = m_header->externalFieldX;
+    params.EXTERNAL_FIELD_Y = m_header->externalFieldY;
+    params.DT = m_header->integrationDt;
+    params.STEPS = static_cast<int>(m_header->steps);
+    params.INTEGRATOR = static_cast<IntegratorType>(m_header->integrator);
+    params.RELATIVE_TOLERANCE = m_header->relativeTolerance;
+    params.ABSOLUTE_TOLERANCE = m_header->absoluteTolerance;
+    params.MIN_DT = m_header->minDt;
+    params.MAX_DT = m_header->maxDt;
+    params.initialState.x = m_header->initialX;
+    params.initialState.y = m_header->initialY;
+    params.initialState.vx = m_header->initialVx;
+    params.initialState.vy = m_header->initialVy;
+    return params;
+}
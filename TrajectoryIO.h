@@ -0,0 +1,183 @@
+﻿#ifndef TRAJECTORYIO_H
+#define TRAJECTORYIO_H
+
+#include "Calculations.h"
+#include "CompressedTrajectory.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Тип для хранения точек траектории (x, y), общий для визуализатора и файлового ввода-вывода
+using WorldTrajectoryPoint = std::pair<double, double>;
+using WorldTrajectoryData = std::vector<WorldTrajectoryPoint>;
+
+// Запись файла целиком через временный файл рядом с ним и переименование: читатели видят либо прежний
+// файл, либо новый полностью, даже если процесс завершится посреди записи. writeContents возвращает
+// false, если содержимое записать не удалось (временный файл тогда удаляется)
+bool writeFileAtomically(const std::string& filename, const std::function<bool(std::ostream&)>& writeContents);
+
+// Запись траектории в текстовый файл: по строке "x y" на точку, 10 знаков после запятой
+void saveTrajectoryToFile(const WorldTrajectoryData& trajectoryData, const std::string& filename);
+
+// Результат разбора текстового файла траектории
+struct TextTrajectoryParseResult {
+    WorldTrajectoryData points;
+    std::vector<std::string> malformedLines; // Строки неверного формата в порядке следования в файле
+};
+
+// Разбор текстового файла траектории ("x y" в каждой строке). Файл отображается в память,
+// делится на части по границам строк, части разбираются параллельно через std::from_chars
+// и складываются в заранее выделенный буфер. threadCount == 0 - по числу аппаратных потоков.
+// Возвращает false, если файл не удалось открыть
+bool parseTrajectoryTextFile(const std::string& filename, TextTrajectoryParseResult& result, unsigned int threadCount = 0);
+
+// Потоковая запись траектории в том же текстовом формате, что и saveTrajectoryToFile.
+// Подходит как приемник для Calculations::streamSimulation, поэтому траектория не хранится в памяти целиком
+class TrajectoryTextWriter {
+public:
+    explicit TrajectoryTextWriter(const std::string& filename);
+    // Продолжение записи в существующий файл: первые keepPoints точек остаются, остальное отбрасывается
+    // (после перезапуска с контрольной точки). Если в файле меньше точек, файл не открывается
+    TrajectoryTextWriter(const std::string& filename, size_t keepPoints);
+    ~TrajectoryTextWriter();
+
+    TrajectoryTextWriter(const TrajectoryTextWriter&) = delete;
+    TrajectoryTextWriter& operator=(const TrajectoryTextWriter&) = delete;
+
+    bool isOpen() const { return m_file.is_open(); }
+    void write(double x, double y);
+    void write(const State& s) { write(s.x, s.y); }
+    size_t getPointsWritten() const { return m_pointsWritten; }
+    // flush и close возвращают false, если запись в файл не удалась (ошибка сохраняется до закрытия)
+    bool flush(); // Передать накопленные точки в файл (перед сохранением контрольной точки)
+    bool close();
+
+private:
+    void flushBuffer();
+
+    std::ofstream m_file;
+    std::string m_buffer;
+    size_t m_pointsWritten;
+};
+
+// --- Бинарный формат траектории ---
+// Файл: заголовок TrajectoryFileHeader (192 байта), затем count записей по columns значений подряд
+// (x, y или x, y, vx, vy) в double или float. Порядок байтов - little-endian (x86, ARM).
+// Данные выровнены и могут читаться прямо из отображенного в память файла, без разбора и копирования
+struct TrajectoryFileHeader {
+    char magic[8];              // TRAJECTORY_FILE_MAGIC
+    uint32_t version;           // TRAJECTORY_FILE_VERSION
+    uint32_t flags;             // TRAJECTORY_FLAG_*
+    uint32_t columns;           // 2 (x, y) или 4 (x, y, vx, vy)
+    uint32_t headerSize;        // Смещение данных от начала файла
+    uint64_t count;             // Количество записей
+    double recordDt;            // Шаг по времени между записями с учетом прореживания (0 - неравномерный)
+    double G, M, centralBodyRadius, dragCoefficient, thrustCoefficient; // Параметры симуляции
+    double initialX, initialY, initialVx, initialVy;
+    int64_t steps;
+    int32_t integrator;         // Значение IntegratorType
+    uint32_t reserved;
+    // С версии 2: все параметры, влияющие на результат
+    double integrationDt;       // DT расчета (для адаптивного метода - начальный шаг)
+    double j2Coefficient, externalFieldX, externalFieldY;
+    double relativeTolerance, absoluteTolerance, minDt, maxDt;
+};
+static_assert(sizeof(TrajectoryFileHeader) == 192, "TrajectoryFileHeader must stay 192 bytes");
+
+constexpr char TRAJECTORY_FILE_MAGIC[8] = { 'T', 'R', 'J', 'B', 'I', 'N', '\0', '\0' };
+// Версия 1 (128 байт) не хранила J2, внешнее поле, допуски и DT расчета и не читается
+constexpr uint32_t TRAJECTORY_FILE_VERSION = 2;
+constexpr uint32_t TRAJECTORY_FLAG_FLOAT = 1u << 0; // Значения хранятся во float, иначе в double
+
+enum class TrajectoryPrecision {
+    Double,
+    Float   // Вдвое меньше места, точности достаточно для отрисовки
+};
+
+// Потоковая запись в бинарном формате. Количество записей дописывается в заголовок при close()
+class TrajectoryBinaryWriter {
+public:
+    // columns: 2 - только координаты, 4 - полное состояние. recordDt - шаг между записями (с учетом прореживания,
+    // 0 - неравномерный); DT расчета берется из params
+    TrajectoryBinaryWriter(const std::string& filename, const SimulationParameters& params, double recordDt,
+        unsigned int columns = 4, TrajectoryPrecision precision = TrajectoryPrecision::Double);
+    // Продолжение записи в существующий файл этого формата: заголовок и первые keepRecords записей
+    // остаются, остальное отбрасывается. Если записей меньше или заголовок неверен, файл не открывается
+    TrajectoryBinaryWriter(const std::string& filename, size_t keepRecords);
+    ~TrajectoryBinaryWriter();
+
+    TrajectoryBinaryWriter(const TrajectoryBinaryWriter&) = delete;
+    TrajectoryBinaryWriter& operator=(const TrajectoryBinaryWriter&) = delete;
+
+    bool isOpen() const { return m_file.is_open(); }
+    void write(const State& s);
+    void write(double x, double y) { write(State{ x, y, 0.0, 0.0 }); }
+    size_t getPointsWritten() const { return m_pointsWritten; }
+    // flush и close возвращают false, если запись в файл не удалась (ошибка сохраняется до закрытия)
+    bool flush(); // Передать накопленные записи в файл (число записей в заголовке обновляется в close)
+    bool close();
+
+private:
+    void flushBuffer();
+
+    std::fstream m_file;
+    std::vector<char> m_buffer;
+    unsigned int m_columns;
+    TrajectoryPrecision m_precision;
+    size_t m_pointsWritten;
+};
+
+// Запись готовой траектории в бинарном формате
+bool saveTrajectoryToBinaryFile(const std::vector<State>& states, const SimulationParameters& params,
+    const std::string& filename, TrajectoryPrecision precision = TrajectoryPrecision::Double);
+
+// Запись сжатой траектории: блоки распаковываются по очереди, целиком траектория в памяти не восстанавливается
+bool saveTrajectoryToBinaryFile(const CompressedTrajectory& trajectory, const SimulationParameters& params,
+    const std::string& filename, TrajectoryPrecision precision = TrajectoryPrecision::Double);
+
+// Бинарная траектория, отображенная в память. Значения читаются прямо из страниц файла
+class MappedTrajectoryFile {
+public:
+    bool open(const std::string& filename, std::string& error);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    // Проверка сигнатуры бинарного формата в начале файла
+    static bool isBinaryTrajectoryFile(const std::string& filename);
+
+    const TrajectoryFileHeader& header() const { return *m_header; }
+    size_t size() const { return static_cast<size_t>(m_header->count); }
+    unsigned int columns() const { return m_header->columns; }
+    bool isFloat() const { return (m_header->flags & TRAJECTORY_FLAG_FLOAT) != 0; }
+
+    // Прямой доступ к записям: ровно один из указателей ненулевой в зависимости от isFloat()
+    const double* doubleData() const { return isFloat() ? nullptr : reinterpret_cast<const double*>(m_values); }
+    const float* floatData() const { return isFloat() ? reinterpret_cast<const float*>(m_values) : nullptr; }
+
+    double x(size_t index) const { return value(index * m_header->columns); }
+    double y(size_t index) const { return value(index * m_header->columns + 1); }
+    State state(size_t index) const;
+
+    // Параметры симуляции из заголовка (DT - шаг расчета, а не шаг между записями)
+    SimulationParameters parameters() const;
+    // Шаг по времени между записями (0 - записи неравномерны по времени)
+    double recordDt() const { return m_header->recordDt; }
+
+private:
+    double value(size_t offset) const {
+        return isFloat() ? static_cast<double>(reinterpret_cast<const float*>(m_values)[offset])
+            : reinterpret_cast<const double*>(m_values)[offset];
+    }
+
+    MappedFile m_file;
+    const TrajectoryFileHeader* m_header = nullptr;
+    const char* m_values = nullptr;
+};
+
+#endif // TRAJECTORYIO_H
@@ -0,0 +1,53 @@
+﻿#include "TrajectoryLod.h"
+
+void TrajectoryLod::clear() {
+    m_sourceSize = 0;
+    m_bounds = Bounds();
+    m_levels.clear();
+}
+
+void TrajectoryLod::buildCoarserLevels(double step, double diagonal) {
+    // Каждый следующий уровень строится из последнего сохраненного с удвоенным допуском группировки.
+    // Отклонения уровней складываются, поэтому tolerance уровня - сумма отклонений всех предыдущих
+    while (m_levels.back().points.size() > MIN_LEVEL_POINTS && step < diagonal) {
+        step *= 2.0;
+        const Level& source = m_levels.back();
+        Level next;
+        next.step = step;
+        next.tolerance = source.tolerance + decimate(source.points.size(),
+            [&source](size_t i) { return source.points[i]; },
+            [&source](size_t i) { return source.sourceIndices[i]; },
+            step, next);
+        if (static_cast<double>(next.points.size()) > MIN_LEVEL_REDUCTION * static_cast<double>(source.points.size())) {
+            continue; // Слишком мало выигрыша: пробуем больший допуск от того же уровня
+        }
+        m_levels.push_back(std::move(next));
+    }
+}
+
+double TrajectoryLod::distanceToSegment(const WorldTrajectoryPoint& p, const WorldTrajectoryPoint& a,
+    const WorldTrajectoryPoint& b) {
+    const double dx = b.first - a.first, dy = b.second - a.second;
+    const double lengthSquared = dx * dx + dy * dy;
+    double t = 0.0;
+    if (lengthSquared > 0.0) {
+        t = std::clamp(((p.first - a.first) * dx + (p.second - a.second) * dy) / lengthSquared, 0.0, 1.0);
+    }
+    const double ex = p.first - a.first - t * dx, ey = p.second - a.second - t * dy;
+    return std::sqrt(ex * ex + ey * ey);
+}
+
+int TrajectoryLod::selectLevel(double pixelsPerUnit, double pixelTolerance) const {
+    int selected = -1;
+    for (size_t i = 0; i < m_levels.size(); ++i) {
+        if (m_levels[i].tolerance * pixelsPerUnit > pixelTolerance) break;
+        selected = static_cast<int>(i);
+    }
+    return selected;
+}
+
+size_t TrajectoryLod::pointsBefore(int levelIndex, size_t sourceIndex) const {
+    if (levelIndex < 0) return std::min(sourceIndex, m_sourceSize);
+    const std::vector<size_t>& indices = m_levels[static_cast<size_t>(levelIndex)].sourceIndices;
+    return static_cast<size_t>(std::lower_bound(indices.begin(), indices.end(), sourceIndex) - indices.begin());
+}
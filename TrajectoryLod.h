@@ -0,0 +1,217 @@
+﻿#ifndef TRAJECTORYLOD_H
+#define TRAJECTORYLOD_H
+
+#include "TrajectoryIO.h" // WorldTrajectoryPoint
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Пирамида уровней детализации траектории для отрисовки.
+// Уровень k строится из предыдущего: подряд идущие точки собираются в группы, пока их
+// ограничивающий прямоугольник не превысит допуск уровня, и от группы остаются первая, последняя
+// и крайние по x и y точки. Для каждого уровня запоминается фактическое отклонение от исходной
+// ломаной, и при tolerance * масштаб < половины пикселя уровень неотличим от полной траектории,
+// а число вершин зависит от длины линии на экране, а не от числа шагов.
+class TrajectoryLod {
+public:
+    struct Level {
+        double tolerance = 0.0;           // Наибольшее отклонение от исходной ломаной, мировые единицы
+        double step = 0.0;                // Допуск группировки, с которым построен уровень
+        std::vector<size_t> sourceIndices; // Номера точек уровня в исходной траектории (по возрастанию)
+        std::vector<WorldTrajectoryPoint> points;
+    };
+
+    struct Bounds {
+        double minX = 0.0, maxX = 0.0, minY = 0.0, maxY = 0.0;
+    };
+
+    // Уровни с числом точек меньше этого не строятся - их отрисовка и так ничего не стоит
+    static constexpr size_t MIN_LEVEL_POINTS = 64;
+    // Уровень, уменьшивший число точек меньше чем во столько раз, не сохраняется отдельно
+    static constexpr double MIN_LEVEL_REDUCTION = 0.75;
+    // Допуск по умолчанию при выборе уровня, в пикселях
+    static constexpr double DEFAULT_PIXEL_TOLERANCE = 0.5;
+
+    // Построить пирамиду по count точкам; pointAt(i) возвращает i-ю точку (WorldTrajectoryPoint)
+    template <typename PointAt>
+    void build(size_t count, PointAt pointAt);
+
+    // Дополнить пирамиду точками [sourceSize(), count) продолжившейся траектории (первые sourceSize()
+    // точек не изменились). Новые группы каждого уровня начинаются с его последней точки, поэтому
+    // прежние точки уровней не меняются, а стоимость пропорциональна числу новых точек
+    template <typename PointAt>
+    void append(size_t count, PointAt pointAt);
+
+    void clear();
+    bool empty() const { return m_sourceSize == 0; }
+    size_t sourceSize() const { return m_sourceSize; }
+    const Bounds& bounds() const { return m_bounds; }
+
+    size_t levelCount() const { return m_levels.size(); }
+    const Level& level(size_t index) const { return m_levels[index]; }
+
+    // Самый грубый уровень, отклонение которого при масштабе pixelsPerUnit (пикселей на единицу длины)
+    // не превышает pixelTolerance пикселей. -1 - подходит только исходная траектория
+    int selectLevel(double pixelsPerUnit, double pixelTolerance = DEFAULT_PIXEL_TOLERANCE) const;
+
+    // Сколько точек уровня имеют исходный номер меньше sourceIndex (для частичной отрисовки при анимации)
+    size_t pointsBefore(int levelIndex, size_t sourceIndex) const;
+
+private:
+    // Прореживание группами с ограничивающим прямоугольником не больше tolerance.
+    // Возвращает фактическое наибольшее расстояние от отброшенных точек до оставшейся ломаной
+    template <typename PointAt, typename IndexAt>
+    static double decimate(size_t count, PointAt pointAt, IndexAt indexAt, double tolerance, Level& out);
+
+    static double distanceToSegment(const WorldTrajectoryPoint& p, const WorldTrajectoryPoint& a, const WorldTrajectoryPoint& b);
+
+    // step - допуск группировки, с которым построен последний уровень
+    void buildCoarserLevels(double step, double diagonal);
+
+    size_t m_sourceSize = 0;
+    Bounds m_bounds;
+    std::vector<Level> m_levels; // От самого подробного к самому грубому
+};
+
+template <typename PointAt>
+void TrajectoryLod::build(size_t count, PointAt pointAt) {
+    clear();
+    if (count == 0) return;
+    m_sourceSize = count;
+
+    // Первый проход: границы и средняя длина отрезка, от которой отсчитывается допуск первого уровня
+    WorldTrajectoryPoint previous = pointAt(0);
+    m_bounds = { previous.first, previous.first, previous.second, previous.second };
+    double pathLength = 0.0;
+    for (size_t i = 1; i < count; ++i) {
+        WorldTrajectoryPoint p = pointAt(i);
+        m_bounds.minX = std::min(m_bounds.minX, p.first);
+        m_bounds.maxX = std::max(m_bounds.maxX, p.first);
+        m_bounds.minY = std::min(m_bounds.minY, p.second);
+        m_bounds.maxY = std::max(m_bounds.maxY, p.second);
+        const double dx = p.first - previous.first, dy = p.second - previous.second;
+        pathLength += std::sqrt(dx * dx + dy * dy);
+        previous = p;
+    }
+    const double diagonal = std::hypot(m_bounds.maxX - m_bounds.minX, m_bounds.maxY - m_bounds.minY);
+    if (count < MIN_LEVEL_POINTS || !(diagonal > 0.0)) return;
+
+    // Допуск первого уровня подбирается начиная с нескольких средних отрезков (в группе из 2-3 точек
+    // отбрасывать нечего), пока уровень не станет заметно меньше исходной траектории
+    double tolerance = std::max(pathLength / static_cast<double>(count - 1) * 4.0, diagonal * 1e-7);
+    for (; tolerance < diagonal; tolerance *= 2.0) {
+        Level base;
+        base.tolerance = decimate(count, pointAt, [](size_t i) { return i; }, tolerance, base);
+        base.step = tolerance;
+        if (static_cast<double>(base.points.size()) <= MIN_LEVEL_REDUCTION * static_cast<double>(count)) {
+            m_levels.push_back(std::move(base));
+            buildCoarserLevels(tolerance, diagonal);
+            return;
+        }
+    }
+}
+
+template <typename PointAt>
+void TrajectoryLod::append(size_t count, PointAt pointAt) {
+    if (count <= m_sourceSize) return;
+    if (m_levels.empty()) {
+        // Уровней не было (траектория была короткой или вырожденной) - строим заново
+        build(count, pointAt);
+        return;
+    }
+
+    for (size_t i = m_sourceSize; i < count; ++i) {
+        WorldTrajectoryPoint p = pointAt(i);
+        m_bounds.minX = std::min(m_bounds.minX, p.first);
+        m_bounds.maxX = std::max(m_bounds.maxX, p.first);
+        m_bounds.minY = std::min(m_bounds.minY, p.second);
+        m_bounds.maxY = std::max(m_bounds.maxY, p.second);
+    }
+
+    // Последняя точка каждого уровня совпадает с последней точкой источника, из которого он построен,
+    // поэтому дополнение уровня k - прореживание новых точек уровня k - 1 начиная с этой общей точки
+    size_t sourceFrom = m_sourceSize - 1;
+    double sourceTolerance = 0.0;
+    double sourceGrowth = 0.0; // Насколько выросло отклонение источника
+    for (size_t k = 0; k < m_levels.size(); ++k) {
+        Level& level = m_levels[k];
+        Level added;
+        double deviation;
+        if (k == 0) {
+            deviation = decimate(count - sourceFrom,
+                [&pointAt, sourceFrom](size_t i) { return pointAt(sourceFrom + i); },
+                [sourceFrom](size_t i) { return sourceFrom + i; }, level.step, added);
+        }
+        else {
+            const Level& source = m_levels[k - 1];
+            deviation = sourceTolerance + decimate(source.points.size() - sourceFrom,
+                [&source, sourceFrom](size_t i) { return source.points[sourceFrom + i]; },
+                [&source, sourceFrom](size_t i) { return source.sourceIndices[sourceFrom + i]; }, level.step, added);
+        }
+        const size_t previousSize = level.points.size();
+        level.points.insert(level.points.end(), added.points.begin() + 1, added.points.end());
+        level.sourceIndices.insert(level.sourceIndices.end(), added.sourceIndices.begin() + 1, added.sourceIndices.end());
+        const double previousTolerance = level.tolerance;
+        level.tolerance = std::max(level.tolerance + sourceGrowth, deviation);
+        sourceGrowth = level.tolerance - previousTolerance;
+        sourceTolerance = level.tolerance;
+        sourceFrom = previousSize - 1;
+    }
+    m_sourceSize = count;
+
+    // Траектория могла вырасти настолько, что появились основания для более грубых уровней
+    buildCoarserLevels(m_levels.back().step, std::hypot(m_bounds.maxX - m_bounds.minX, m_bounds.maxY - m_bounds.minY));
+}
+
+template <typename PointAt, typename IndexAt>
+double TrajectoryLod::decimate(size_t count, PointAt pointAt, IndexAt indexAt, double tolerance, Level& out) {
+    const double toleranceSquared = tolerance * tolerance;
+    double maxDeviation = 0.0;
+    size_t lastEmitted = static_cast<size_t>(-1);
+    auto emit = [&](size_t i) {
+        if (i == lastEmitted) return;
+        out.sourceIndices.push_back(indexAt(i));
+        out.points.push_back(pointAt(i));
+        lastEmitted = i;
+    };
+
+    size_t begin = 0;
+    while (begin < count) {
+        WorldTrajectoryPoint first = pointAt(begin);
+        double minX = first.first, maxX = first.first, minY = first.second, maxY = first.second;
+        size_t iMinX = begin, iMaxX = begin, iMinY = begin, iMaxY = begin;
+        size_t end = begin + 1;
+        for (; end < count; ++end) {
+            WorldTrajectoryPoint p = pointAt(end);
+            double nMinX = std::min(minX, p.first), nMaxX = std::max(maxX, p.first);
+            double nMinY = std::min(minY, p.second), nMaxY = std::max(maxY, p.second);
+            double w = nMaxX - nMinX, h = nMaxY - nMinY;
+            if (w * w + h * h > toleranceSquared) break;
+            if (p.first < minX) iMinX = end;
+            if (p.first > maxX) iMaxX = end;
+            if (p.second < minY) iMinY = end;
+            if (p.second > maxY) iMaxY = end;
+            minX = nMinX; maxX = nMaxX; minY = nMinY; maxY = nMaxY;
+        }
+
+        // Первая, крайние (в порядке следования) и последняя точки группы [begin, end)
+        size_t keep[6] = { begin, iMinX, iMaxX, iMinY, iMaxY, end - 1 };
+        std::sort(keep, keep + 6);
+        for (size_t i : keep) emit(i);
+
+        // Отброшенные точки группы лежат между соседними оставленными
+        for (size_t k = 0; k + 1 < 6; ++k) {
+            if (keep[k + 1] <= keep[k] + 1) continue;
+            WorldTrajectoryPoint a = pointAt(keep[k]), b = pointAt(keep[k + 1]);
+            for (size_t i = keep[k] + 1; i < keep[k + 1]; ++i) {
+                maxDeviation = std::max(maxDeviation, distanceToSegment(pointAt(i), a, b));
+            }
+        }
+        begin = end;
+    }
+    return maxDeviation;
+}
+
+#endif // TRAJECTORYLOD_H
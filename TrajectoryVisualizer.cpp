@@ -1,17 +1,22 @@
 #include "TrajectoryVisualizer.h"
 
-// ---    (    static  .h) ---
-// constexpr float TrajectoryVisualizer::DEFAULT_SCALE; //  ..   static constexpr
-//     static constexpr     .h (C++17+)
-//   ,  :
+// --- Инициализация статических констант (если они объявлены как static в .h) ---
+// constexpr float TrajectoryVisualizer::DEFAULT_SCALE; // И т.д. для всех static constexpr
+// Но для литеральных типов static constexpr можно инициализировать прямо в .h (C++17+)
+// Если компилятор старый, то так:
 // const float TrajectoryVisualizer::DEFAULT_SCALE = 150.0f;
 // const unsigned int TrajectoryVisualizer::DEFAULT_POINTS_PER_FRAME = 1u; 
-// ...      ...
+// ... и так далее для других ...
 
 TrajectoryVisualizer::TrajectoryVisualizer(unsigned int width, unsigned int height, const std::string& windowTitle)
-    : m_window(sf::VideoMode(width, height), windowTitle, sf::Style::Default), //  L""    ,  
+    : m_window(sf::VideoMode(width, height), windowTitle, sf::Style::Default), // Используем L"" для кириллицы в заголовке, если нужно
+    m_lodLevel(-1),
+    m_geometryOrigin(0.0, 0.0),
+    m_geometryValid(false),
+    m_useVertexBuffer(sf::VertexBuffer::isAvailable()),
+    m_trajectoryBuffer(sf::LineStrip, sf::VertexBuffer::Static),
     m_scale(DEFAULT_SCALE),
-    m_offset(0.f, 0.f),
+    m_offset(0.0, 0.0),
     m_screenCenter(static_cast<float>(width) / 2.f, static_cast<float>(height) / 2.f),
     m_currentPointIndex(0),
     m_pointsPerFrame(DEFAULT_POINTS_PER_FRAME),
@@ -24,41 +29,88 @@ TrajectoryVisualizer::TrajectoryVisualizer(unsigned int width, unsigned int heig
 
 sf::Vector2f TrajectoryVisualizer::toScreenCoords(double worldX, double worldY) const {
     return {
-        m_screenCenter.x + m_offset.x + static_cast<float>(worldX) * m_scale,
-        m_screenCenter.y + m_offset.y - static_cast<float>(worldY) * m_scale
+        static_cast<float>(m_screenCenter.x + m_offset.x + worldX * m_scale),
+        static_cast<float>(m_screenCenter.y + m_offset.y - worldY * m_scale)
     };
 }
 
-sf::Vector2f TrajectoryVisualizer::toWorldCoords(sf::Vector2f screenPos) const {
+TrajectoryVisualizer::Vector2d TrajectoryVisualizer::toWorldCoords(sf::Vector2f screenPos) const {
     return {
         (screenPos.x - m_screenCenter.x - m_offset.x) / m_scale,
        -(screenPos.y - m_screenCenter.y - m_offset.y) / m_scale
     };
 }
 
-void TrajectoryVisualizer::recalculateScreenTrajectory() {
-    m_screenTrajectory.clear();
-    if (m_worldTrajectoryData.empty()) return;
+sf::Transform TrajectoryVisualizer::trajectoryTransform() const {
+    // Вершины хранятся относительно m_geometryOrigin; сдвиг начала считается в double,
+    // поэтому во float попадают только небольшие величины
+    sf::Transform transform;
+    transform.translate(
+        static_cast<float>(m_screenCenter.x + m_offset.x + m_geometryOrigin.x * m_scale),
+        static_cast<float>(m_screenCenter.y + m_offset.y - m_geometryOrigin.y * m_scale));
+    transform.scale(m_scale, -m_scale);
+    return transform;
+}
 
-    m_screenTrajectory.reserve(m_worldTrajectoryData.size());
-    for (const auto& world_point : m_worldTrajectoryData) {
-        m_screenTrajectory.emplace_back(toScreenCoords(world_point.first, world_point.second), sf::Color::White);
+void TrajectoryVisualizer::updateTrajectoryGeometry() {
+    const size_t pointCount = worldPointCount();
+    if (pointCount == 0) {
+        m_trajectoryVertices.clear();
+        m_geometryValid = false;
+        return;
     }
 
-    if (!m_showAllPointsImmediately) {
-        m_currentPointIndex = std::min(m_currentPointIndex, m_screenTrajectory.size());
-        if (m_currentPointIndex == 0 && !m_screenTrajectory.empty()) {
-            m_currentPointIndex = 1;
-        }
+    // Вершины перестраиваются, только если сменился уровень детализации или центр вида ушел
+    // от начала координат вершин так далеко, что точности float перестает хватать.
+    // Обычные сдвиг и масштабирование меняют только преобразование
+    const int level = m_lod.selectLevel(m_scale);
+    const Vector2d viewCenter(-m_offset.x / m_scale, m_offset.y / m_scale);
+    const double originDistance = std::max(std::abs(viewCenter.x - m_geometryOrigin.x),
+        std::abs(viewCenter.y - m_geometryOrigin.y)) * m_scale;
+    if (m_geometryValid && level == m_lodLevel && originDistance < RECENTER_DISTANCE_PIXELS) return;
+    ScopedTimer timer(ProfilePhase::VertexPreparation);
+
+    m_lodLevel = level;
+    m_geometryOrigin = viewCenter;
+    m_geometryValid = true;
+
+    m_trajectoryVertices.clear();
+    auto addVertex = [this](const WorldTrajectoryPoint& world_point) {
+        m_trajectoryVertices.emplace_back(sf::Vector2f(
+            static_cast<float>(world_point.first - m_geometryOrigin.x),
+            static_cast<float>(world_point.second - m_geometryOrigin.y)), sf::Color::White);
+    };
+    // Берется самый грубый уровень, который при текущем масштабе отличается от полной линии меньше чем на полпикселя
+    if (m_lodLevel < 0) {
+        m_trajectoryVertices.reserve(pointCount);
+        for (size_t i = 0; i < pointCount; ++i) addVertex(worldPoint(i));
     }
     else {
-        m_currentPointIndex = m_screenTrajectory.size();
+        const TrajectoryLod::Level& lodLevel = m_lod.level(static_cast<size_t>(m_lodLevel));
+        m_trajectoryVertices.reserve(lodLevel.points.size());
+        for (const auto& world_point : lodLevel.points) addVertex(world_point);
     }
+
+    // Вершины один раз загружаются в видеопамять и дальше рисуются оттуда
+    if (m_useVertexBuffer) {
+        if (m_trajectoryBuffer.getVertexCount() < m_trajectoryVertices.size()) {
+            m_useVertexBuffer = m_trajectoryBuffer.create(m_trajectoryVertices.size());
+        }
+        if (m_useVertexBuffer) {
+            m_useVertexBuffer = m_trajectoryBuffer.update(m_trajectoryVertices.data(), m_trajectoryVertices.size(), 0);
+        }
+    }
+    Profiler::instance().addCount(ProfileCounter::VerticesPrepared, static_cast<long long>(m_trajectoryVertices.size()));
+}
+
+void TrajectoryVisualizer::rebuildLod() {
+    ScopedTimer timer(ProfilePhase::LodBuild);
+    m_lod.build(worldPointCount(), [this](size_t i) { return worldPoint(i); });
 }
 
 void TrajectoryVisualizer::setupInfoText() {
     if (!m_font.loadFromFile(FONT_FILENAME)) {
-        std::cerr << "TrajectoryVisualizer: :     " << FONT_FILENAME << "\n";
+        std::cerr << "TrajectoryVisualizer: Ошибка: не удалось загрузить шрифт " << FONT_FILENAME << "\n";
     }
     m_infoText.setFont(m_font);
     m_infoText.setCharacterSize(INFO_TEXT_CHAR_SIZE);
@@ -71,7 +123,7 @@ void TrajectoryVisualizer::updateInfoText() {
     oss << std::fixed << std::setprecision(2);
     oss << "Scale: " << m_scale << "\n";
     oss << "Offset: (" << m_offset.x << ", " << m_offset.y << ")\n";
-    oss << "Points drawn: " << m_currentPointIndex << "/" << m_worldTrajectoryData.size() << "\n";
+    oss << "Points drawn: " << m_currentPointIndex << "/" << worldPointCount() << "\n";
     oss << "Animation: " << (m_isPaused ? "Paused" : "Running")
         << " (" << m_pointsPerFrame << " pts/frame)\n";
     oss << "Controls:\n";
@@ -81,10 +133,14 @@ void TrajectoryVisualizer::updateInfoText() {
     oss << "  F: Toggle full trajectory\n";
     oss << "  +/-: Change animation speed\n";
     oss << "  R: Reset view & animation\n";
+    oss << "  F3: Toggle profiling, F4: Save " << PROFILE_FILENAME << "\n";
     oss << "  Esc: Exit";
-    m_infoText.setString(oss.str()); //  sf::Text   sf::String  L""   
-    //    ASCII,   oss.str()  .
-    //   : m_infoText.setString(sf::String::fromUtf8(oss.str().c_str()));
+    if (Profiler::instance().isEnabled()) {
+        oss << "\n\n" << Profiler::instance().overlayText();
+    }
+    m_infoText.setString(oss.str()); // Для sf::Text лучше использовать sf::String или L"" если есть кириллица
+    // но здесь только ASCII, так что oss.str() должен работать.
+    // Для надежности можно: m_infoText.setString(sf::String::fromUtf8(oss.str().c_str()));
 }
 
 void TrajectoryVisualizer::handleEvent(const sf::Event& event) {
@@ -97,21 +153,20 @@ void TrajectoryVisualizer::handleEvent(const sf::Event& event) {
         sf::FloatRect visibleArea(0, 0, static_cast<float>(event.size.width), static_cast<float>(event.size.height));
         m_window.setView(sf::View(visibleArea));
         m_screenCenter = { event.size.width / 2.f, event.size.height / 2.f };
-        recalculateScreenTrajectory();
     }
     break;
     case sf::Event::KeyPressed:
         handleKeyPress(event.key);
         break;
     case sf::Event::MouseWheelScrolled:
-        if (event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel && event.mouseWheelScroll.delta != 0) { //   
-            sf::Vector2f worldPosBeforeZoom = toWorldCoords(static_cast<sf::Vector2f>(sf::Mouse::getPosition(m_window)));
+        if (event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel && event.mouseWheelScroll.delta != 0) { // Проверяем тип колеса
+            Vector2d worldPosBeforeZoom = toWorldCoords(static_cast<sf::Vector2f>(sf::Mouse::getPosition(m_window)));
             float zoomFactor = (event.mouseWheelScroll.delta > 0) ? ZOOM_FACTOR_STEP : 1.0f / ZOOM_FACTOR_STEP;
             m_scale *= zoomFactor;
-            sf::Vector2f worldPosAfterZoom = toWorldCoords(static_cast<sf::Vector2f>(sf::Mouse::getPosition(m_window)));
+            Vector2d worldPosAfterZoom = toWorldCoords(static_cast<sf::Vector2f>(sf::Mouse::getPosition(m_window)));
             m_offset.x += (worldPosAfterZoom.x - worldPosBeforeZoom.x) * m_scale;
-            m_offset.y += (worldPosAfterZoom.y - worldPosBeforeZoom.y) * m_scale;
-            recalculateScreenTrajectory();
+            m_offset.y -= (worldPosAfterZoom.y - worldPosBeforeZoom.y) * m_scale;
+            updateTrajectoryGeometry();
         }
         break;
     case sf::Event::MouseButtonPressed:
@@ -129,9 +184,9 @@ void TrajectoryVisualizer::handleEvent(const sf::Event& event) {
         if (m_isDragging) {
             sf::Vector2i newMousePos = sf::Mouse::getPosition(m_window);
             sf::Vector2f delta = static_cast<sf::Vector2f>(newMousePos - m_lastMousePos);
-            m_offset += delta;
+            m_offset += Vector2d(delta);
             m_lastMousePos = newMousePos;
-            recalculateScreenTrajectory();
+            updateTrajectoryGeometry(); // Обычно ничего не перестраивает
         }
         break;
     default:
@@ -145,24 +200,28 @@ void TrajectoryVisualizer::handleKeyPress(const sf::Event::KeyEvent& keyEvent) {
     if (keyEvent.code == sf::Keyboard::F) {
         m_showAllPointsImmediately = !m_showAllPointsImmediately;
         if (m_showAllPointsImmediately) {
-            m_currentPointIndex = m_screenTrajectory.size();
+            m_currentPointIndex = worldPointCount();
         }
         else {
-            m_currentPointIndex = m_screenTrajectory.empty() ? 0 : 1;
+            m_currentPointIndex = (worldPointCount() == 0) ? 0 : 1;
         }
     }
-    if (keyEvent.code == sf::Keyboard::Add || keyEvent.code == sf::Keyboard::Equal) { // Equal  +   
+    if (keyEvent.code == sf::Keyboard::Add || keyEvent.code == sf::Keyboard::Equal) { // Equal это + на основной клавиатуре
         m_pointsPerFrame = std::min(m_pointsPerFrame * ANIMATION_SPEED_MULTIPLIER, MAX_POINTS_PER_FRAME);
     }
-    if (keyEvent.code == sf::Keyboard::Subtract || keyEvent.code == sf::Keyboard::Hyphen) { // Hyphen  -   
+    if (keyEvent.code == sf::Keyboard::Subtract || keyEvent.code == sf::Keyboard::Hyphen) { // Hyphen это - на основной клавиатуре
         m_pointsPerFrame = std::max(m_pointsPerFrame / ANIMATION_SPEED_MULTIPLIER, MIN_POINTS_PER_FRAME);
     }
     if (keyEvent.code == sf::Keyboard::R) resetViewAndAnimation();
+    if (keyEvent.code == sf::Keyboard::F3) Profiler::instance().setEnabled(!Profiler::instance().isEnabled());
+    if (keyEvent.code == sf::Keyboard::F4 && Profiler::instance().writeJson(PROFILE_FILENAME)) {
+        std::cout << "TrajectoryVisualizer: замеры записаны в " << PROFILE_FILENAME << "\n";
+    }
 }
 
 void TrajectoryVisualizer::updateAnimation() {
-    if (!m_isPaused && !m_showAllPointsImmediately && m_currentPointIndex < m_screenTrajectory.size()) {
-        m_currentPointIndex = std::min(m_screenTrajectory.size(), m_currentPointIndex + m_pointsPerFrame);
+    if (!m_isPaused && !m_showAllPointsImmediately && m_currentPointIndex < worldPointCount()) {
+        m_currentPointIndex = std::min(worldPointCount(), m_currentPointIndex + m_pointsPerFrame);
     }
 }
 
@@ -175,16 +234,24 @@ void TrajectoryVisualizer::draw() {
     centerMassShape.setPosition(toScreenCoords(0, 0));
     m_window.draw(centerMassShape);
 
-    if (!m_screenTrajectory.empty()) {
-        size_t pointsToDraw = std::min(m_currentPointIndex, m_screenTrajectory.size());
+    if (!m_trajectoryVertices.empty()) {
+        ScopedTimer timer(ProfilePhase::CanvasDraw);
+        // Вершины уровня детализации, соответствующие уже нарисованным точкам траектории
+        size_t pointsToDraw = std::min(m_lod.pointsBefore(m_lodLevel, m_currentPointIndex), m_trajectoryVertices.size());
+        sf::RenderStates states(trajectoryTransform());
         if (pointsToDraw >= 2) {
-            m_window.draw(&m_screenTrajectory[0], pointsToDraw, sf::LineStrip);
+            if (m_useVertexBuffer) {
+                m_window.draw(m_trajectoryBuffer, 0, pointsToDraw, states);
+            }
+            else {
+                m_window.draw(m_trajectoryVertices.data(), pointsToDraw, sf::LineStrip, states);
+            }
         }
         else if (pointsToDraw == 1) {
             sf::CircleShape firstPointShape(TRAJECTORY_START_POINT_RADIUS);
             firstPointShape.setFillColor(sf::Color::White);
             firstPointShape.setOrigin(TRAJECTORY_START_POINT_RADIUS, TRAJECTORY_START_POINT_RADIUS);
-            firstPointShape.setPosition(m_screenTrajectory[0].position);
+            firstPointShape.setPosition(states.transform.transformPoint(m_trajectoryVertices[0].position));
             m_window.draw(firstPointShape);
         }
     }
@@ -193,53 +260,103 @@ void TrajectoryVisualizer::draw() {
     m_window.display();
 }
 
+size_t TrajectoryVisualizer::worldPointCount() const {
+    if (m_compressedTrajectory) return m_compressedTrajectory->size();
+    return m_mappedTrajectory ? m_mappedTrajectory->size() : m_worldTrajectoryData.size();
+}
+
+WorldTrajectoryPoint TrajectoryVisualizer::worldPoint(size_t index) const {
+    if (m_compressedTrajectory) {
+        // Точки запрашиваются по порядку, поэтому кэш блока почти всегда попадает
+        const State state = m_compressedTrajectory->state(index);
+        return { state.x, state.y };
+    }
+    if (m_mappedTrajectory) {
+        return { m_mappedTrajectory->x(index), m_mappedTrajectory->y(index) };
+    }
+    return m_worldTrajectoryData[index];
+}
+
 void TrajectoryVisualizer::setData(const WorldTrajectoryData& data) {
+    m_mappedTrajectory.reset();
+    m_compressedTrajectory.reset();
     m_worldTrajectoryData = data;
+    rebuildLod();
+    resetViewAndAnimation();
+    // updateTrajectoryGeometry(); // Вызывается внутри resetViewAndAnimation
+}
+
+void TrajectoryVisualizer::setData(std::shared_ptr<const CompressedTrajectory> data) {
+    m_mappedTrajectory.reset();
+    m_worldTrajectoryData.clear();
+    m_worldTrajectoryData.shrink_to_fit();
+    m_compressedTrajectory = std::move(data);
+    rebuildLod();
     resetViewAndAnimation();
-    // recalculateScreenTrajectory(); //   resetViewAndAnimation
 }
 
 bool TrajectoryVisualizer::loadDataFromFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "TrajectoryVisualizer: :      " << filename << "\n";
+    ScopedTimer timer(ProfilePhase::TrajectoryLoad);
+    // Бинарный формат читается напрямую из отображенного в память файла, текстовый - разбирается
+    if (MappedTrajectoryFile::isBinaryTrajectoryFile(filename)) {
+        return loadBinaryFile(filename);
+    }
+
+    TextTrajectoryParseResult parsed; // Разбор идет параллельно, неверные строки собираются по порядку
+    if (!parseTrajectoryTextFile(filename, parsed)) {
+        std::cerr << "TrajectoryVisualizer: Ошибка: не удалось открыть файл траектории " << filename << "\n";
         return false;
     }
-    WorldTrajectoryData data;
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        double x, y;
-        if (iss >> x >> y) {
-            data.emplace_back(x, y);
-        }
-        else {
-            std::cerr << "TrajectoryVisualizer: :     : " << line << "\n";
-        }
+    for (const auto& line : parsed.malformedLines) {
+        std::cerr << "TrajectoryVisualizer: Предупреждение: неверный формат строки в файле: " << line << "\n";
     }
-    file.close(); //  
-    if (data.empty()) {
-        std::cerr << "TrajectoryVisualizer: :  " << filename << "      .\n";
+    if (parsed.points.empty()) {
+        std::cerr << "TrajectoryVisualizer: Ошибка: файл " << filename << " пуст или не содержит корректных данных.\n";
         return false;
     }
-    setData(data);
+    m_mappedTrajectory.reset();
+    m_compressedTrajectory.reset();
+    m_worldTrajectoryData = std::move(parsed.points); // Без копирования, в отличие от setData
+    rebuildLod();
+    resetViewAndAnimation();
+    return true;
+}
+
+bool TrajectoryVisualizer::loadBinaryFile(const std::string& filename) {
+    auto mapped = std::make_unique<MappedTrajectoryFile>();
+    std::string error;
+    if (!mapped->open(filename, error)) {
+        std::cerr << "TrajectoryVisualizer: Ошибка: " << error << "\n";
+        return false;
+    }
+    if (mapped->size() == 0) {
+        std::cerr << "TrajectoryVisualizer: Ошибка: файл " << filename << " пуст или не содержит корректных данных.\n";
+        return false;
+    }
+    m_worldTrajectoryData.clear();
+    m_worldTrajectoryData.shrink_to_fit();
+    m_compressedTrajectory.reset();
+    m_mappedTrajectory = std::move(mapped);
+    rebuildLod();
+    resetViewAndAnimation();
     return true;
 }
 
 void TrajectoryVisualizer::resetViewAndAnimation() {
     m_scale = DEFAULT_SCALE;
-    m_offset = { 0.f, 0.f };
+    m_offset = { 0.0, 0.0 };
     m_isPaused = false;
     m_showAllPointsImmediately = false;
     m_pointsPerFrame = DEFAULT_POINTS_PER_FRAME;
-    m_currentPointIndex = m_worldTrajectoryData.empty() ? 0 : 1;
-    recalculateScreenTrajectory();
+    m_currentPointIndex = (worldPointCount() == 0) ? 0 : 1;
+    m_geometryValid = false; // Данные могли смениться
+    updateTrajectoryGeometry();
 }
 
 void TrajectoryVisualizer::run() {
-    if (m_worldTrajectoryData.empty()) {
-        std::cerr << "TrajectoryVisualizer:    .  .\n";
-        //       
+    if (worldPointCount() == 0) {
+        std::cerr << "TrajectoryVisualizer: Нет данных для визуализации. Загрузите данные.\n";
+        // Можно просто показать пустое окно с сообщением
         bool dataNotLoaded = true;
         while (m_window.isOpen() && dataNotLoaded) {
             sf::Event event{};
@@ -247,15 +364,16 @@ void TrajectoryVisualizer::run() {
                 if (event.type == sf::Event::Closed) m_window.close();
                 if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape) m_window.close();
             }
-            updateInfoText(); //  ,      
+            updateInfoText(); // Обновит текст, который может содержать сообщение об ошибке
             m_window.clear(sf::Color::Black);
-            m_window.draw(m_infoText); //  - (   )
+            m_window.draw(m_infoText); // Показать инфо-текст (можно изменить его содержимое)
             m_window.display();
-            if (!m_worldTrajectoryData.empty()) dataNotLoaded = false; //      /
+            if (worldPointCount() != 0) dataNotLoaded = false; // Если данные загрузились в другом потоке/способом
         }
-        if (!m_window.isOpen()) return; //    
+        if (!m_window.isOpen()) return; // Если окно было закрыто
     }
 
+    sf::Clock frameClock;
     while (m_window.isOpen()) {
         sf::Event event{};
         while (m_window.pollEvent(event)) {
@@ -264,5 +382,6 @@ void TrajectoryVisualizer::run() {
         updateAnimation();
         updateInfoText();
         draw();
+        Profiler::instance().recordFrame(frameClock.restart().asSeconds());
     }
 }
\ No newline at end of file
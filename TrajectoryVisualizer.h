@@ -5,17 +5,18 @@
 #include <SFML/Graphics.hpp>
 #include <vector>
 #include <string>
-#include <cmath>    //  std::sqrt, std::min, std::max
-#include <iostream> //  std::cerr, std::cout
-#include <fstream>  //  std::ifstream, std::ofstream
-#include <sstream>  //  std::istringstream, std::ostringstream
-#include <iomanip>  //  std::fixed, std::setprecision
-#include <algorithm> //  std::min, std::max (,   )
+#include <cmath>    // Для std::sqrt, std::min, std::max
+#include <iostream> // Для std::cerr, std::cout
+#include <fstream>  // Для std::ifstream, std::ofstream
+#include <sstream>  // Для std::istringstream, std::ostringstream
+#include <iomanip>  // Для std::fixed, std::setprecision
+#include <algorithm> // Для std::min, std::max (дублирование, но не страшно)
+#include <memory>   // Для std::unique_ptr
 
-//     ,    Calculations.h
-//     "types.h",     .
-using WorldTrajectoryPoint = std::pair<double, double>;
-using WorldTrajectoryData = std::vector<WorldTrajectoryPoint>;
+#include "TrajectoryIO.h" // WorldTrajectoryPoint, WorldTrajectoryData
+#include "CompressedTrajectory.h"
+#include "Profiler.h"
+#include "TrajectoryLod.h"
 
 
 class TrajectoryVisualizer {
@@ -23,30 +24,48 @@ public:
     TrajectoryVisualizer(unsigned int width, unsigned int height, const std::string& windowTitle = "Trajectory Visualizer");
 
     void setData(const WorldTrajectoryData& data);
+    // Сжатая траектория читается поблочно, без распаковки целиком
+    void setData(std::shared_ptr<const CompressedTrajectory> data);
     bool loadDataFromFile(const std::string& filename);
     void run();
     void resetViewAndAnimation();
 
 private:
-    // ---   ---
-    //    static constexpr      ,    
+    // --- Константы визуализации ---
+    // Их можно сделать static constexpr членами класса или оставить как есть, если они не меняются
     static constexpr float DEFAULT_SCALE = 150.0f;
     static constexpr unsigned int DEFAULT_POINTS_PER_FRAME = 1u;
     static constexpr unsigned int MIN_POINTS_PER_FRAME = 1u;
     static constexpr unsigned int MAX_POINTS_PER_FRAME = 2048u;
     static constexpr unsigned int ANIMATION_SPEED_MULTIPLIER = 2;
     const std::string FONT_FILENAME = "arial.ttf";
+    const std::string PROFILE_FILENAME = "profile.json"; // Выгрузка замеров по F4
     static constexpr unsigned int INFO_TEXT_CHAR_SIZE = 16;
     static constexpr float CENTER_POINT_RADIUS = 5.0f;
     static constexpr float TRAJECTORY_START_POINT_RADIUS = 2.0f;
     static constexpr float ZOOM_FACTOR_STEP = 1.3f;
+    // Удаление центра вида от начала координат вершин (в пикселях), после которого вершины
+    // пересчитываются относительно нового начала: ошибка float при этом меньше 0.1 пикселя
+    static constexpr double RECENTER_DISTANCE_PIXELS = 1 << 20;
+
+    using Vector2d = sf::Vector2<double>;
 
     sf::RenderWindow m_window;
     WorldTrajectoryData m_worldTrajectoryData;
-    std::vector<sf::Vertex> m_screenTrajectory;
+    std::unique_ptr<MappedTrajectoryFile> m_mappedTrajectory; // Бинарный файл, из которого точки читаются без копирования
+    std::shared_ptr<const CompressedTrajectory> m_compressedTrajectory;
+    TrajectoryLod m_lod;            // Уровни детализации, строятся один раз при загрузке данных
+    int m_lodLevel;                 // Уровень, из которого построены m_trajectoryVertices (-1 - все точки)
+    // Вершины в мировых координатах относительно m_geometryOrigin; сдвиг и масштаб задаются
+    // преобразованием при отрисовке, поэтому панорамирование и зум не трогают вершины
+    Vector2d m_geometryOrigin;
+    bool m_geometryValid;
+    std::vector<sf::Vertex> m_trajectoryVertices;
+    bool m_useVertexBuffer;
+    sf::VertexBuffer m_trajectoryBuffer;
 
     float m_scale;
-    sf::Vector2f m_offset;
+    Vector2d m_offset; // В пикселях; double, чтобы не терять точность при сильном увеличении
     sf::Vector2f m_screenCenter;
 
     size_t m_currentPointIndex;
@@ -60,10 +79,15 @@ private:
     bool m_isDragging;
     sf::Vector2i m_lastMousePos;
 
-    //  
+    // Приватные методы
     sf::Vector2f toScreenCoords(double worldX, double worldY) const;
-    sf::Vector2f toWorldCoords(sf::Vector2f screenPos) const;
-    void recalculateScreenTrajectory();
+    Vector2d toWorldCoords(sf::Vector2f screenPos) const;
+    sf::Transform trajectoryTransform() const;
+    void updateTrajectoryGeometry();
+    void rebuildLod();
+    size_t worldPointCount() const;
+    WorldTrajectoryPoint worldPoint(size_t index) const; // Из m_worldTrajectoryData или из отображенного файла
+    bool loadBinaryFile(const std::string& filename);
     void setupInfoText();
     void updateInfoText();
     void handleEvent(const sf::Event& event);
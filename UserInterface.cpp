@@ -1,14 +1,16 @@
 #include "UserInterface.h"
-#include <iostream> //  
-#include <algorithm> //  std::min_element, std::max_element
+#include <iostream> // Для отладки
+#include <algorithm> // Для std::min_element, std::max_element
+#include <charconv> // Для std::to_chars (не зависит от setlocale)
+#include <cmath> // Для std::ceil
 
 #if defined(_MSC_VER)
 #pragma execution_character_set("utf-8")
 #endif
 
-// ---       ---
+// --- Вспомогательная функция для создания строки ввода ---
 std::pair<tgui::Label::Ptr, tgui::EditBox::Ptr> createInputRowControls(const sf::String& labelText, float editBoxWidth, float rowHeight) {
-    auto label = tgui::Label::create(tgui::String(labelText)); // sf::String  L""    tgui::Label
+    auto label = tgui::Label::create(tgui::String(labelText)); // sf::String с L"" хорошо работает с tgui::Label
     if (label) {
         label->getRenderer()->setTextColor(tgui::Color::Black);
         label->setVerticalAlignment(tgui::Label::VerticalAlignment::Center);
@@ -21,15 +23,15 @@ std::pair<tgui::Label::Ptr, tgui::EditBox::Ptr> createInputRowControls(const sf:
     return { label, editBox };
 }
 
-// ---    ---
+// --- Конструктор и инициализация ---
 UserInterface::UserInterface()
-    : m_window({ 1200, 800 }, L"   "),
+    : m_window({ 1200, 800 }, L"Расчет траектории движения тела"),
     m_gui(m_window),
     m_trajectoryAvailable(false) {
 
     m_gui.setFont("arial.ttf");
 
-    //    SFML (  Canvas)
+    // Загрузка шрифта для SFML (используется на Canvas)
     if (!m_sfmlFont.loadFromFile("arial.ttf")) {
         std::cerr << "SFML: Error - Failed to load font 'arial.ttf' for SFML rendering!\n";
     }
@@ -37,13 +39,17 @@ UserInterface::UserInterface()
     initializeGui();
 }
 
+UserInterface::~UserInterface() {
+    stopSimulation();
+}
+
 void UserInterface::initializeGui() {
     std::cout << "DEBUG: Initializing GUI..." << std::endl;
     loadWidgets();
-    setupLayout(); //  setupLayout  loadWidgets
+    setupLayout(); // Вызываем setupLayout после loadWidgets
     setupLayout();
     connectSignals();
-    populateTable({}); //    
+    refreshTable(); // Начальное пустое состояние таблицы
     std::cout << "DEBUG: GUI Initialized." << std::endl;
 }
 
@@ -55,20 +61,20 @@ void UserInterface::initializeGui() {
 //    sf::RenderTexture& rt = m_trajectoryCanvas->getRenderTexture();
 //    if (rt.getSize().x == 0 || rt.getSize().y == 0) {
 //        std::cout << "Warning: TGUI Canvas RenderTarget has zero size in resetTguiCanvasView. Using default view." << std::endl;
-//        m_tguiCanvasView = rt.getDefaultView(); //     
-//        m_tguiCanvasCurrentScaleFactor = 1.0f; //     getDefaultView
+//        m_tguiCanvasView = rt.getDefaultView(); // Используем стандартный вид по умолчанию
+//        m_tguiCanvasCurrentScaleFactor = 1.0f; // Соответствует отсутствию зума в getDefaultView
 //    }
 //    else {
 //        m_tguiCanvasView.setSize(static_cast<sf::Vector2f>(rt.getSize()));
-//        m_tguiCanvasView.setCenter(0.f, 0.f); //  (0,0)   View
+//        m_tguiCanvasView.setCenter(0.f, 0.f); // Мировой (0,0) в центре View
 //        m_tguiCanvasView.zoom(1.0f / TGUI_CANVAS_INITIAL_SCALE_FACTOR);
 //        m_tguiCanvasCurrentScaleFactor = TGUI_CANVAS_INITIAL_SCALE_FACTOR;
 //    }
 //    std::cout << "DEBUG: TGUI Canvas View reset/initialized." << std::endl;
-//    // prepareTrajectoryForDisplay(); //     m_calculatedStates
+//    // prepareTrajectoryForDisplay(); // Вызывать после получения новой m_trajectory
 //}
 
-// ---   ---
+// --- Загрузка виджетов ---
 void UserInterface::loadWidgets() {
     std::cout << "DEBUG: Loading all widgets..." << std::endl;
     loadLeftPanelWidgets();
@@ -84,8 +90,8 @@ void UserInterface::loadLeftPanelWidgets() {
     m_leftPanel->getRenderer()->setBorderColor(tgui::Color::Black);
     m_gui.add(m_leftPanel);
 
-    // 1.  " "
-    m_inputTitleLabel = tgui::Label::create(L" ");
+    // 1. Заголовок "Исходные значения"
+    m_inputTitleLabel = tgui::Label::create(L"Исходные значения");
     if (!m_inputTitleLabel) { std::cerr << "Error: Failed to create m_inputTitleLabel" << std::endl; return; }
     m_inputTitleLabel->getRenderer()->setTextStyle(tgui::TextStyle::Bold);
     m_inputTitleLabel->setHorizontalAlignment(tgui::Label::HorizontalAlignment::Center);
@@ -94,14 +100,14 @@ void UserInterface::loadLeftPanelWidgets() {
     m_inputTitleLabel->setPosition({ PANEL_PADDING, PANEL_PADDING });
     m_leftPanel->add(m_inputTitleLabel);
 
-    // 2. Grid   
-    m_inputControlsGrid = tgui::Grid::create(); //   
+    // 2. Grid для полей ввода
+    m_inputControlsGrid = tgui::Grid::create(); // Используем член класса
     if (!m_inputControlsGrid) { std::cerr << "Error: Failed to create m_inputControlsGrid" << std::endl; return; }
     m_inputControlsGrid->setPosition({ PANEL_PADDING, tgui::bindBottom(m_inputTitleLabel) + WIDGET_SPACING });
     m_leftPanel->add(m_inputControlsGrid);
 
     unsigned int currentRow = 0;
-    //      inputControlsGrid
+    // Лямбда для добавления строки в inputControlsGrid
     auto addInputRowToGrid = [&](const sf::String& text, tgui::EditBox::Ptr& editBoxMember) {
         auto pair = createInputRowControls(text, INPUT_FIELD_WIDTH, INPUT_ROW_HEIGHT);
         if (!pair.first || !pair.second) {
@@ -111,31 +117,49 @@ void UserInterface::loadLeftPanelWidgets() {
         editBoxMember = pair.second;
         m_inputControlsGrid->addWidget(pair.first, currentRow, 0);
         m_inputControlsGrid->addWidget(editBoxMember, currentRow, 1);
-        m_inputControlsGrid->setWidgetPadding(currentRow, 0, { 5, 5, 5, 0 });  // Label: T,R,B,L (0 , ..    )
-        m_inputControlsGrid->setWidgetPadding(currentRow, 1, { 5, 0, 5, 5 });  // EditBox: T,R,B,L (0 )
+        m_inputControlsGrid->setWidgetPadding(currentRow, 0, { 5, 5, 5, 0 });  // Label: T,R,B,L (0 слева, т.к. грид имеет свой отступ)
+        m_inputControlsGrid->setWidgetPadding(currentRow, 1, { 5, 0, 5, 5 });  // EditBox: T,R,B,L (0 справа)
         currentRow++;
     };
 
-    addInputRowToGrid(L"m (, ):", m_edit_m);
-    addInputRowToGrid(L"M (, ):", m_edit_M);
-    addInputRowToGrid(L"V0 (, /):", m_edit_V0);
-    addInputRowToGrid(L"T (, ):", m_edit_T);
-    addInputRowToGrid(L"k ():", m_edit_k);
-    addInputRowToGrid(L"F ():", m_edit_F);
+    addInputRowToGrid(L"m (масса, кг):", m_edit_m);
+    addInputRowToGrid(L"M (масса, кг):", m_edit_M);
+    addInputRowToGrid(L"V0 (скорость, м/с):", m_edit_V0);
+    addInputRowToGrid(L"T (время, сек):", m_edit_T);
+    addInputRowToGrid(L"k (безразмерная):", m_edit_k);
+    addInputRowToGrid(L"F (безразмерная):", m_edit_F);
 
-    // 3.  " !"
-    m_calculateButton = tgui::Button::create(L" !");
+    // 3. Кнопка "Рассчитать траекторию!"
+    m_calculateButton = tgui::Button::create(L"Рассчитать траекторию!");
     if (!m_calculateButton) { std::cerr << "Error: Failed to create m_calculateButton" << std::endl; return; }
     m_calculateButton->getRenderer()->setRoundedBorderRadius(15);
     m_calculateButton->setSize({ "100% - " + tgui::String::fromNumber(2 * PANEL_PADDING), 40 });
-    m_calculateButton->setPosition({ PANEL_PADDING, tgui::bindBottom(m_inputControlsGrid) + WIDGET_SPACING * 2 }); //    
+    m_calculateButton->setPosition({ PANEL_PADDING, tgui::bindBottom(m_inputControlsGrid) + WIDGET_SPACING * 2 }); // Больший отступ для кнопки
     m_leftPanel->add(m_calculateButton);
+
+    // 4. Отмена расчета и индикатор выполнения
+    m_cancelButton = tgui::Button::create(L"Отменить расчет");
+    if (!m_cancelButton) { std::cerr << "Error: Failed to create m_cancelButton" << std::endl; return; }
+    m_cancelButton->getRenderer()->setRoundedBorderRadius(15);
+    m_cancelButton->setSize({ "100% - " + tgui::String::fromNumber(2 * PANEL_PADDING), 30 });
+    m_cancelButton->setPosition({ PANEL_PADDING, tgui::bindBottom(m_calculateButton) + WIDGET_SPACING });
+    m_cancelButton->setEnabled(false);
+    m_leftPanel->add(m_cancelButton);
+
+    m_progressBar = tgui::ProgressBar::create();
+    if (!m_progressBar) { std::cerr << "Error: Failed to create m_progressBar" << std::endl; return; }
+    m_progressBar->setSize({ "100% - " + tgui::String::fromNumber(2 * PANEL_PADDING), 24 });
+    m_progressBar->setPosition({ PANEL_PADDING, tgui::bindBottom(m_cancelButton) + WIDGET_SPACING });
+    m_progressBar->setMinimum(0);
+    m_progressBar->setMaximum(PROGRESS_BAR_RESOLUTION);
+    m_progressBar->setValue(0);
+    m_leftPanel->add(m_progressBar);
 }
 
 void UserInterface::loadRightPanelWidgets() {
     m_rightPanel = tgui::Panel::create();
     if (!m_rightPanel) { std::cerr << "Error: Failed to create m_rightPanel" << std::endl; return; }
-    m_gui.add(m_rightPanel); //  ,   
+    m_gui.add(m_rightPanel); // Сначала добавляем, потом настраиваем содержимое
 
     loadTrajectoryWidgets(m_rightPanel);
     loadTableWidgets(m_rightPanel);
@@ -149,19 +173,29 @@ void UserInterface::loadTrajectoryWidgets(tgui::Panel::Ptr parentPanel) {
     m_trajectoryContainerPanel->getRenderer()->setBackgroundColor(tgui::Color::White);
     parentPanel->add(m_trajectoryContainerPanel);
 
-    m_trajectoryTitleLabel = tgui::Label::create(L"  ");
+    m_trajectoryTitleLabel = tgui::Label::create(L"Траектория движения тела");
     if (!m_trajectoryTitleLabel) { std::cerr << "Error: Failed to create m_trajectoryTitleLabel" << std::endl; return; }
     m_trajectoryTitleLabel->getRenderer()->setTextStyle(tgui::TextStyle::Bold);
     m_trajectoryTitleLabel->setHorizontalAlignment(tgui::Label::HorizontalAlignment::Center);
     m_trajectoryTitleLabel->getRenderer()->setTextColor(tgui::Color::Black);
     m_trajectoryTitleLabel->setSize({ "100%", TITLE_HEIGHT });
-    m_trajectoryContainerPanel->add(m_trajectoryTitleLabel, "TrajectoryTitle"); //     
+    m_trajectoryContainerPanel->add(m_trajectoryTitleLabel, "TrajectoryTitle"); // Используем имя для позиционирования канваса
 
     m_trajectoryCanvas = tgui::Canvas::create();
     if (!m_trajectoryCanvas) { std::cerr << "Error: Failed to create m_trajectoryCanvas" << std::endl; return; }
     m_trajectoryCanvas->setSize({ "100%", "100% - " + tgui::String::fromNumber(TITLE_HEIGHT) });
     m_trajectoryCanvas->setPosition({ 0, "TrajectoryTitle.bottom" });
     m_trajectoryContainerPanel->add(m_trajectoryCanvas);
+
+    m_profilerLabel = tgui::Label::create();
+    if (!m_profilerLabel) { std::cerr << "Error: Failed to create m_profilerLabel" << std::endl; return; }
+    m_profilerLabel->getRenderer()->setTextColor(tgui::Color(40, 40, 40));
+    m_profilerLabel->getRenderer()->setBackgroundColor(tgui::Color(255, 255, 255, 200));
+    m_profilerLabel->setTextSize(12);
+    m_profilerLabel->setAutoSize(true);
+    m_profilerLabel->setPosition({ 5, "TrajectoryTitle.bottom + 5" });
+    m_profilerLabel->setVisible(Profiler::instance().isEnabled());
+    m_trajectoryContainerPanel->add(m_profilerLabel);
 }
 
 void UserInterface::loadTableWidgets(tgui::Panel::Ptr parentPanel) {
@@ -172,7 +206,7 @@ void UserInterface::loadTableWidgets(tgui::Panel::Ptr parentPanel) {
     m_tableContainerPanel->getRenderer()->setBackgroundColor(tgui::Color::White);
     parentPanel->add(m_tableContainerPanel);
 
-    m_tableTitleLabel = tgui::Label::create(L"   ");
+    m_tableTitleLabel = tgui::Label::create(L"Таблица координат и скоростей");
     if (!m_tableTitleLabel) { std::cerr << "Error: Failed to create m_tableTitleLabel" << std::endl; return; }
     m_tableTitleLabel->getRenderer()->setTextStyle(tgui::TextStyle::Bold);
     m_tableTitleLabel->setHorizontalAlignment(tgui::Label::HorizontalAlignment::Center);
@@ -185,46 +219,85 @@ void UserInterface::loadTableWidgets(tgui::Panel::Ptr parentPanel) {
     m_tableHeaderGrid->setSize({ "100% - " + tgui::String::fromNumber(SCROLLBAR_WIDTH_ESTIMATE), HEADER_HEIGHT });
     m_tableHeaderGrid->setPosition({ 0, "TableTitle.bottom" });
 
-    std::vector<sf::String> headers = { L"h, ", L"x", L"y", L"Vx", L"Vy" };
+    std::vector<sf::String> headers = { L"h, сек", L"x", L"y", L"Vx", L"Vy" };
     for (size_t i = 0; i < headers.size(); ++i) {
         auto headerLabel = tgui::Label::create(tgui::String(headers[i]));
         if (!headerLabel) { std::cerr << "Error: Failed to create headerLabel " << i << std::endl; continue; }
         headerLabel->getRenderer()->setTextColor(tgui::Color::Black);
-        headerLabel->getRenderer()->setBorders({ 0,0,0,1 }); //   
+        headerLabel->getRenderer()->setBorders({ 0,0,0,1 }); // Только нижняя граница
         headerLabel->getRenderer()->setBorderColor(tgui::Color::Black);
         headerLabel->setHorizontalAlignment(tgui::Label::HorizontalAlignment::Center);
         headerLabel->setVerticalAlignment(tgui::Label::VerticalAlignment::Center);
         m_tableHeaderGrid->addWidget(headerLabel, 0, i);
-        //     headerLabel,  
+        // Можно добавить отступы для headerLabel, если нужно
         // m_tableHeaderGrid->setWidgetPadding(0, i, {2,5,2,5}); // T,R,B,L
     }
     m_tableContainerPanel->add(m_tableHeaderGrid);
 
-    m_tableDataPanel = tgui::ScrollablePanel::create();
+    // Таблица виртуальная: меток ровно столько, сколько строк помещается на панели,
+    // при прокрутке в них подставляются значения нужных строк
+    m_tableDataPanel = tgui::Panel::create();
     if (!m_tableDataPanel) { std::cerr << "Error: Failed to create m_tableDataPanel" << std::endl; return; }
-    m_tableDataPanel->setSize({ "100%", "100% - " + tgui::String::fromNumber(TITLE_HEIGHT + HEADER_HEIGHT) });
+    m_tableDataPanel->setSize({ "100% - " + tgui::String::fromNumber(SCROLLBAR_WIDTH_ESTIMATE),
+        "100% - " + tgui::String::fromNumber(TITLE_HEIGHT + HEADER_HEIGHT) });
     m_tableDataPanel->setPosition({ 0, tgui::bindBottom(m_tableHeaderGrid) });
     m_tableDataPanel->getRenderer()->setBackgroundColor(tgui::Color(245, 245, 245));
     m_tableContainerPanel->add(m_tableDataPanel);
 
-    m_tableDataGrid = tgui::Grid::create();
-    if (!m_tableDataGrid) { std::cerr << "Error: Failed to create m_tableDataGrid for data" << std::endl; return; }
-    //    m_tableDataGrid   ScrollablePanel   
-    m_tableDataPanel->add(m_tableDataGrid);
+    m_tableScrollbar = tgui::Scrollbar::create();
+    if (!m_tableScrollbar) { std::cerr << "Error: Failed to create m_tableScrollbar" << std::endl; return; }
+    m_tableScrollbar->setSize({ SCROLLBAR_WIDTH_ESTIMATE, tgui::bindHeight(m_tableDataPanel) });
+    m_tableScrollbar->setPosition({ tgui::bindRight(m_tableDataPanel), tgui::bindTop(m_tableDataPanel) });
+    m_tableScrollbar->setScrollAmount(TABLE_WHEEL_ROWS);
+    m_tableContainerPanel->add(m_tableScrollbar);
+
+    m_tableEmptyLabel = tgui::Label::create(L"Нет данных для отображения");
+    if (!m_tableEmptyLabel) { std::cerr << "Error: Failed to create m_tableEmptyLabel" << std::endl; return; }
+    m_tableEmptyLabel->getRenderer()->setTextColor(tgui::Color::Black);
+    m_tableEmptyLabel->setHorizontalAlignment(tgui::Label::HorizontalAlignment::Center);
+    m_tableEmptyLabel->setSize({ "100%", TABLE_ROW_HEIGHT });
+    m_tableDataPanel->add(m_tableEmptyLabel);
 }
 
-// ---  ---
+void UserInterface::rebuildTableRowPool() {
+    if (!m_tableDataPanel) return;
+    const float panelHeight = m_tableDataPanel->getSize().y;
+    const size_t rowCount = static_cast<size_t>(std::max(0.f, panelHeight) / TABLE_ROW_HEIGHT) + 1;
+    if (rowCount == m_tableRowLabels.size()) return;
+
+    for (auto& row : m_tableRowLabels) {
+        for (auto& cell : row) m_tableDataPanel->remove(cell);
+    }
+    m_tableRowLabels.clear();
+    for (size_t i = 0; i < rowCount; ++i) {
+        std::array<tgui::Label::Ptr, TABLE_COLUMN_COUNT> row;
+        for (size_t j = 0; j < TABLE_COLUMN_COUNT; ++j) {
+            auto cellLabel = tgui::Label::create();
+            cellLabel->getRenderer()->setTextColor(tgui::Color::Black);
+            cellLabel->setHorizontalAlignment(tgui::Label::HorizontalAlignment::Center);
+            cellLabel->setSize({ tgui::bindWidth(m_tableDataPanel) / static_cast<float>(TABLE_COLUMN_COUNT), TABLE_ROW_HEIGHT });
+            cellLabel->setPosition({ tgui::bindWidth(m_tableDataPanel) * (static_cast<float>(j) / TABLE_COLUMN_COUNT),
+                static_cast<float>(i) * TABLE_ROW_HEIGHT });
+            m_tableDataPanel->add(cellLabel);
+            row[j] = cellLabel;
+        }
+        m_tableRowLabels.push_back(row);
+    }
+    if (m_tableScrollbar) m_tableScrollbar->setViewportSize(static_cast<unsigned int>(rowCount - 1));
+}
+
+// --- Компоновка ---
 void UserInterface::setupLayout() {
     std::cout << "DEBUG: Setting up layout..." << std::endl;
-    //  
-    m_leftPanel->setSize({ "30%", "100%" }); //    
+    // Левая панель
+    m_leftPanel->setSize({ "30%", "100%" }); // Немного шире для комфорта
     m_leftPanel->setPosition({ 0, 0 });
 
-    //  
+    // Правая панель
     m_rightPanel->setSize({ "70%", "100%" });
     m_rightPanel->setPosition({ "30%", 0 });
 
-    //    
+    // Контейнеры внутри правой панели
     const float rightPanelPadding = PANEL_PADDING;
     const float verticalSpacing = WIDGET_SPACING / 2.f;
 
@@ -244,20 +317,24 @@ void UserInterface::setupLayout() {
     std::cout << "DEBUG: Layout setup finished." << std::endl;
 }
 
-// ---   ---
+// --- Подключение сигналов ---
 void UserInterface::connectSignals() {
     if (m_calculateButton) {
-        //  .connect()  TGUI 0.9.x
+        // Используем .connect() для TGUI 0.9.x
         m_calculateButton->onPress.connect(&UserInterface::onCalculateButtonPressed, this);
     }
     else {
         std::cerr << "Error: m_calculateButton is null in connectSignals! Cannot connect." << std::endl;
     }
+    if (m_cancelButton) {
+        m_cancelButton->onPress.connect(&UserInterface::onCancelButtonPressed, this);
+    }
 }
 
-// ---    ---
+// --- Обработчики и логика ---
 void UserInterface::onCalculateButtonPressed() {
     std::cout << "Calculate button pressed!" << std::endl;
+    if (m_simulationTask) return; // Предыдущий расчет еще выполняется
     
     SimulationParameters paramsFromUI;
     
@@ -270,12 +347,12 @@ void UserInterface::onCalculateButtonPressed() {
         }
         if (m_edit_T && !m_edit_T->getText().empty()) {
             double total_time = std::stod(m_edit_T->getText().toStdString());
-            if (paramsFromUI.DT > 0.000001) { //         
+            if (paramsFromUI.DT > 0.000001) { // Защита от деления на очень малое число или ноль
                 paramsFromUI.STEPS = static_cast<int>(total_time / paramsFromUI.DT);
                 if (paramsFromUI.STEPS <= 0) paramsFromUI.STEPS = 1;
             }
             else {
-                paramsFromUI.STEPS = 1000; //   ,  DT 
+                paramsFromUI.STEPS = 1000; // Значение по умолчанию, если DT некорректен
                 std::cerr << "Warning: Invalid DT, using default STEPS." << std::endl;
             }
         }
@@ -284,139 +361,435 @@ void UserInterface::onCalculateButtonPressed() {
     }
     catch (const std::exception& e) {
         std::cerr << "Error parsing input values: " << e.what() << std::endl;
-        if (m_inputTitleLabel) m_inputTitleLabel->setText(L"  !");
-        m_trajectoryAvailable = false; m_calculatedStates.clear();
-        prepareTrajectoryForDisplay(); populateTable({});
+        if (m_inputTitleLabel) m_inputTitleLabel->setText(L"Ошибка ввода параметров!");
+        m_trajectoryAvailable = false; m_trajectory.clear(); m_tableRowCount = 0;
+        prepareTrajectoryForDisplay(); refreshTable();
         return;
     }
-    if (m_inputTitleLabel) m_inputTitleLabel->setText(L" ");
+    if (m_inputTitleLabel) m_inputTitleLabel->setText(L"Исходные значения");
 
-    Calculations calculator;
     std::cout << "DEBUG: Running simulation with STEPS=" << paramsFromUI.STEPS
         << ", DT=" << paramsFromUI.DT << std::endl;
+    startSimulation(paramsFromUI);
+}
+
+void UserInterface::onCancelButtonPressed() {
+    if (m_simulationTask) {
+        m_simulationTask->cancelRequested = true; // Интегратор остановится на следующем шаге
+    }
+}
 
-    m_calculatedStates = calculator.runSimulation(paramsFromUI);
-
-    m_currentTableData.clear();
-    if (!m_calculatedStates.empty()) {
-        m_trajectoryAvailable = true;
-        double currentTime = 0.0;
-        const size_t maxTableEntries = 2000;
-        size_t step = 1;
-        
-        if (m_calculatedStates.size() > maxTableEntries) {
-            step = m_calculatedStates.size() / maxTableEntries;
-            if (step == 0) step = 1; //  ,  calculatedStates.size() < maxTableEntries   0
+void UserInterface::startSimulation(const SimulationParameters& params) {
+    if (auto cached = m_resultCache.find(params, resultCacheVariant())) {
+        m_trajectory = ContinuousTrajectory(params, cached->trajectory);
+        m_trajectoryParams = params;
+        m_trajectorySummary = cached->summary;
+        showTrajectory(params.DT);
+        if (m_progressBar) m_progressBar->setText(L"100% (из кэша)");
+        return;
+    }
+    m_simulationTask = std::make_unique<SimulationTask>();
+    m_simulationTask->params = params;
+    // Изменилось только время расчета в большую сторону: считаются лишь новые шаги
+    if (m_trajectoryAvailable && Calculations::canContinue(m_trajectoryParams, m_trajectorySummary, params)) {
+        m_simulationTask->continuation = true;
+        m_simulationTask->previous = m_trajectorySummary;
+    }
+    m_liveDisplayPoints.clear();
+    m_liveReplacesTrajectory = !m_simulationTask->continuation;
+    if (m_simulationTask->continuation) {
+        // Линия предпросмотра начинается из последней точки прежней траектории
+        m_liveBounds = m_trajectoryLod.bounds();
+        if (!m_trajectoryDisplayPoints.empty()) m_liveDisplayPoints.push_back(m_trajectoryDisplayPoints.back());
+    }
+    setSimulationControlsRunning(true);
+    m_simulationThread = std::thread(&UserInterface::runSimulationTask, std::ref(*m_simulationTask));
+}
+
+void UserInterface::runSimulationTask(SimulationTask& task) {
+    ScopedTimer timer(ProfilePhase::Simulation);
+    const SimulationParameters& params = task.params;
+    const double startTime = task.continuation ? task.previous.finalTime : 0.0;
+    const double totalTime = params.STEPS * params.DT;
+
+    // Сохраняются только узлы непрерывной траектории, сразу в сжатом виде:
+    // не больше MAX_TRAJECTORY_NODES при любом числе шагов
+    StreamOptions options;
+    options.maxSamples = MAX_TRAJECTORY_NODES;
+
+    // Предпросмотр прорежен по времени сильнее узлов и публикуется пачками, чтобы интерфейс
+    // забирал их редкими операциями с буфером
+    const double previewInterval = (totalTime - startTime) / LIVE_PREVIEW_POINTS;
+    double nextPreviewTime = startTime;
+    std::array<sf::Vector2f, LIVE_PREVIEW_BATCH> previewBatch;
+    size_t previewCount = 0;
+    auto publishPreview = [&]() {
+        task.preview.push(previewBatch.data(), previewCount); // Не поместившиеся точки отбрасываются
+        previewCount = 0;
+    };
+
+    try {
+        Calculations calculator;
+        task.trajectory = ContinuousTrajectory(params);
+        StateSink sink = [&](long long, double t, const State& state) {
+            if (!task.trajectory.append(t, state)) {
+                // Узел не сохранен (значения не конечны): расчет останавливается с ошибкой
+                task.error = "trajectory node at t = " + std::to_string(t) + " cannot be stored";
+                return false;
+            }
+            if (t >= nextPreviewTime) {
+                previewBatch[previewCount++] = sf::Vector2f(static_cast<float>(state.x), static_cast<float>(state.y));
+                nextPreviewTime = t + previewInterval;
+                if (previewCount == previewBatch.size()) publishPreview();
+            }
+            if (totalTime > startTime) {
+                task.progress.store((t - startTime) / (totalTime - startTime), std::memory_order_relaxed);
+            }
+            return !task.cancelRequested.load(std::memory_order_relaxed);
+        };
+        SimulationSummary summary = task.continuation
+            ? calculator.continueSimulation(params, task.previous, sink, options)
+            : calculator.streamSimulation(params, sink, options);
+        publishPreview();
+        task.summary = summary;
+        task.cancelled = summary.cancelled;
+        if (summary.stepFailure) {
+            task.error = "adaptive step failed at t = " + std::to_string(summary.finalTime);
         }
+        task.trajectory.shrinkToFit();
+        Profiler::instance().addCount(ProfileCounter::IntegrationSteps,
+            summary.steps - (task.continuation ? task.previous.steps : 0));
+        Profiler::instance().addCount(ProfileCounter::TrajectoryNodes, static_cast<long long>(task.trajectory.nodeCount()));
+    }
+    catch (const std::exception& e) {
+        task.error = e.what();
+    }
+    task.finished.store(true, std::memory_order_release);
+}
+
+void UserInterface::updateSimulationProgress() {
+    if (!m_simulationTask) return;
+    if (m_simulationTask->finished.load(std::memory_order_acquire)) {
+        finishSimulation();
+        return;
+    }
+    consumeLivePreview();
+    double fraction = std::clamp(m_simulationTask->progress.load(std::memory_order_relaxed), 0.0, 1.0);
+    if (m_progressBar) {
+        m_progressBar->setValue(static_cast<unsigned int>(fraction * PROGRESS_BAR_RESOLUTION));
+        m_progressBar->setText(tgui::String::fromNumber(static_cast<int>(fraction * 100)) + "%");
+    }
+}
 
-        for (size_t i = 0; i < m_calculatedStates.size(); i += step) {
-            const auto& state = m_calculatedStates[i];
-            m_currentTableData.push_back({
-                static_cast<float>(i * paramsFromUI.DT), //   
-                static_cast<float>(state.x), static_cast<float>(state.y),
-                static_cast<float>(state.vx), static_cast<float>(state.vy)
-                });
+void UserInterface::consumeLivePreview() {
+    std::array<sf::Vector2f, 1024> points;
+    size_t added = 0;
+    while (size_t count = m_simulationTask->preview.pop(points.data(), points.size())) {
+        for (size_t i = 0; i < count; ++i) {
+            const double x = points[i].x;
+            const double y = points[i].y;
+            if (m_liveReplacesTrajectory && m_liveDisplayPoints.empty()) {
+                m_liveBounds = { x, x, y, y };
+            }
+            else {
+                m_liveBounds.minX = std::min(m_liveBounds.minX, x);
+                m_liveBounds.maxX = std::max(m_liveBounds.maxX, x);
+                m_liveBounds.minY = std::min(m_liveBounds.minY, y);
+                m_liveBounds.maxY = std::max(m_liveBounds.maxY, y);
+            }
+            m_liveDisplayPoints.emplace_back(sf::Vector2f(points[i].x, -points[i].y), sf::Color::Blue); // Y инвертируется
         }
+        added += count;
     }
-    else {
-        m_trajectoryAvailable = false;
+    if (added == 0) return;
+    Profiler::instance().addCount(ProfileCounter::VerticesPrepared, static_cast<long long>(added));
+    setTrajectoryViewRect(m_liveBounds);
+    m_canvasDirty = true;
+}
+
+void UserInterface::clearLivePreview() {
+    if (m_liveDisplayPoints.empty() && !m_liveReplacesTrajectory) return;
+    m_liveDisplayPoints.clear();
+    m_liveReplacesTrajectory = false;
+    updateTrajectoryViewRect();
+    m_canvasDirty = true;
+}
+
+void UserInterface::finishSimulation() {
+    if (m_simulationThread.joinable()) m_simulationThread.join();
+    std::unique_ptr<SimulationTask> task = std::move(m_simulationTask);
+    setSimulationControlsRunning(false);
+    clearLivePreview();
+    if (!task) return;
+
+    if (!task->error.empty()) {
+        std::cerr << "Error during simulation: " << task->error << std::endl;
+        if (m_progressBar) m_progressBar->setText(L"Ошибка расчета");
+        return;
+    }
+    if (task->cancelled) {
+        // Прежняя траектория и таблица остаются на экране
+        if (m_progressBar) m_progressBar->setText(L"Расчет отменен");
+        return;
+    }
+
+    if (task->continuation) {
+        // Новые узлы дописываются в конец сжатой траектории, прежние не копируются
+        const size_t previousNodeCount = m_trajectory.nodeCount();
+        bool stored = true;
+        task->trajectory.nodes().forEach(0, task->trajectory.nodeCount(), [this, &stored](size_t, double t, const State& state) {
+            stored = stored && m_trajectory.append(t, state);
+        });
+        if (!stored) {
+            // Узел продолжения не сохранен (сообщение выводит append): продолжение отбрасывается, траектория
+            // возвращается к прежним узлам, а параметры, итоги, отрисовка и таблица остаются прежними
+            CompressedTrajectory previousNodes(m_trajectory.nodes().tolerance());
+            m_trajectory.nodes().forEach(0, previousNodeCount, [&previousNodes](size_t, double t, const State& state) {
+                previousNodes.append(t, state); // Значения уже прошли квантование и повторно не меняются
+            });
+            m_trajectory = ContinuousTrajectory(m_trajectoryParams, std::move(previousNodes));
+            std::cerr << "Error during simulation: continuation nodes cannot be appended to the trajectory" << std::endl;
+            if (m_progressBar) m_progressBar->setText(L"Ошибка расчета");
+            return;
+        }
+        m_trajectoryParams = task->params;
+        m_trajectorySummary = task->summary;
+        // Новые узлы прорежены по новому горизонту, прежние - по старому, поэтому после нескольких
+        // продолжений узлов становится больше предела. Тогда траектория прореживается по времени до
+        // половины предела: следующие продолжения снова только дописывают узлы.
+        // Набор узлов продолжения не совпадает с набором расчета с начала, поэтому в кэш результатов
+        // (вариант resultCacheVariant) он не попадает
+        if (m_trajectory.nodeCount() > static_cast<size_t>(MAX_TRAJECTORY_NODES)) {
+            m_trajectory = m_trajectory.decimated(static_cast<size_t>(MAX_TRAJECTORY_NODES / 2));
+            showTrajectory(task->params.DT);
+            return;
+        }
+        extendTrajectoryDisplay();
+        return;
     }
 
-    prepareTrajectoryForDisplay(); //     View  
-    populateTable(m_currentTableData);
+    m_trajectoryParams = task->params;
+    m_trajectorySummary = task->summary;
+    // Поток завершен, поэтому траектория передается перемещением, без копирования
+    m_trajectory = std::move(task->trajectory);
+    if (!m_trajectory.empty()) {
+        m_resultCache.store(task->params, resultCacheVariant(), { task->summary, m_trajectory.nodes() });
+    }
+    showTrajectory(task->params.DT);
+}
+
+std::string UserInterface::resultCacheVariant() {
+    return "nodes=" + std::to_string(MAX_TRAJECTORY_NODES);
+}
+
+void UserInterface::showTrajectory(double tableTimeStep) {
+    m_trajectoryAvailable = !m_trajectory.empty();
+    m_tableTimeStep = tableTimeStep;
+    updateTableRowCount();
+    if (m_progressBar) {
+        m_progressBar->setValue(PROGRESS_BAR_RESOLUTION);
+        m_progressBar->setText("100%");
+    }
+
+    prepareTrajectoryForDisplay(); // Подготовка вершин и настройка View для канваса
+    refreshTable();
+}
+
+void UserInterface::extendTrajectoryDisplay() {
+    updateTableRowCount();
+    if (m_progressBar) {
+        m_progressBar->setValue(PROGRESS_BAR_RESOLUTION);
+        m_progressBar->setText("100%");
+    }
+
+    {
+        ScopedTimer timer(ProfilePhase::LodBuild);
+        const CompressedTrajectory& nodes = m_trajectory.nodes();
+        m_trajectoryLod.append(nodes.size(), [&nodes](size_t i) {
+            const State node = nodes.state(i);
+            return WorldTrajectoryPoint(node.x, node.y);
+        });
+    }
+    updateTrajectoryViewRect();
+    // Точки уровней до продолжения не изменились; если при новом масштабе подойдет другой уровень,
+    // selectDisplayLevel перестроит вершины при отрисовке
+    if (m_displayLodLevel != NO_LOD_LEVEL) appendDisplayVertices();
+    m_canvasDirty = true;
+
+    // Прокрутка таблицы сохраняется, меняется только число строк
+    if (m_tableScrollbar) {
+        if (m_tableEmptyLabel) m_tableEmptyLabel->setVisible(m_tableRowCount == 0);
+        m_tableScrollbar->setMaximum(static_cast<unsigned int>(
+            std::min<size_t>(m_tableRowCount, std::numeric_limits<unsigned int>::max())));
+        m_tableFirstRow = TABLE_NO_ROW;
+        updateVisibleTableRows();
+    }
+}
+
+void UserInterface::updateTableRowCount() {
+    // Строки таблицы - через DT расчета (и последняя - в конце траектории) независимо от прореживания узлов
+    m_tableRowCount = 0;
+    if (m_trajectoryAvailable) {
+        const double span = m_trajectory.endTime() - m_trajectory.startTime();
+        m_tableRowCount = (m_tableTimeStep > 0.0 && span > 0.0)
+            ? static_cast<size_t>(std::ceil(span / m_tableTimeStep - 1e-9)) + 1 : 1;
+    }
+}
+
+void UserInterface::stopSimulation() {
+    if (m_simulationTask) m_simulationTask->cancelRequested = true;
+    if (m_simulationThread.joinable()) m_simulationThread.join();
+    m_simulationTask.reset();
+}
+
+void UserInterface::setSimulationControlsRunning(bool running) {
+    if (m_calculateButton) m_calculateButton->setEnabled(!running);
+    if (m_cancelButton) m_cancelButton->setEnabled(running);
+    if (running && m_progressBar) {
+        m_progressBar->setValue(0);
+        m_progressBar->setText("0%");
+    }
 }
 
 void UserInterface::prepareTrajectoryForDisplay() {
+    m_canvasDirty = true;
     m_trajectoryDisplayPoints.clear();
-    if (!m_trajectoryAvailable || m_calculatedStates.empty()) {
+    m_trajectoryLod.clear();
+    m_displayLodLevel = NO_LOD_LEVEL;
+    if (!m_trajectoryAvailable || m_trajectory.empty()) {
         std::cout << "DEBUG: No trajectory to prepare for display." << std::endl;
-        //   clear,    render    
-        //   placeholder  ,  m_trajectoryAvailable == false
+        // Важно вызвать clear, чтобы при следующем render не рисовалась старая траектория
+        // и чтобы placeholder текст показался, если m_trajectoryAvailable == false
         return;
     }
 
-    m_trajectoryDisplayPoints.reserve(m_calculatedStates.size());
-    for (const auto& state : m_calculatedStates) {
-        m_trajectoryDisplayPoints.emplace_back(
-            sf::Vector2f(static_cast<float>(state.x), static_cast<float>(-state.y)), // Y   
-            sf::Color::Blue //   
-        );
-    }
-    std::cout << "DEBUG: Trajectory display points prepared. Count: " << m_trajectoryDisplayPoints.size() << std::endl;
+    // Вершины строятся при отрисовке из уровня детализации, подходящего к размеру канваса
+    // Узлы читаются по порядку, поэтому каждый сжатый блок распаковывается один раз
+    ScopedTimer timer(ProfilePhase::LodBuild);
+    const CompressedTrajectory& nodes = m_trajectory.nodes();
+    m_trajectoryLod.build(nodes.size(), [&nodes](size_t i) {
+        const State node = nodes.state(i);
+        return WorldTrajectoryPoint(node.x, node.y);
+    });
+    updateTrajectoryViewRect();
 }
 
-void UserInterface::drawTrajectoryOnCanvas(sf::RenderTarget& canvasRenderTarget) {
-    sf::View trajectoryView;
-
-    if (m_trajectoryAvailable && !m_trajectoryDisplayPoints.empty()) {
-        float min_x = m_trajectoryDisplayPoints[0].position.x;
-        float max_x = m_trajectoryDisplayPoints[0].position.x;
-        float min_y = m_trajectoryDisplayPoints[0].position.y; //  -state.y
-        float max_y = m_trajectoryDisplayPoints[0].position.y; //  -state.y
-
-        for (const auto& vertex : m_trajectoryDisplayPoints) {
-            min_x = std::min(min_x, vertex.position.x);
-            max_x = std::max(max_x, vertex.position.x);
-            min_y = std::min(min_y, vertex.position.y);
-            max_y = std::max(max_y, vertex.position.y);
-        }
-
-        //    (0,0)   ,    
-        min_x = std::min(min_x, 0.0f);
-        max_x = std::max(max_x, 0.0f);
-        min_y = std::min(min_y, 0.0f); //  0,  0 (  Y)
-        max_y = std::max(max_y, 0.0f);
+void UserInterface::updateTrajectoryViewRect() {
+    // Границы траектории вычислены при построении уровней детализации
+    if (m_trajectoryLod.empty()) return;
+    setTrajectoryViewRect(m_trajectoryLod.bounds());
+}
 
+void UserInterface::setTrajectoryViewRect(const TrajectoryLod::Bounds& bounds) {
+    float min_x = static_cast<float>(bounds.minX);
+    float max_x = static_cast<float>(bounds.maxX);
+    float min_y = static_cast<float>(-bounds.maxY); // Y инвертирован
+    float max_y = static_cast<float>(-bounds.minY);
+
+    // Добавляем центральное тело (0,0) в расчет границ, если оно не попало
+    min_x = std::min(min_x, 0.0f);
+    max_x = std::max(max_x, 0.0f);
+    min_y = std::min(min_y, 0.0f); // Мировое 0, экранное 0 (после инверсии Y)
+    max_y = std::max(max_y, 0.0f);
+
+    float worldWidth = max_x - min_x;
+    float worldHeight = max_y - min_y;
+
+    // Добавляем отступы, чтобы траектория не прилипала к краям
+    float paddingFactor = 0.1f; // 10% отступ
+    float paddingX = (worldWidth == 0) ? 1.0f : worldWidth * paddingFactor;
+    float paddingY = (worldHeight == 0) ? 1.0f : worldHeight * paddingFactor;
+    if (worldWidth == 0 && worldHeight == 0) { // Если всего одна точка
+        paddingX = 1.0f; paddingY = 1.0f; // Даем какой-то размер области
+    }
 
-        float worldWidth = max_x - min_x;
-        float worldHeight = max_y - min_y;
+    m_trajectoryViewRect = sf::FloatRect(min_x - paddingX,
+        min_y - paddingY,
+        worldWidth + 2 * paddingX,
+        worldHeight + 2 * paddingY);
+}
 
-        //  ,      
-        float paddingFactor = 0.1f; // 10% 
-        float paddingX = (worldWidth == 0) ? 1.0f : worldWidth * paddingFactor;
-        float paddingY = (worldHeight == 0) ? 1.0f : worldHeight * paddingFactor;
-        if (worldWidth == 0 && worldHeight == 0) { //    
-            paddingX = 1.0f; paddingY = 1.0f; //  -  
-        }
+void UserInterface::selectDisplayLevel(double pixelsPerUnit) {
+    int level = m_trajectoryLod.selectLevel(pixelsPerUnit);
+    if (level == m_displayLodLevel) return;
+    m_displayLodLevel = level;
+    m_trajectoryDisplayPoints.clear();
+    appendDisplayVertices();
+}
 
+void UserInterface::appendDisplayVertices() {
+    ScopedTimer timer(ProfilePhase::VertexPreparation);
+    const size_t first = m_trajectoryDisplayPoints.size();
+    auto addVertex = [this](double x, double y) {
+        m_trajectoryDisplayPoints.emplace_back(
+            sf::Vector2f(static_cast<float>(x), static_cast<float>(-y)), // Y инвертируется для отображения
+            sf::Color::Blue // Цвет линии траектории
+        );
+    };
+    if (m_displayLodLevel < 0) {
+        m_trajectoryDisplayPoints.reserve(m_trajectory.nodeCount());
+        m_trajectory.nodes().forEach(first, m_trajectory.nodeCount(), [&](size_t, double, const State& state) {
+            addVertex(state.x, state.y);
+        });
+    }
+    else {
+        const TrajectoryLod::Level& lodLevel = m_trajectoryLod.level(static_cast<size_t>(m_displayLodLevel));
+        m_trajectoryDisplayPoints.reserve(lodLevel.points.size());
+        for (size_t i = first; i < lodLevel.points.size(); ++i) addVertex(lodLevel.points[i].first, lodLevel.points[i].second);
+    }
+    Profiler::instance().addCount(ProfileCounter::VerticesPrepared,
+        static_cast<long long>(m_trajectoryDisplayPoints.size() - first));
+}
 
-        sf::FloatRect viewRect(min_x - paddingX,
-            min_y - paddingY,
-            worldWidth + 2 * paddingX,
-            worldHeight + 2 * paddingY);
+void UserInterface::drawTrajectoryOnCanvas(sf::RenderTarget& canvasRenderTarget) {
+    sf::View trajectoryView;
 
-        trajectoryView.reset(viewRect); //  View    
+    // Во время расчета нового варианта прежняя траектория скрыта, рисуется только предпросмотр
+    const bool showLive = !m_liveDisplayPoints.empty();
+    const bool showStored = m_trajectoryAvailable && !m_trajectoryLod.empty() && !(showLive && m_liveReplacesTrajectory);
+    if (showStored || showLive) {
+        const sf::FloatRect& viewRect = m_trajectoryViewRect; // Вычислен один раз при смене траектории
+        trajectoryView.reset(viewRect); // Устанавливаем View на основе рассчитанного прямоугольника
         canvasRenderTarget.setView(trajectoryView);
 
-        float centralBodyViewRadius = std::min(viewRect.width, viewRect.height) * 0.01f; // 1%    View
-        if (centralBodyViewRadius < 0.001f) centralBodyViewRadius = 0.001f; //  
+        // View растягивается по осям независимо, поэтому берется больший из масштабов
+        const sf::Vector2u canvasSize = canvasRenderTarget.getSize();
+        double pixelsPerUnit = std::max(canvasSize.x / static_cast<double>(viewRect.width),
+            canvasSize.y / static_cast<double>(viewRect.height));
+        if (showStored) selectDisplayLevel(pixelsPerUnit);
+
+        float centralBodyViewRadius = std::min(viewRect.width, viewRect.height) * 0.01f; // 1% от меньшей стороны View
+        if (centralBodyViewRadius < 0.001f) centralBodyViewRadius = 0.001f; // Минимальный радиус
 
         sf::CircleShape centerBody(centralBodyViewRadius);
         centerBody.setFillColor(sf::Color::Red);
         centerBody.setOrigin(centralBodyViewRadius, centralBodyViewRadius);
-        centerBody.setPosition(0.f, 0.f); //   (0,0)
+        centerBody.setPosition(0.f, 0.f); // Мировые координаты (0,0)
         canvasRenderTarget.draw(centerBody);
 
-        //  
-        if (m_trajectoryDisplayPoints.size() >= 1) {
+        // Рисуем траекторию
+        if (showStored && m_trajectoryDisplayPoints.size() >= 1) {
             canvasRenderTarget.draw(m_trajectoryDisplayPoints.data(), m_trajectoryDisplayPoints.size(), sf::LineStrip);
         }
+        if (showLive) {
+            canvasRenderTarget.draw(m_liveDisplayPoints.data(), m_liveDisplayPoints.size(), sf::LineStrip);
+        }
 
     }
     else {
-        //   ,      -
+        // Если нет траектории, используем стандартный вид канваса для текста-заглушки
         canvasRenderTarget.setView(canvasRenderTarget.getDefaultView());
         sf::Text placeholderText;
-        if (m_sfmlFont.hasGlyph(L'')) { // ,      
+        if (m_sfmlFont.hasGlyph(L'Т')) { // Проверка, что шрифт загружен и имеет кириллицу
             placeholderText.setFont(m_sfmlFont);
-            placeholderText.setString(L"  .\n ' !'");
+            placeholderText.setString(L"Траектория не рассчитана.\nНажмите 'Рассчитать траекторию!'");
         }
         else {
             placeholderText.setString("Trajectory not calculated.\nPress 'Calculate Trajectory!'");
-            if (!m_sfmlFont.getInfo().family.empty()) //    ,   
+            if (!m_sfmlFont.getInfo().family.empty()) // Если шрифт был загружен, но не тот
                 std::cerr << "Warning: SFML font loaded but might not support Cyrillic for placeholder.\n";
         }
-        placeholderText.setCharacterSize(16); //     DefaultView
+        placeholderText.setCharacterSize(16); // Размер в пикселях для DefaultView
         placeholderText.setFillColor(sf::Color(105, 105, 105)); // DimGray
         sf::FloatRect textRect = placeholderText.getLocalBounds();
         placeholderText.setOrigin(textRect.left + textRect.width / 2.0f, textRect.top + textRect.height / 2.0f);
@@ -427,58 +800,67 @@ void UserInterface::drawTrajectoryOnCanvas(sf::RenderTarget& canvasRenderTarget)
     canvasRenderTarget.setView(canvasRenderTarget.getDefaultView());
 }
 
-void UserInterface::populateTable(const std::vector<TableRowData>& data) {
-    if (!m_tableDataGrid) { std::cerr << "Error: m_tableDataGrid is null in populateTable!" << std::endl; return; }
-    m_tableDataGrid->removeAllWidgets();
+void UserInterface::refreshTable() {
+    if (!m_tableScrollbar) { std::cerr << "Error: m_tableScrollbar is null in refreshTable!" << std::endl; return; }
+    rebuildTableRowPool();
+    const size_t rowCount = m_tableRowCount;
+    if (m_tableEmptyLabel) m_tableEmptyLabel->setVisible(rowCount == 0);
+    m_tableScrollbar->setMaximum(static_cast<unsigned int>(std::min<size_t>(rowCount, std::numeric_limits<unsigned int>::max())));
+    m_tableScrollbar->setValue(0);
+    m_tableFirstRow = TABLE_NO_ROW; // Заставить updateVisibleTableRows перерисовать строки
+    updateVisibleTableRows();
+}
 
-    if (data.empty()) {
-        auto emptyLabel = tgui::Label::create(L"   ");
-        if (emptyLabel) {
-            emptyLabel->setHorizontalAlignment(tgui::Label::HorizontalAlignment::Center);
-            m_tableDataGrid->addWidget(emptyLabel, 0, 0);
-            //  emptyLabel   5 ,  API Grid   colspan:
-            // for (unsigned int j = 1; j < 5; ++j) {
-            //     m_tableDataGrid->addWidget(tgui::Label::create(""), 0, j); //  
-            // }
+void UserInterface::updateVisibleTableRows() {
+    if (!m_tableScrollbar) return;
+    rebuildTableRowPool(); // Высота панели могла измениться
+    const size_t firstRow = m_tableScrollbar->getValue();
+    if (firstRow == m_tableFirstRow && m_tableRowLabels.size() == m_tableVisibleRows) return;
+    m_tableFirstRow = firstRow;
+    m_tableVisibleRows = m_tableRowLabels.size();
+    ScopedTimer timer(ProfilePhase::TableUpdate);
+
+    // Форматируются только видимые строки, поэтому размер таблицы не влияет на скорость прокрутки
+    // Состояния строк берутся из непрерывной траектории, O(log N) на строку
+    const size_t rowCount = m_tableRowCount;
+    for (size_t i = 0; i < m_tableRowLabels.size(); ++i) {
+        const size_t row = firstRow + i;
+        auto& labels = m_tableRowLabels[i];
+        if (row >= rowCount) {
+            for (auto& cell : labels) cell->setText("");
+            continue;
         }
-        if (m_tableDataPanel) m_tableDataPanel->setContentSize({ 0,0 });
-        return;
+        const double time = (row + 1 == rowCount)
+            ? m_trajectory.endTime() : m_trajectory.startTime() + static_cast<double>(row) * m_tableTimeStep;
+        const State state = m_trajectory.stateAt(time);
+        Profiler::instance().addCount(ProfileCounter::TableRowsFormatted);
+        labels[0]->setText(formatTableValue(time));
+        labels[1]->setText(formatTableValue(state.x));
+        labels[2]->setText(formatTableValue(state.y));
+        labels[3]->setText(formatTableValue(state.vx));
+        labels[4]->setText(formatTableValue(state.vy));
     }
+}
 
-    for (size_t i = 0; i < data.size(); ++i) {
-        const auto& rowData = data[i];
-        std::stringstream ss_h, ss_x, ss_y, ss_vx, ss_vy;
-        ss_h << std::fixed << std::setprecision(2) << rowData.h_sec;
-        ss_x << std::fixed << std::setprecision(2) << rowData.x;
-        ss_y << std::fixed << std::setprecision(2) << rowData.y;
-        ss_vx << std::fixed << std::setprecision(2) << rowData.Vx;
-        ss_vy << std::fixed << std::setprecision(2) << rowData.Vy;
-        std::vector<tgui::String> rowStrings = {
-            tgui::String(ss_h.str()), tgui::String(ss_x.str()), tgui::String(ss_y.str()),
-            tgui::String(ss_vx.str()), tgui::String(ss_vy.str()) };
-
-        for (size_t j = 0; j < rowStrings.size(); ++j) {
-            auto cellLabel = tgui::Label::create(rowStrings[j]);
-            if (cellLabel) {
-                cellLabel->getRenderer()->setTextColor(tgui::Color::Black);
-                cellLabel->setHorizontalAlignment(tgui::Label::HorizontalAlignment::Center);
-                m_tableDataGrid->addWidget(cellLabel, i, j);
-                m_tableDataGrid->setWidgetPadding(i, j, { 2, 5, 2, 5 });
-            }
-        }
-    }
-    if (m_tableDataPanel && m_tableDataGrid) {
-        m_tableDataPanel->setContentSize(m_tableDataGrid->getSize());
+tgui::String UserInterface::formatTableValue(double value) {
+    char buffer[64];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 2);
+    if (result.ec != std::errc()) {
+        result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
     }
+    return tgui::String(std::string(buffer, result.ptr));
 }
 
-// ---      ---
+// --- Главный цикл и обработка событий ---
 void UserInterface::run() {
-    m_window.setFramerateLimit(60); //  FPS     
+    m_window.setFramerateLimit(60); // Ограничение FPS для плавности и снижения нагрузки
+    sf::Clock frameClock;
     while (m_window.isOpen()) {
         handleEvents();
         update();
         render();
+        // Длительность кадра вместе с ожиданием ограничителя FPS
+        Profiler::instance().recordFrame(frameClock.restart().asSeconds());
     }
 }
 
@@ -489,21 +871,74 @@ void UserInterface::handleEvents() {
         if (event.type == sf::Event::Closed) {
             m_window.close();
         }
+        if (event.type == sf::Event::KeyPressed) {
+            if (event.key.code == sf::Keyboard::F3) toggleProfiler();
+            if (event.key.code == sf::Keyboard::F4) {
+                // Выгрузка накопленных замеров
+                if (Profiler::instance().writeJson(PROFILE_JSON_FILENAME)) {
+                    std::cout << "Замеры записаны в " << PROFILE_JSON_FILENAME << std::endl;
+                }
+            }
+        }
+        // Колесо мыши над строками таблицы прокручивает ее, как и над полосой прокрутки
+        if (event.type == sf::Event::MouseWheelScrolled && m_tableDataPanel && m_tableScrollbar
+            && event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+            const tgui::Vector2f position = m_tableDataPanel->getAbsolutePosition();
+            const tgui::Vector2f size = m_tableDataPanel->getSize();
+            const float mouseX = static_cast<float>(event.mouseWheelScroll.x);
+            const float mouseY = static_cast<float>(event.mouseWheelScroll.y);
+            if (mouseX >= position.x && mouseX < position.x + size.x && mouseY >= position.y && mouseY < position.y + size.y) {
+                const long long step = static_cast<long long>(event.mouseWheelScroll.delta * TABLE_WHEEL_ROWS);
+                const long long value = std::max(0LL, static_cast<long long>(m_tableScrollbar->getValue()) - step);
+                m_tableScrollbar->setValue(static_cast<unsigned int>(value));
+            }
+        }
     }
 }
 
 void UserInterface::update() {
-    // ,     ,     
+    // Например, анимация или другие обновления состояния, не связанные с вводом пользователя
+    updateSimulationProgress();
+    updateVisibleTableRows();
+    updateProfilerOverlay();
+}
+
+void UserInterface::toggleProfiler() {
+    Profiler& profiler = Profiler::instance();
+    profiler.setEnabled(!profiler.isEnabled());
+    if (m_profilerLabel) m_profilerLabel->setVisible(profiler.isEnabled());
+    m_profilerOverlayClock.restart();
+    updateProfilerOverlay();
+}
+
+void UserInterface::updateProfilerOverlay() {
+    if (!m_profilerLabel || !Profiler::instance().isEnabled()) return;
+    // Текст метки меняется несколько раз в секунду, а не каждый кадр: его раскладка тоже стоит времени
+    if (m_profilerOverlayClock.getElapsedTime().asSeconds() < PROFILER_OVERLAY_REFRESH_SECONDS
+        && !m_profilerLabel->getText().empty()) return;
+    m_profilerOverlayClock.restart();
+    m_profilerLabel->setText(Profiler::instance().overlayText() + "F3 - hide, F4 - save " + PROFILE_JSON_FILENAME);
 }
 
 void UserInterface::render() {
     if (m_trajectoryCanvas) {
+        // Канвас перерисовывается только при смене траектории или размера, иначе показывается
+        // содержимое текстуры с прошлого кадра
         sf::RenderTexture& canvasRT = m_trajectoryCanvas->getRenderTexture();
-        canvasRT.clear(sf::Color(250, 250, 250)); //  
-        drawTrajectoryOnCanvas(canvasRT);      //        View
-        m_trajectoryCanvas->display();
+        if (m_canvasDirty || canvasRT.getSize() != m_lastCanvasSize) {
+            ScopedTimer timer(ProfilePhase::CanvasDraw);
+            Profiler::instance().addCount(ProfileCounter::CanvasRedraws);
+            canvasRT.clear(sf::Color(250, 250, 250)); // Фон канваса
+            drawTrajectoryOnCanvas(canvasRT);      // Этот метод теперь сам устанавливает и сбрасывает View
+            m_trajectoryCanvas->display();
+            m_lastCanvasSize = canvasRT.getSize();
+            m_canvasDirty = false;
+        }
     }
     m_window.clear(sf::Color(220, 220, 220));
-    m_gui.draw();
-    m_window.display();
+    {
+        ScopedTimer timer(ProfilePhase::GuiDraw);
+        m_gui.draw();
+    }
+    m_window.display(); // Здесь же ожидание ограничителя FPS, поэтому в замер отрисовки не входит
 }
\ No newline at end of file
@@ -5,32 +5,79 @@
 
 #include <SFML/Graphics.hpp>
 #include <TGUI/TGUI.hpp>
-#include "Calculations.h" //  Calculations.h    State
+#include "Calculations.h" // Включаем Calculations.h для доступа к State
+#include "ContinuousTrajectory.h"
+#include "Profiler.h"
+#include "SimulationCache.h"
+#include "SpscRingBuffer.h"
+#include "TrajectoryLod.h"
 
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <string>
 #include <iomanip>
 #include <sstream>
 
-struct TableRowData {
-    float h_sec;
-    float x, y;
-    float Vx, Vy;
+// Расчет траектории в фоновом потоке. Пока finished == false, trajectory и error
+// принадлежат рабочему потоку; интерфейс забирает их только после завершения потока.
+// При продолжении (continuation) расчет начинается с конца previous, и trajectory содержит
+// только новые узлы
+struct SimulationTask {
+    static constexpr size_t PREVIEW_CAPACITY = 1 << 16;
+
+    SimulationParameters params;
+    bool continuation = false;
+    SimulationSummary previous;
+    std::atomic<double> progress{ 0.0 };       // Доля выполненного расчета, 0..1
+    std::atomic<bool> cancelRequested{ false };
+    std::atomic<bool> finished{ false };
+    // Точки для показа траектории по ходу расчета (мировые координаты): рабочий поток дописывает их
+    // пачками, интерфейс забирает каждый кадр. Если интерфейс не успевает, лишние точки отбрасываются -
+    // после завершения канвас все равно строится из всех узлов trajectory
+    SpscRingBuffer<sf::Vector2f> preview{ PREVIEW_CAPACITY };
+    ContinuousTrajectory trajectory;
+    SimulationSummary summary;
+    bool cancelled = false;
+    std::string error;
 };
 
 class UserInterface {
 public:
     UserInterface();
+    ~UserInterface();
     void run();
 
+    // Каталог для сохранения результатов расчета между запусками (пусто - только в памяти)
+    bool setResultCacheDirectory(const std::string& directory) { return m_resultCache.setDirectory(directory); }
+
 private:
     static constexpr float INPUT_FIELD_WIDTH = 180.f;
     static constexpr float INPUT_ROW_HEIGHT = 30.f;
     static constexpr float PANEL_PADDING = 10.f;
     static constexpr float WIDGET_SPACING = 10.f;
     static constexpr float HEADER_HEIGHT = 30.f;
-    static constexpr float TITLE_HEIGHT = 30.f; //     
+    static constexpr float TITLE_HEIGHT = 30.f; // Увеличил для лучшей читаемости заголовков
     static constexpr float SCROLLBAR_WIDTH_ESTIMATE = 18.f;
+    static constexpr unsigned int PROGRESS_BAR_RESOLUTION = 1000; // Делений индикатора выполнения
+    static constexpr int NO_LOD_LEVEL = -2; // Вершины для канваса еще не построены
+    static constexpr size_t TABLE_COLUMN_COUNT = 5;
+    static constexpr float PROFILER_OVERLAY_REFRESH_SECONDS = 0.25f; // Период обновления панели замеров
+    static constexpr const char* PROFILE_JSON_FILENAME = "profile.json";
+    // Наибольшее число хранимых узлов траектории: при большем числе шагов узлы прореживаются,
+    // а таблица и канвас получают промежуточные состояния интерполяцией. Узлы хранятся сжатыми
+    // (около 5 байт на узел при постоянном шаге), поэтому предел ограничивает в основном вершины канваса
+    static constexpr long long MAX_TRAJECTORY_NODES = 1 << 21;
+    // Точек предпросмотра на весь идущий расчет (прореживание по времени) и размер пачки,
+    // которой рабочий поток их публикует
+    static constexpr long long LIVE_PREVIEW_POINTS = 1 << 16;
+    static constexpr size_t LIVE_PREVIEW_BATCH = 64;
+    static constexpr float TABLE_ROW_HEIGHT = 24.f;
+    static constexpr unsigned int TABLE_WHEEL_ROWS = 3; // Строк за один шаг колеса мыши
+    static constexpr size_t TABLE_NO_ROW = std::numeric_limits<size_t>::max();
 
     void initializeGui();
     void loadWidgets();
@@ -44,9 +91,33 @@ private:
     void update();
     void render();
     void onCalculateButtonPressed();
-    void populateTable(const std::vector<TableRowData>& data);
-    void drawTrajectoryOnCanvas(sf::RenderTarget& target_rt); //   
+    void onCancelButtonPressed();
+    void startSimulation(const SimulationParameters& params);
+    static void runSimulationTask(SimulationTask& task); // Выполняется в рабочем потоке
+    void updateSimulationProgress();
+    void consumeLivePreview();  // Дописать на канвас точки, опубликованные рабочим потоком с прошлого кадра
+    void clearLivePreview();    // Расчет завершен: предпросмотр заменяется траекторией (или прежней, при отмене)
+    void finishSimulation();
+    void showTrajectory(double tableTimeStep); // Новая m_trajectory: таблица и канвас
+    // m_trajectory продолжилась новыми узлами: уровни детализации, вершины и строки таблицы
+    // дополняются, уже построенное не пересчитывается
+    void extendTrajectoryDisplay();
+    void updateTableRowCount();
+    static std::string resultCacheVariant();   // Вид результата интерфейса в кэше: узлы с прореживанием до MAX_TRAJECTORY_NODES
+    void stopSimulation(); // Отменить расчет и дождаться потока
+    void setSimulationControlsRunning(bool running);
+    void refreshTable();            // Новые данные: прокрутка в начало и перерисовка видимых строк
+    void rebuildTableRowPool();     // Создать метки под число строк, помещающихся на панели
+    void updateVisibleTableRows();  // Подставить в метки значения строк, видимых при текущей прокрутке
+    static tgui::String formatTableValue(double value);
+    void drawTrajectoryOnCanvas(sf::RenderTarget& target_rt); // Изменено имя аргумента
     void prepareTrajectoryForDisplay();
+    void updateTrajectoryViewRect(); // Область мира, показываемая на канвасе, по границам траектории
+    void setTrajectoryViewRect(const TrajectoryLod::Bounds& bounds);
+    void selectDisplayLevel(double pixelsPerUnit); // Перестроить вершины, если сменился уровень детализации
+    void appendDisplayVertices(); // Дописать вершины уровня m_displayLodLevel, которых еще нет в m_trajectoryDisplayPoints
+    void toggleProfiler();          // F3: включить замеры и показать их поверх канваса (или выключить)
+    void updateProfilerOverlay();
 
     sf::RenderWindow m_window;
     tgui::Gui m_gui;
@@ -59,6 +130,8 @@ private:
     tgui::EditBox::Ptr m_edit_k;
     tgui::EditBox::Ptr m_edit_F;
     tgui::Button::Ptr m_calculateButton;
+    tgui::Button::Ptr m_cancelButton;
+    tgui::ProgressBar::Ptr m_progressBar;
     tgui::Grid::Ptr m_inputControlsGrid;
 
     tgui::Panel::Ptr m_leftPanel;
@@ -73,12 +146,37 @@ private:
 
     tgui::Label::Ptr m_tableTitleLabel;
     tgui::Grid::Ptr m_tableHeaderGrid;
-    tgui::ScrollablePanel::Ptr m_tableDataPanel;
-    tgui::Grid::Ptr m_tableDataGrid;
+    tgui::Panel::Ptr m_tableDataPanel;
+    tgui::Scrollbar::Ptr m_tableScrollbar;
+    tgui::Label::Ptr m_tableEmptyLabel;
+    std::vector<std::array<tgui::Label::Ptr, TABLE_COLUMN_COUNT>> m_tableRowLabels;
+    size_t m_tableFirstRow = TABLE_NO_ROW;  // Первая строка, значения которой сейчас в метках
+    size_t m_tableVisibleRows = 0;
+
+    ContinuousTrajectory m_trajectory;
+    // Параметры и сводка расчета m_trajectory: при увеличении только T расчет продолжается с его конца
+    SimulationParameters m_trajectoryParams;
+    SimulationSummary m_trajectorySummary;
+    double m_tableTimeStep = 0.0;   // Шаг времени между строками таблицы (DT расчета)
+    size_t m_tableRowCount = 0;
+    std::vector<sf::Vertex> m_trajectoryDisplayPoints; // Вершины текущего уровня детализации
+    TrajectoryLod m_trajectoryLod;
+    int m_displayLodLevel = NO_LOD_LEVEL;
+    sf::FloatRect m_trajectoryViewRect;
+    // Предпросмотр идущего расчета. Новый расчет рисуется вместо прежней траектории,
+    // продолжение - после нее
+    std::vector<sf::Vertex> m_liveDisplayPoints;
+    TrajectoryLod::Bounds m_liveBounds;
+    bool m_liveReplacesTrajectory = false;
+    bool m_canvasDirty = true;          // Канвас нужно перерисовать на следующем кадре
+    sf::Vector2u m_lastCanvasSize;      // Размер текстуры канваса при последней перерисовке
+
+    tgui::Label::Ptr m_profilerLabel;   // Замеры поверх канваса, видны при включенном Profiler
+    sf::Clock m_profilerOverlayClock;
 
-    std::vector<TableRowData> m_currentTableData;
-    std::vector<State> m_calculatedStates;
-    std::vector<sf::Vertex> m_trajectoryDisplayPoints; //   
+    SimulationCache m_resultCache; // Повторный расчет с теми же параметрами берется отсюда
+    std::unique_ptr<SimulationTask> m_simulationTask; // Текущий фоновый расчет (nullptr - расчета нет)
+    std::thread m_simulationThread;
 };
 
 #endif // USERINTERFACE_H
\ No newline at end of file
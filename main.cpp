@@ -1,18 +1,20 @@
 ﻿#include "Calculations.h"         // Для расчетов
 #include "TrajectoryVisualizer.h" // Для визуализации
 #include "UserInterface.h"        // Для вашего TGUI интерфейса
+#include "TrajectoryIO.h"         // Для saveTrajectoryToFile
+#include "Profiler.h"
 
+#include <cstdlib>     // Для std::getenv
 #include <iostream>
 #include <string>
 #include <stdexcept>   // Для tgui::Exception и std::exception
-#include <iomanip>     // Для std::fixed, std::setprecision в saveTrajectoryToFile
-#include <fstream>     // Для std::ofstream в saveTrajectoryToFile
-
-void saveTrajectoryToFile(const WorldTrajectoryData& trajectoryData, const std::string& filename);
-
 
 int main() {
     setlocale(LC_ALL, "Rus");
+    // TRAJECTORY_PROFILE=1 включает замеры с самого запуска (иначе - по F3)
+    if (const char* profile = std::getenv("TRAJECTORY_PROFILE")) {
+        Profiler::instance().setEnabled(profile[0] != '\0' && profile[0] != '0');
+    }
     
     // 1. ВИЗУАЛИЗАЦИЯ ТРАЕКТОРИИ //
 
@@ -44,6 +46,10 @@ int main() {
 
     try {
         UserInterface uiApp;
+        // TRAJECTORY_CACHE_DIR - каталог, в котором результаты расчетов сохраняются между запусками
+        if (const char* cacheDirectory = std::getenv("TRAJECTORY_CACHE_DIR")) {
+            uiApp.setResultCacheDirectory(cacheDirectory);
+        }
         uiApp.run();
     }
     catch (const tgui::Exception& e) {
@@ -65,20 +71,3 @@ int main() {
 
     return EXIT_SUCCESS;
 }
-
-
-
-void saveTrajectoryToFile(const WorldTrajectoryData& trajectoryData, const std::string& filename) {
-    std::ofstream fout(filename);
-    if (!fout.is_open()) {
-        std::cerr << "Ошибка: не удалось открыть файл '" << filename << "' для записи.\n";
-        return;
-    }
-    // Используем высокую точность для сохранения данных
-    fout << std::fixed << std::setprecision(10);
-    for (const auto& point : trajectoryData) {
-        fout << point.first << " " << point.second << "\n";
-    }
-    fout.close();
-    std::cout << "Результаты симуляции (" << trajectoryData.size() << " точек) записаны в " << filename << "\n";
-}
\ No newline at end of file